@@ -4,16 +4,67 @@
 #include <linux/cdev.h>
 #include <linux/device.h>
 #include <linux/interrupt.h>
+#include <linux/irq.h>
 #include <linux/slab.h>
+#include <linux/kfifo.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
+#include <linux/version.h>
 
 /* Private macros */
 #define MOD_NAME "alman"
 #define DEV_INFO KERN_INFO MOD_NAME ": "
 
-#define USE_DYNAMIC 0
+#define EVT_FIFO_SIZE (1024) /* must be power of 2 */
+#define EVT_PENDING (0)
+#define STAT_BUF_SIZE (512)
+
+/* Private types */
+enum bh_mode {
+	BH_TASKLET = 0,
+	BH_THREADED_IRQ,
+	BH_WORKQUEUE,
+	BH_MAX,
+};
+
+struct alm_event {
+	u64 ts;
+	u32 seq;
+};
+
+struct alm_stats {
+	u64 events;
+	u64 batches;
+	u64 max_batch;
+	u64 lat_sum;
+	u64 lat_min;
+	u64 lat_max;
+	u64 start_ns;
+};
+
+/* Bottom half backend operations */
+struct bh_ops {
+	const char *name;
+	int (*init)(void);
+	void (*kick)(void);
+	void (*exit)(void);
+};
+
+/* Module parameters */
+static int bh_mode = BH_TASKLET;
+module_param(bh_mode, int, 0444);
+MODULE_PARM_DESC(bh_mode, "0 = tasklet, 1 = threaded irq, 2 = workqueue");
+
+static unsigned long gen_period_us = 100;
+module_param(gen_period_us, ulong, 0644);
+MODULE_PARM_DESC(gen_period_us, "Synthetic event generator period (us)");
+
+static unsigned int gen_burst = 4;
+module_param(gen_burst, uint, 0644);
+MODULE_PARM_DESC(gen_burst, "Events produced per generator tick");
 
-/* Tasklet: Function prototypes */
-static void tasklet_fn(unsigned long arg);
 /* Device file: Function prototypes */
 static int alm_open(struct inode *inode, struct file *filp);
 static int alm_release(struct inode *inode, struct file *filp);
@@ -38,18 +89,219 @@ static struct file_operations fops = {
 	.release = alm_release,
 };
 
-#if USE_DYNAMIC
-static struct tasklet_struct alm_tasklet;
+static DEFINE_KFIFO(evt_fifo, struct alm_event, EVT_FIFO_SIZE);
+static unsigned long evt_flags;
+static u32 evt_seq;
+static unsigned long evt_dropped; /* written by the generator only */
+static struct alm_stats stats;
+static DEFINE_SPINLOCK(stats_lock);
+static struct hrtimer gen_timer;
+static bool gen_running;
+static DEFINE_MUTEX(gen_lock);
+static const struct bh_ops *bh;
+
+/* Function implementations */
+/* Batch queue: drain every pending event in one bottom half invocation */
+static void evt_drain(void)
+{
+	struct alm_event evt;
+	u64 now, lat, n = 0;
+	u64 lat_sum = 0, lat_min = U64_MAX, lat_max = 0;
+
+	/*
+	 * Clear the pending bit before draining, so an event queued after
+	 * the last kfifo_get() always triggers a new kick.
+	 */
+	clear_bit(EVT_PENDING, &evt_flags);
+	smp_mb__after_atomic();
+
+	now = ktime_get_ns();
+	while (kfifo_get(&evt_fifo, &evt)) {
+		lat = now - evt.ts;
+		lat_sum += lat;
+		lat_min = min(lat_min, lat);
+		lat_max = max(lat_max, lat);
+		n++;
+	}
+
+	if (n == 0)
+		return;
+
+	spin_lock_bh(&stats_lock);
+	stats.events += n;
+	stats.batches++;
+	stats.max_batch = max(stats.max_batch, n);
+	stats.lat_sum += lat_sum;
+	stats.lat_min = min(stats.lat_min, lat_min);
+	stats.lat_max = max(stats.lat_max, lat_max);
+	spin_unlock_bh(&stats_lock);
+}
+
+/* Backend: Tasklet */
+static void tasklet_fn(struct tasklet_struct *t)
+{
+	evt_drain();
+}
+
+static DECLARE_TASKLET(alm_tasklet, tasklet_fn);
+
+static int bh_tasklet_init(void)
+{
+	return 0;
+}
+
+static void bh_tasklet_kick(void)
+{
+	tasklet_schedule(&alm_tasklet);
+}
+
+static void bh_tasklet_exit(void)
+{
+	tasklet_kill(&alm_tasklet);
+}
+
+/* Backend: Threaded IRQ on a software-only interrupt descriptor */
+static int alm_irq = -1;
+
+static irqreturn_t irq_hard_fn(int irq, void *dev_id)
+{
+	return IRQ_WAKE_THREAD;
+}
+
+static irqreturn_t irq_thread_fn(int irq, void *dev_id)
+{
+	evt_drain();
+	return IRQ_HANDLED;
+}
+
+static int bh_irq_init(void)
+{
+	int ret;
+
+	if ((alm_irq = irq_alloc_desc(0)) < 0)
+		return alm_irq;
+
+	irq_set_chip_and_handler(alm_irq, &dummy_irq_chip, handle_simple_irq);
+	irq_clear_status_flags(alm_irq, IRQ_NOREQUEST | IRQ_NOPROBE);
+
+	ret = request_threaded_irq(alm_irq, irq_hard_fn, irq_thread_fn, 0,
+				   MOD_NAME "_bh", &alm_irq);
+	if (ret < 0) {
+		irq_free_desc(alm_irq);
+		alm_irq = -1;
+	}
+
+	return ret;
+}
+
+static void bh_irq_kick(void)
+{
+	/* Called from the generator hrtimer, interrupts already disabled */
+	generic_handle_irq(alm_irq);
+}
+
+static void bh_irq_exit(void)
+{
+	free_irq(alm_irq, &alm_irq);
+	irq_free_desc(alm_irq);
+}
+
+/* Backend: BH (or high priority) workqueue */
+static struct workqueue_struct *alm_wq;
+
+static void work_fn(struct work_struct *work)
+{
+	evt_drain();
+}
+
+static DECLARE_WORK(alm_work, work_fn);
+
+static int bh_wq_init(void)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 9, 0)
+	alm_wq = alloc_workqueue(MOD_NAME "_bh", WQ_BH, 0);
 #else
-static DECLARE_TASKLET_OLD(alm_tasklet, tasklet_fn);
+	alm_wq = alloc_workqueue(MOD_NAME "_bh", WQ_HIGHPRI, 1);
 #endif
+	return alm_wq ? 0 : -ENOMEM;
+}
 
-/* Function implementations */
-/* Tasklet: Function */
-static void tasklet_fn(unsigned long arg)
+static void bh_wq_kick(void)
+{
+	queue_work(alm_wq, &alm_work);
+}
+
+static void bh_wq_exit(void)
+{
+	cancel_work_sync(&alm_work);
+	destroy_workqueue(alm_wq);
+}
+
+static const struct bh_ops bh_list[BH_MAX] = {
+	[BH_TASKLET] = {
+		.name = "tasklet",
+		.init = bh_tasklet_init,
+		.kick = bh_tasklet_kick,
+		.exit = bh_tasklet_exit,
+	},
+	[BH_THREADED_IRQ] = {
+		.name = "threaded_irq",
+		.init = bh_irq_init,
+		.kick = bh_irq_kick,
+		.exit = bh_irq_exit,
+	},
+	[BH_WORKQUEUE] = {
+		.name = "workqueue",
+		.init = bh_wq_init,
+		.kick = bh_wq_kick,
+		.exit = bh_wq_exit,
+	},
+};
+
+/* Generator: produce a burst of timestamped events and kick the BH once */
+static enum hrtimer_restart gen_timer_fn(struct hrtimer *timer)
+{
+	struct alm_event evt;
+	unsigned int i;
+
+	for (i = 0; i < gen_burst; i++) {
+		evt.ts = ktime_get_ns();
+		evt.seq = evt_seq++;
+		if (!kfifo_put(&evt_fifo, evt))
+			evt_dropped++;
+	}
+
+	if (!test_and_set_bit(EVT_PENDING, &evt_flags))
+		bh->kick();
+
+	hrtimer_forward_now(timer, us_to_ktime(gen_period_us));
+	return HRTIMER_RESTART;
+}
+
+static void gen_start(void)
 {
-	pr_info(DEV_INFO "Tasklet is executing in atomic context\n");
-	pr_info(DEV_INFO "Tasklet arg = %ld\n", arg);
+	if (gen_running)
+		return;
+
+	spin_lock_bh(&stats_lock);
+	memset(&stats, 0, sizeof(stats));
+	stats.lat_min = U64_MAX;
+	stats.start_ns = ktime_get_ns();
+	spin_unlock_bh(&stats_lock);
+	WRITE_ONCE(evt_dropped, 0);
+
+	gen_running = true;
+	hrtimer_start(&gen_timer, us_to_ktime(gen_period_us),
+		      HRTIMER_MODE_REL);
+}
+
+static void gen_stop(void)
+{
+	if (!gen_running)
+		return;
+
+	hrtimer_cancel(&gen_timer);
+	gen_running = false;
 }
 
 /* Device file: Function implementations */
@@ -68,22 +320,66 @@ static int alm_release(struct inode *inode, struct file *filp)
 static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off)
 {
-	pr_info(DEV_INFO "Driver read() called\n");
-	tasklet_schedule(&alm_tasklet);
-	pr_info(DEV_INFO "Driver read() exited\n");
-	return 0;
+	struct alm_stats s;
+	char kbuf[STAT_BUF_SIZE];
+	u64 elapsed, avg, rate;
+	int n;
+
+	spin_lock_bh(&stats_lock);
+	s = stats;
+	spin_unlock_bh(&stats_lock);
+
+	elapsed = s.start_ns ? ktime_get_ns() - s.start_ns : 0;
+	avg = s.events ? div64_u64(s.lat_sum, s.events) : 0;
+	rate = elapsed ? div64_u64(s.events * NSEC_PER_SEC, elapsed) : 0;
+
+	n = scnprintf(kbuf, sizeof(kbuf),
+		      "backend:   %s\n"
+		      "running:   %d\n"
+		      "events:    %llu\n"
+		      "batches:   %llu\n"
+		      "max_batch: %llu\n"
+		      "dropped:   %lu\n"
+		      "lat_min:   %llu ns\n"
+		      "lat_avg:   %llu ns\n"
+		      "lat_max:   %llu ns\n"
+		      "rate:      %llu ev/s\n",
+		      bh->name, gen_running, s.events, s.batches, s.max_batch,
+		      READ_ONCE(evt_dropped), s.events ? s.lat_min : 0, avg,
+		      s.lat_max, rate);
+
+	return simple_read_from_buffer(buf, len, off, kbuf, n);
 }
 
 static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
 			 loff_t *off)
 {
-	pr_info(DEV_INFO "Driver write() called\n");
+	bool run;
+	int err;
+
+	/* "1" starts the event generator, "0" stops it */
+	if ((err = kstrtobool_from_user(buf, len, &run)) < 0)
+		return err;
+
+	mutex_lock(&gen_lock);
+	if (run)
+		gen_start();
+	else
+		gen_stop();
+	mutex_unlock(&gen_lock);
+
 	return len;
 }
 
 /* Driver: Function implementations */
 static int __init alm_init(void)
 {
+	if (bh_mode < 0 || bh_mode >= BH_MAX) {
+		pr_err(DEV_INFO "Invalid bh_mode %d\n", bh_mode);
+		return -EINVAL;
+	}
+	bh = &bh_list[bh_mode];
+
 	/* Chardev: Allocate major number */
 	if (alloc_chrdev_region(&alm_devnum, 0, 1, MOD_NAME "_dev") < 0) {
 		pr_err(DEV_INFO "Can't allocate major number for device\n");
@@ -115,14 +411,21 @@ static int __init alm_init(void)
 		goto r_device;
 	}
 
-	/* Tasklet (atomic context) */
-#if USE_DYNAMIC
-	tasklet_init(&alm_tasklet, tasklet_fn, 313);
-#endif
+	/* Bottom half: Setup selected backend */
+	if (bh->init() < 0) {
+		pr_err(DEV_INFO "Can't setup %s backend\n", bh->name);
+		goto r_bh;
+	}
+
+	/* Generator: Setup, started by writing "1" to the device */
+	hrtimer_init(&gen_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	gen_timer.function = gen_timer_fn;
 
-	printk(DEV_INFO "Driver inserted\n");
+	printk(DEV_INFO "Driver inserted, backend = %s\n", bh->name);
 	return 0;
 
+r_bh:
+	device_destroy(alm_class, alm_devnum);
 r_device:
 	class_destroy(alm_class);
 r_class:
@@ -135,9 +438,8 @@ r_cdev:
 
 static void __exit alm_exit(void)
 {
-#if USE_DYNAMIC
-	tasklet_kill(&alm_tasklet);
-#endif
+	gen_stop();
+	bh->exit();
 
 	device_destroy(alm_class, alm_devnum);
 	class_destroy(alm_class);
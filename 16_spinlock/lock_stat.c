@@ -0,0 +1,94 @@
+#include <linux/module.h>
+#include <linux/log2.h>
+#include <linux/seq_file.h>
+#include "lock_stat.h"
+
+#if USE_LOCK_STAT
+
+/**
+ * lock_stat_bucket - histogram index of a duration
+ *
+ * Return: log2 of @ns, clamped to the last bucket
+ */
+static unsigned int lock_stat_bucket(u64 ns)
+{
+	return min_t(unsigned int, ilog2(ns + 1), LOCK_STAT_BUCKETS - 1);
+}
+
+/**
+ * lock_stat_acquired - account wait time, called with the lock held
+ * @t0: local_clock() taken before trying to acquire
+ * @contended: the first trylock failed
+ */
+void lock_stat_acquired(struct lock_stat *st, u64 t0, bool contended)
+{
+	u64 now = local_clock();
+	u64 wait = now > t0 ? now - t0 : 0;
+
+	st->acquired_ts = now;
+	st->count++;
+	if (contended)
+		st->contended++;
+
+	st->wait_sum += wait;
+	st->wait_max = max(st->wait_max, wait);
+	st->wait_hist[lock_stat_bucket(wait)]++;
+}
+
+/**
+ * lock_stat_release - account hold time, called right before unlock
+ */
+void lock_stat_release(struct lock_stat *st)
+{
+	u64 now = local_clock();
+	u64 hold = now > st->acquired_ts ? now - st->acquired_ts : 0;
+
+	st->hold_sum += hold;
+	st->hold_max = max(st->hold_max, hold);
+	st->hold_hist[lock_stat_bucket(hold)]++;
+}
+
+/**
+ * lock_stat_show - print statistic and histograms of one lock
+ *
+ * Read without the lock, a value may lag behind by one acquisition.
+ */
+static int lock_stat_show(struct seq_file *s, void *unused)
+{
+	struct lock_stat *st = s->private;
+	u64 count = READ_ONCE(st->count);
+	int i;
+
+	seq_printf(s, "name:      %s\n", st->name);
+	seq_printf(s, "count:     %llu\n", count);
+	seq_printf(s, "contended: %llu\n", READ_ONCE(st->contended));
+	seq_printf(s, "wait_avg:  %llu ns\n",
+		   count ? div64_u64(READ_ONCE(st->wait_sum), count) : 0);
+	seq_printf(s, "wait_max:  %llu ns\n", READ_ONCE(st->wait_max));
+	seq_printf(s, "hold_avg:  %llu ns\n",
+		   count ? div64_u64(READ_ONCE(st->hold_sum), count) : 0);
+	seq_printf(s, "hold_max:  %llu ns\n", READ_ONCE(st->hold_max));
+
+	seq_printf(s, "\n%12s %14s %14s\n", "<ns", "wait", "hold");
+	for (i = 0; i < LOCK_STAT_BUCKETS; i++) {
+		u64 w = READ_ONCE(st->wait_hist[i]);
+		u64 h = READ_ONCE(st->hold_hist[i]);
+
+		if (w == 0 && h == 0)
+			continue;
+		seq_printf(s, "%12llu %14llu %14llu\n", 2ULL << i, w, h);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(lock_stat);
+
+/**
+ * lock_stat_debugfs - export statistic of one lock as <parent>/<name>
+ */
+void lock_stat_debugfs(struct lock_stat *st, struct dentry *parent)
+{
+	debugfs_create_file(st->name, 0444, parent, st, &lock_stat_fops);
+}
+
+#endif /* USE_LOCK_STAT */
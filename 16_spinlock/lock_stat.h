@@ -0,0 +1,75 @@
+#ifndef __LOCK_STAT_H__
+#define __LOCK_STAT_H__
+
+#include <linux/module.h>
+#include <linux/spinlock.h>
+#include <linux/sched/clock.h>
+#include <linux/debugfs.h>
+
+/* make USE_LOCK_STAT=0 compiles the instrumentation out */
+#ifndef USE_LOCK_STAT
+#define USE_LOCK_STAT (1)
+#endif
+
+#define LOCK_STAT_BUCKETS (32) /* log2(ns) histogram, last one open */
+
+#if USE_LOCK_STAT
+
+/*
+ * Every field is updated while the instrumented lock is held, so the
+ * lock itself serializes the statistic.
+ */
+struct lock_stat {
+	const char *name;
+	u64 acquired_ts;
+	u64 count;
+	u64 contended;
+	u64 wait_sum;
+	u64 wait_max;
+	u64 hold_sum;
+	u64 hold_max;
+	u64 wait_hist[LOCK_STAT_BUCKETS];
+	u64 hold_hist[LOCK_STAT_BUCKETS];
+};
+
+#define LOCK_STAT_INIT(_name) { .name = (_name) }
+
+void lock_stat_acquired(struct lock_stat *st, u64 t0, bool contended);
+void lock_stat_release(struct lock_stat *st);
+void lock_stat_debugfs(struct lock_stat *st, struct dentry *parent);
+
+/* Wrappers: trylock first, so contention is counted without spinning */
+#define lock_stat_spin_lock(lock, st)                                          \
+	do {                                                                   \
+		u64 __t0 = local_clock();                                      \
+		bool __contended = !spin_trylock(lock);                        \
+									       \
+		if (__contended)                                               \
+			spin_lock(lock);                                       \
+		lock_stat_acquired(st, __t0, __contended);                     \
+	} while (0)
+
+#define lock_stat_spin_unlock(lock, st)                                        \
+	do {                                                                   \
+		lock_stat_release(st);                                         \
+		spin_unlock(lock);                                             \
+	} while (0)
+
+#else /* !USE_LOCK_STAT */
+
+struct lock_stat {
+};
+
+#define LOCK_STAT_INIT(_name) {}
+
+static inline void lock_stat_debugfs(struct lock_stat *st,
+				     struct dentry *parent)
+{
+}
+
+#define lock_stat_spin_lock(lock, st) spin_lock(lock)
+#define lock_stat_spin_unlock(lock, st) spin_unlock(lock)
+
+#endif /* USE_LOCK_STAT */
+
+#endif /* __LOCK_STAT_H__ */
@@ -5,6 +5,10 @@
 #include <linux/device.h>
 #include <linux/kthread.h>
 #include <linux/delay.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include "lock_stat.h"
 
 /* Private macros */
 #define MOD_NAME "alman"
@@ -12,13 +16,35 @@
 
 #define USE_DYNAMIC 0
 #define THREAD_CNT 2
+#define MAX_THREAD 64
+#define STAT_BUF_SIZE 4096
 
 /* Private types */
+/* Per-thread statistic, one cacheline each to avoid false sharing */
 struct thread_data {
 	struct task_struct *thread;
-	char name[10];
+	char name[12];
 	int index;
-};
+	unsigned long incs;
+	unsigned long folds;
+} ____cacheline_aligned_in_smp;
+
+/* Module parameters */
+static unsigned int nr_threads = THREAD_CNT;
+module_param(nr_threads, uint, 0444);
+MODULE_PARM_DESC(nr_threads, "Number of incrementing threads");
+
+static unsigned int burst = 1;
+module_param(burst, uint, 0644);
+MODULE_PARM_DESC(burst, "Increments per thread loop");
+
+static unsigned int interval_ms = 1000;
+module_param(interval_ms, uint, 0644);
+MODULE_PARM_DESC(interval_ms, "Sleep between thread loops, 0 = busy");
+
+static unsigned int fold_batch = 32;
+module_param(fold_batch, uint, 0644);
+MODULE_PARM_DESC(fold_batch, "Per-CPU count folded into shared_var");
 
 /* Device file: Function prototypes */
 static int alm_open(struct inode *inode, struct file *filp);
@@ -49,30 +75,59 @@ static spinlock_t alm_spinlock;
 #else
 static DEFINE_SPINLOCK(alm_spinlock);
 #endif
-static struct thread_data thread_list[THREAD_CNT];
+static struct lock_stat alm_lock_stat = LOCK_STAT_INIT("alm_spinlock");
+static struct dentry *alm_debugfs;
+static struct thread_data thread_list[MAX_THREAD];
 static unsigned long shared_var = 0;
+static DEFINE_PER_CPU(unsigned long, pcpu_var);
 
 /* Function implementations */
-/* Thread: Function */
-static int fn_thread(void *pv)
+/* Counter: increment the local CPU shard, fold it once per batch */
+static void counter_inc(struct thread_data *th)
 {
-	int idx = *(int *)pv;
+	unsigned long delta;
+
+	th->incs++;
+	if (this_cpu_inc_return(pcpu_var) < fold_batch)
+		return;
+
+	/* drain + fold under the lock: counter_sum() counts the delta once */
+	lock_stat_spin_lock(&alm_spinlock, &alm_lock_stat);
+	delta = this_cpu_xchg(pcpu_var, 0);
+	shared_var += delta;
+	lock_stat_spin_unlock(&alm_spinlock, &alm_lock_stat);
+	th->folds++;
+}
 
-	while (!kthread_should_stop()) {
-		pr_info(DEV_INFO "Thread %d is running\n", idx);
+/* Counter: aggregate folded value and every CPU shard */
+static unsigned long counter_sum(void)
+{
+	unsigned long sum;
+	int cpu;
 
-		if (!spin_is_locked(&alm_spinlock))
-			pr_info(DEV_INFO "Thread %d, spinlock is busy\n", idx);
+	lock_stat_spin_lock(&alm_spinlock, &alm_lock_stat);
+	sum = shared_var;
+	for_each_possible_cpu(cpu)
+		sum += READ_ONCE(*per_cpu_ptr(&pcpu_var, cpu));
+	lock_stat_spin_unlock(&alm_spinlock, &alm_lock_stat);
 
-		spin_lock(&alm_spinlock);
-		if (spin_is_locked(&alm_spinlock))
-			pr_info(DEV_INFO "Thread %d, spinlock is used\n", idx);
+	return sum;
+}
 
-		pr_info(DEV_INFO "Thread %d, shared_var = %ld\n", idx,
-			++shared_var);
-		spin_unlock(&alm_spinlock);
+/* Thread: Function */
+static int fn_thread(void *pv)
+{
+	struct thread_data *th = pv;
+	unsigned int i;
 
-		msleep(1000);
+	while (!kthread_should_stop()) {
+		for (i = 0; i < burst; i++)
+			counter_inc(th);
+
+		if (interval_ms)
+			msleep(interval_ms);
+		else
+			cond_resched();
 	}
 
 	return 0;
@@ -94,8 +149,28 @@ static int alm_release(struct inode *inode, struct file *filp)
 static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off)
 {
+	char *kbuf;
+	ssize_t ret;
+	int i, n;
+
 	pr_info(DEV_INFO "Driver read() called\n");
-	return 0;
+
+	if ((kbuf = kmalloc(STAT_BUF_SIZE, GFP_KERNEL)) == NULL)
+		return -ENOMEM;
+
+	n = scnprintf(kbuf, STAT_BUF_SIZE, "shared_var = %lu\n",
+		      counter_sum());
+	for (i = 0; i < nr_threads; i++) {
+		struct thread_data *th = &thread_list[i];
+
+		n += scnprintf(kbuf + n, STAT_BUF_SIZE - n,
+			       "thread_%d: incs = %lu, folds = %lu\n", i,
+			       READ_ONCE(th->incs), READ_ONCE(th->folds));
+	}
+
+	ret = simple_read_from_buffer(buf, len, off, kbuf, n);
+	kfree(kbuf);
+	return ret;
 }
 
 static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
@@ -110,6 +185,11 @@ static int __init alm_init(void)
 {
 	int i;
 
+	if (nr_threads == 0 || nr_threads > MAX_THREAD) {
+		pr_err(DEV_INFO "Invalid nr_threads %u\n", nr_threads);
+		return -EINVAL;
+	}
+
 	/* Device Number: Allocate major number */
 	if (alloc_chrdev_region(&alm_devnum, 0, 1, MOD_NAME "_dev") < 0) {
 		pr_err(DEV_INFO "Can't allocate major number for device\n");
@@ -146,15 +226,19 @@ static int __init alm_init(void)
 	spin_lock_init(&alm_spinlock);
 #endif
 
+	/* Debugfs: /sys/kernel/debug/alman_lock_stat/alm_spinlock */
+	alm_debugfs = debugfs_create_dir(MOD_NAME "_lock_stat", NULL);
+	lock_stat_debugfs(&alm_lock_stat, alm_debugfs);
+
 	/* Kernel thread: Create & Wakeup */
-	for (i = 0; i < THREAD_CNT; i++) {
+	for (i = 0; i < nr_threads; i++) {
 		struct thread_data *th = &thread_list[i];
 
 		th->index = i;
 		sprintf(th->name, "thread_%d", th->index);
 
-		if ((th->thread = kthread_run(fn_thread, &th->index,
-					      th->name)) == NULL) {
+		if (IS_ERR(th->thread = kthread_run(fn_thread, th,
+						    th->name))) {
 			pr_info(DEV_INFO "Can't create thread %d\n", i);
 			goto r_thread;
 		}
@@ -164,6 +248,9 @@ static int __init alm_init(void)
 	return 0;
 
 r_thread:
+	while (--i >= 0)
+		kthread_stop(thread_list[i].thread);
+	debugfs_remove_recursive(alm_debugfs);
 	device_destroy(alm_class, alm_devnum);
 r_device:
 	class_destroy(alm_class);
@@ -179,11 +266,13 @@ static void __exit alm_exit(void)
 {
 	int i;
 
-	for (i = 0; i < THREAD_CNT; i++) {
+	for (i = 0; i < nr_threads; i++) {
 		struct thread_data *th = &thread_list[i];
 
 		kthread_stop(th->thread);
 	}
+	pr_info(DEV_INFO "Final shared_var = %lu\n", counter_sum());
+	debugfs_remove_recursive(alm_debugfs);
 
 	device_destroy(alm_class, alm_devnum);
 	class_destroy(alm_class);
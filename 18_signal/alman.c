@@ -5,18 +5,46 @@
 #include <linux/device.h>
 #include <linux/ioctl.h>
 #include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/eventfd.h>
+#include <linux/spinlock.h>
+#include <linux/list.h>
+#include <linux/poll.h>
+#include <linux/wait.h>
+#include <linux/mutex.h>
+#include <linux/sched/task.h>
+#include <linux/uaccess.h>
+#include <linux/version.h>
+#include "alman_ioctl.h"
 
 /* Private macros */
 #define MOD_NAME "alman"
 #define DEV_INFO KERN_INFO MOD_NAME ": "
 
-#define REG_CURRENT_TASK _IOW('a', 'a', int32_t *)
-#define SIGETX 44
+/* Private types */
+/*
+ * One subscriber per open file. Every write is fanned out to each
+ * subscriber whose filter accepts the channel: the event is queued in its
+ * own ring (drained by read() or the mapping), then poll waiters, the
+ * eventfd and the registered task are notified.
+ */
+struct alm_sub {
+	struct list_head node;
+	struct alm_dev *dev;
+	struct alm_ring *ring;
+	u32 filter;
+	struct task_struct *task;
+	int signum;
+	struct eventfd_ctx *evfd;
+	wait_queue_head_t wait;
+	struct mutex read_lock;
+};
 
 /* Private variables */
 struct alm_dev {
-	struct task_struct *task;
-	int signum;
+	struct list_head subs;
+	unsigned int nr_subs;
+	spinlock_t lock; /* protects subs and their task/evfd/filter */
 
 	dev_t dev_num;
 	struct cdev dev_cdev;
@@ -24,8 +52,8 @@ struct alm_dev {
 };
 
 static struct alm_dev alman = {
-	.task = NULL,
-	.signum = 0,
+	.subs = LIST_HEAD_INIT(alman.subs),
+	.lock = __SPIN_LOCK_UNLOCKED(alman.lock),
 	.dev_num = 0,
 };
 
@@ -39,87 +67,344 @@ static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off);
 static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
 			 loff_t *off);
+static __poll_t alm_poll(struct file *filp, struct poll_table_struct *wait);
 static long alm_ioctl(struct file *filp, unsigned int cmd, unsigned long arg);
+static int alm_mmap(struct file *filp, struct vm_area_struct *vma);
 
 static struct file_operations fops = {
 	.owner = THIS_MODULE,
 	.read = alm_read,
 	.write = alm_write,
+	.poll = alm_poll,
 	.open = alm_open,
 	.release = alm_release,
 	.unlocked_ioctl = alm_ioctl,
+	.mmap = alm_mmap,
 };
 
 /* Function implementations */
+/*
+ * alm_ring_push - append an event, called with dev->lock held
+ *
+ * Return: false if the ring is full and the event was dropped
+ */
+static bool alm_ring_push(struct alm_ring *ring, const struct alm_event *evt)
+{
+	u32 head = ring->head;
+
+	if (head - READ_ONCE(ring->tail) >= ALM_RING_SIZE) {
+		ring->dropped++;
+		return false;
+	}
+
+	ring->data[head & (ALM_RING_SIZE - 1)] = *evt;
+	/* publish the entry before the new head */
+	smp_store_release(&ring->head, head + 1);
+	return true;
+}
+
+static u32 alm_ring_count(struct alm_ring *ring)
+{
+	return smp_load_acquire(&ring->head) - READ_ONCE(ring->tail);
+}
+
+/*
+ * alm_eventfd_notify - wake up every epoll/read waiter of the eventfd
+ */
+static void alm_eventfd_notify(struct eventfd_ctx *ctx)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 8, 0)
+	eventfd_signal(ctx);
+#else
+	eventfd_signal(ctx, 1);
+#endif
+}
+
+/*
+ * alm_sub_notify - deliver one event to a subscriber, called with
+ * dev->lock held
+ */
+static void alm_sub_notify(struct alm_sub *sub, const struct alm_event *evt)
+{
+	struct kernel_siginfo info;
+
+	if (!(sub->filter & BIT(evt->channel)))
+		return;
+
+	if (alm_ring_push(sub->ring, evt)) {
+		wake_up_interruptible(&sub->wait);
+		if (sub->evfd)
+			alm_eventfd_notify(sub->evfd);
+	}
+
+	/*
+	 * Compatibility path: one real-time signal per value, queued by the
+	 * signal code itself so it does not depend on the ring being drained
+	 */
+	if (sub->task) {
+		clear_siginfo(&info);
+		info.si_int = evt->value;
+		info.si_signo = sub->signum;
+		info.si_code = SI_QUEUE;
+
+		if (send_sig_info(sub->signum, &info, sub->task) < 0)
+			pr_err(DEV_INFO "Send signal failed\n");
+	}
+}
+
+/*
+ * alm_sub_set_task - swap the task to be signaled, NULL unregisters
+ */
+static void alm_sub_set_task(struct alm_sub *sub, struct task_struct *task)
+{
+	struct alm_dev *dev = sub->dev;
+	struct task_struct *old;
+
+	if (task)
+		get_task_struct(task);
+
+	spin_lock(&dev->lock);
+	old = sub->task;
+	sub->task = task;
+	sub->signum = SIGETX;
+	spin_unlock(&dev->lock);
+
+	if (old)
+		put_task_struct(old);
+}
+
+/*
+ * alm_sub_set_eventfd - swap the eventfd to be signaled, NULL unregisters
+ */
+static void alm_sub_set_eventfd(struct alm_sub *sub, struct eventfd_ctx *ctx)
+{
+	struct alm_dev *dev = sub->dev;
+	struct eventfd_ctx *old;
+
+	spin_lock(&dev->lock);
+	old = sub->evfd;
+	sub->evfd = ctx;
+	spin_unlock(&dev->lock);
+
+	if (old)
+		eventfd_ctx_put(old);
+}
+
 static long alm_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
-	struct alm_dev *dev;
+	struct alm_sub *sub;
+	struct eventfd_ctx *ctx;
+	u32 filter;
+	s32 fd;
 
-	dev = (struct alm_dev *)filp->private_data;
+	sub = (struct alm_sub *)filp->private_data;
 	switch (cmd) {
 	case REG_CURRENT_TASK:
 		pr_info("IOCTL: REG_CURRENT_TASK\n");
-		dev->task = get_current();
-		dev->signum = SIGETX;
+		alm_sub_set_task(sub, current);
 		break;
 
-	default:
+	case UNREG_CURRENT_TASK:
+		pr_info("IOCTL: UNREG_CURRENT_TASK\n");
+		alm_sub_set_task(sub, NULL);
 		break;
+
+	case REG_EVENTFD:
+		pr_info("IOCTL: REG_EVENTFD\n");
+		if (get_user(fd, (s32 __user *)arg))
+			return -EFAULT;
+
+		ctx = eventfd_ctx_fdget(fd);
+		if (IS_ERR(ctx))
+			return PTR_ERR(ctx);
+
+		alm_sub_set_eventfd(sub, ctx);
+		break;
+
+	case UNREG_EVENTFD:
+		pr_info("IOCTL: UNREG_EVENTFD\n");
+		alm_sub_set_eventfd(sub, NULL);
+		break;
+
+	case SET_FILTER:
+		if (get_user(filter, (u32 __user *)arg))
+			return -EFAULT;
+
+		spin_lock(&sub->dev->lock);
+		sub->filter = filter;
+		spin_unlock(&sub->dev->lock);
+		break;
+
+	default:
+		return -ENOTTY;
 	}
 	return 0;
 }
 
+/*
+ * alm_mmap - map the subscriber's ring (read/write, the app owns the tail)
+ */
+static int alm_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct alm_sub *sub = filp->private_data;
+
+	if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start > PAGE_SIZE)
+		return -EINVAL;
+
+	return remap_pfn_range(vma, vma->vm_start,
+			       virt_to_phys(sub->ring) >> PAGE_SHIFT,
+			       vma->vm_end - vma->vm_start, vma->vm_page_prot);
+}
+
 static int alm_open(struct inode *inode, struct file *filp)
 {
 	struct alm_dev *dev;
+	struct alm_sub *sub;
+	unsigned int nr_subs;
 
 	dev = container_of(inode->i_cdev, struct alm_dev, dev_cdev);
-	filp->private_data = dev;
 
-	pr_info(DEV_INFO "Driver open() called\n");
+	if ((sub = kzalloc(sizeof(*sub), GFP_KERNEL)) == NULL)
+		return -ENOMEM;
+
+	BUILD_BUG_ON(sizeof(struct alm_ring) > PAGE_SIZE);
+	if ((sub->ring = (void *)get_zeroed_page(GFP_KERNEL)) == NULL) {
+		kfree(sub);
+		return -ENOMEM;
+	}
+
+	sub->dev = dev;
+	sub->filter = ALM_FILTER_ALL;
+	init_waitqueue_head(&sub->wait);
+	mutex_init(&sub->read_lock);
+	filp->private_data = sub;
+
+	spin_lock(&dev->lock);
+	list_add_tail(&sub->node, &dev->subs);
+	nr_subs = ++dev->nr_subs;
+	spin_unlock(&dev->lock);
+
+	pr_info(DEV_INFO "Driver open() called, %u subscriber(s)\n", nr_subs);
 	return 0;
 }
 
 static int alm_release(struct inode *inode, struct file *filp)
 {
+	struct alm_sub *sub = filp->private_data;
+	struct alm_dev *dev = sub->dev;
+
+	/* After this no writer can reach the subscriber anymore */
+	spin_lock(&dev->lock);
+	list_del(&sub->node);
+	dev->nr_subs--;
+	spin_unlock(&dev->lock);
+
+	if (sub->task)
+		put_task_struct(sub->task);
+	if (sub->evfd)
+		eventfd_ctx_put(sub->evfd);
+	free_page((unsigned long)sub->ring);
+	kfree(sub);
+
 	pr_info(DEV_INFO "Driver release() called\n");
 	return 0;
 }
 
+/*
+ * alm_read - dequeue as many whole events as fit in @buf, blocking until at
+ * least one is available unless O_NONBLOCK
+ */
 static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off)
 {
-	pr_info(DEV_INFO "Driver read() called\n");
-	return 0;
-}
+	struct alm_sub *sub = filp->private_data;
+	struct alm_ring *ring = sub->ring;
+	struct alm_event evt;
+	size_t count = 0;
+	u32 head, tail;
+
+	if (len < sizeof(evt))
+		return -EINVAL;
+
+	if (mutex_lock_interruptible(&sub->read_lock))
+		return -ERESTARTSYS;
+
+	while (alm_ring_count(ring) == 0) {
+		mutex_unlock(&sub->read_lock);
+
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		if (wait_event_interruptible(sub->wait, alm_ring_count(ring)))
+			return -ERESTARTSYS;
+		if (mutex_lock_interruptible(&sub->read_lock))
+			return -ERESTARTSYS;
+	}
 
-static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
-			 loff_t *off)
-{
-	struct alm_dev *dev;
-	struct kernel_siginfo info;
-	uint8_t *buffer;
+	head = smp_load_acquire(&ring->head);
+	for (tail = ring->tail; tail != head; tail++) {
+		if (count + sizeof(evt) > len)
+			break;
 
-	dev = (struct alm_dev *)filp->private_data;
+		evt = ring->data[tail & (ALM_RING_SIZE - 1)];
+		if (copy_to_user(buf + count, &evt, sizeof(evt)))
+			break;
+		count += sizeof(evt);
+	}
+	/* release the slots back to the producer */
+	smp_store_release(&ring->tail, tail);
 
-	pr_info(DEV_INFO "Driver write() called\n");
+	mutex_unlock(&sub->read_lock);
+	return count ? count : -EFAULT;
+}
 
-	if ((buffer = kmalloc(len, GFP_KERNEL)) == NULL)
-		return -ENOMEM;
+static __poll_t alm_poll(struct file *filp, struct poll_table_struct *wait)
+{
+	struct alm_sub *sub = filp->private_data;
+	__poll_t mask = EPOLLOUT | EPOLLWRNORM;
 
-	if (copy_from_user(buffer, buf, len))
-		return -ENOMEM;
+	poll_wait(filp, &sub->wait, wait);
+	if (alm_ring_count(sub->ring))
+		mask |= EPOLLIN | EPOLLRDNORM;
 
-	sscanf(buffer, "%d", &info.si_int);
-	info.si_signo = dev->signum;
-	info.si_code = SI_QUEUE;
+	return mask;
+}
 
-	if (dev->task != NULL) {
-		pr_info(DEV_INFO "Send signal to app\n");
-		if (send_sig_info(dev->signum, &info, dev->task) < 0)
-			pr_err(DEV_INFO "Send signal failed\n");
+/*
+ * alm_write - parse "value" or "channel:value" and fan it out
+ */
+static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
+			 loff_t *off)
+{
+	struct alm_sub *sub, *self = filp->private_data;
+	struct alm_dev *dev = self->dev;
+	struct alm_event evt = { .channel = 0 };
+	char kbuf[32], *value;
+	int err;
+
+	if (len == 0 || len >= sizeof(kbuf))
+		return -EINVAL;
+	if (copy_from_user(kbuf, buf, len))
+		return -EFAULT;
+	kbuf[len] = '\0';
+
+	if ((value = strchr(kbuf, ':')) != NULL) {
+		*value++ = '\0';
+		if ((err = kstrtou32(kbuf, 10, &evt.channel)) < 0)
+			return err;
+		if (evt.channel >= ALM_NR_CHANNELS)
+			return -EINVAL;
+	} else {
+		value = kbuf;
 	}
 
+	if ((err = kstrtos32(value, 10, &evt.value)) < 0)
+		return err;
+
+	spin_lock(&dev->lock);
+	list_for_each_entry(sub, &dev->subs, node)
+		alm_sub_notify(sub, &evt);
+	spin_unlock(&dev->lock);
+
 	return len;
 }
 
@@ -139,7 +424,7 @@ static int __init alm_init(void)
 	/* Add chardev to kernel */
 	if (cdev_add(&alman.dev_cdev, alman.dev_num, 1) < 0) {
 		pr_err(DEV_INFO "Can't add chardev to the system\n");
-		return -1;
+		goto r_cdev;
 	}
 
 	/* Create struct class */
@@ -162,6 +447,8 @@ static int __init alm_init(void)
 r_device:
 	class_destroy(alman.dev_class);
 r_class:
+	cdev_del(&alman.dev_cdev);
+r_cdev:
 	unregister_chrdev_region(alman.dev_num, 1);
 
 	return -1;
@@ -0,0 +1,42 @@
+#ifndef __ALMAN_IOCTL_H__
+#define __ALMAN_IOCTL_H__
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/* Shared between the driver and the userspace apps */
+#define SIGETX 44
+#define ALM_RING_SIZE 256 /* entries, must be power of 2 */
+#define ALM_NR_CHANNELS 32 /* one filter bit per channel */
+#define ALM_FILTER_ALL 0xffffffffU
+
+#define REG_CURRENT_TASK _IOW('a', 'a', __s32 *)
+#define REG_EVENTFD _IOW('a', 'b', __s32 *)
+#define UNREG_EVENTFD _IO('a', 'c')
+#define SET_FILTER _IOW('a', 'd', __u32 *)
+#define UNREG_CURRENT_TASK _IO('a', 'e')
+
+/*
+ * One event, written to the device as "value" (channel 0) or
+ * "channel:value", and read back as an array of this struct.
+ */
+struct alm_event {
+	__u32 channel;
+	__s32 value;
+};
+
+/*
+ * Per-open event queue, mmap()-ed from the device (one page). The driver
+ * is the only producer and advances head, the subscriber is the only
+ * consumer and advances tail, either from the mapping or through read().
+ * Entries are dropped (and counted) when the ring is full.
+ */
+struct alm_ring {
+	__u32 head;
+	__u32 tail;
+	__u32 dropped;
+	__u32 reserved;
+	struct alm_event data[ALM_RING_SIZE];
+};
+
+#endif /* __ALMAN_IOCTL_H__ */
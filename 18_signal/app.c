@@ -1,59 +1,83 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include "alman_ioctl.h"
 
-#define REG_CURRENT_TASK _IOW('a', 'a', int32_t *)
-#define SIGETX 44
+/*
+ * Usage: ./app [filter]
+ *
+ * Every running instance is an independent subscriber with its own queue,
+ * filter is a channel bitmask (default: every channel).
+ */
 
 /* Private variables */
-static int quit = 0;
+static volatile sig_atomic_t quit = 0;
 
 /* Private function prototypes */
 static void ctrl_c_handler(int n, siginfo_t *info, void *unused);
-static void sig_event_handler(int n, siginfo_t *info, void *unused);
 
 /* Main function */
-int main()
+int main(int argc, char *argv[])
 {
-	int fd;
-	int32_t value, number;
+	struct alm_event evts[64];
 	struct sigaction act;
+	struct pollfd pfd;
+	uint32_t filter = ALM_FILTER_ALL;
+	ssize_t n;
+	int fd, i;
 
-	/* set crtl+c handler */
+	if (argc > 1)
+		filter = strtoul(argv[1], NULL, 0);
+
+	/* set crtl+c handler, without SA_RESTART so poll returns */
 	sigemptyset(&act.sa_mask);
 	act.sa_flags = SA_SIGINFO | SA_RESETHAND;
 	act.sa_sigaction = ctrl_c_handler;
 	sigaction(SIGINT, &act, NULL);
 	printf("Installed SIGINT = %d\n", SIGINT);
 
-	act.sa_flags = SA_SIGINFO | SA_RESTART;
-	act.sa_sigaction = sig_event_handler;
-	sigaction(SIGETX, &act, NULL);
-	printf("Installed SIGETX = %d\n", SIGETX);
-
 	printf("Openning driver\n");
-	fd = open("/dev/alman_device", O_RDWR);
+	fd = open("/dev/alman_device", O_RDWR | O_NONBLOCK);
 	if (fd < 0) {
 		printf("Can't open device file\n");
 		return -1;
 	}
 
-	printf("Registering app\n");
-	if (ioctl(fd, REG_CURRENT_TASK, NULL)) {
+	printf("Subscribing with filter 0x%08x\n", filter);
+	if (ioctl(fd, SET_FILTER, &filter)) {
 		printf("Failed call to ioctl\n");
 		close(fd);
 		return -1;
 	}
 
-	printf("Wait for signal...\n");
-	while (!quit)
-		;
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+
+	printf("Wait for event...\n");
+	while (!quit) {
+		if (poll(&pfd, 1, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		/* one wakeup drains every queued event */
+		while ((n = read(fd, evts, sizeof(evts))) > 0) {
+			for (i = 0; i < n / (ssize_t)sizeof(evts[0]); i++)
+				printf("Received event from kernel: "
+				       "Channel = %u, Value = %d\n",
+				       evts[i].channel, evts[i].value);
+		}
+	}
 
 	printf("Closing driver\n");
 	close(fd);
@@ -68,11 +92,3 @@ void ctrl_c_handler(int n, siginfo_t *info, void *unused)
 	printf("Received signal from app: ctrl-c\n");
 	quit = 1;
 }
-
-void sig_event_handler(int n, siginfo_t *info, void *unused)
-{
-	if (n != SIGETX)
-		return;
-
-	printf("Received signal from kernel: Value =  %u\n", info->si_int);
-}
@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include "alman_ioctl.h"
+
+/*
+ * Usage: ./bench <signal|eventfd|read> [events]
+ *
+ * A producer thread writes sequence numbers to the device as fast as it
+ * can, the main thread consumes them through the selected channel. Each
+ * event's wakeup latency is the time from before write() to the moment
+ * the consumer sees its payload.
+ */
+
+#define DEV_PATH "/dev/alman_device"
+#define IDLE_TIMEOUT_MS 1000
+
+/* Private variables */
+static int dev_fd;
+static int nr_events = 100000;
+static uint64_t *t_send;
+static uint64_t *lat;
+static int received;
+static uint64_t last_recv;
+
+/* Private function prototypes */
+static uint64_t now_ns(void);
+static void *producer_fn(void *arg);
+static void record(int32_t seq);
+static int run_signal(void);
+static int run_eventfd(void);
+static int run_read(void);
+static int cmp_u64(const void *a, const void *b);
+static void report(const char *mode, uint64_t elapsed);
+
+/* Main function */
+int main(int argc, char *argv[])
+{
+	uint64_t start;
+	int ret;
+
+	if (argc < 2) {
+		printf("Usage: %s <signal|eventfd|read> [events]\n",
+		       argv[0]);
+		return -1;
+	}
+	if (argc > 2)
+		nr_events = atoi(argv[2]);
+
+	t_send = calloc(nr_events, sizeof(*t_send));
+	lat = calloc(nr_events, sizeof(*lat));
+	if (t_send == NULL || lat == NULL || nr_events <= 0) {
+		printf("Invalid number of events\n");
+		return -1;
+	}
+
+	dev_fd = open(DEV_PATH, O_RDWR);
+	if (dev_fd < 0) {
+		printf("Can't open device file\n");
+		return -1;
+	}
+
+	start = now_ns();
+	if (strcmp(argv[1], "signal") == 0)
+		ret = run_signal();
+	else if (strcmp(argv[1], "eventfd") == 0)
+		ret = run_eventfd();
+	else if (strcmp(argv[1], "read") == 0)
+		ret = run_read();
+	else
+		ret = -1;
+
+	if (ret == 0)
+		report(argv[1], last_recv - start);
+
+	close(dev_fd);
+	return ret;
+}
+
+/* Private function definitions */
+uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void *producer_fn(void *arg)
+{
+	char buf[16];
+	int i, n;
+
+	for (i = 0; i < nr_events; i++) {
+		n = snprintf(buf, sizeof(buf), "%d", i);
+		__atomic_store_n(&t_send[i], now_ns(), __ATOMIC_RELEASE);
+		if (write(dev_fd, buf, n) < 0)
+			break;
+	}
+	return NULL;
+}
+
+void record(int32_t seq)
+{
+	uint64_t sent;
+
+	if (seq < 0 || seq >= nr_events)
+		return;
+
+	sent = __atomic_load_n(&t_send[seq], __ATOMIC_ACQUIRE);
+	last_recv = now_ns();
+	lat[received++] = last_recv - sent;
+}
+
+int run_signal(void)
+{
+	sigset_t set;
+	siginfo_t info;
+	struct timespec timeout = { .tv_sec = IDLE_TIMEOUT_MS / 1000 };
+	pthread_t producer;
+
+	/* Block before spawning, so only sigtimedwait() consumes SIGETX */
+	sigemptyset(&set);
+	sigaddset(&set, SIGETX);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	if (ioctl(dev_fd, REG_CURRENT_TASK, NULL)) {
+		printf("Failed call to ioctl\n");
+		return -1;
+	}
+
+	pthread_create(&producer, NULL, producer_fn, NULL);
+	while (received < nr_events) {
+		if (sigtimedwait(&set, &info, &timeout) < 0) {
+			if (errno == EINTR)
+				continue;
+			break; /* idle: the rest was lost */
+		}
+		record(info.si_int);
+	}
+	pthread_join(producer, NULL);
+
+	return 0;
+}
+
+int run_eventfd(void)
+{
+	struct alm_ring *ring;
+	struct epoll_event ev;
+	uint32_t head, tail, dropped;
+	uint64_t count;
+	pthread_t producer;
+	int32_t efd_arg;
+	int efd, epfd;
+
+	ring = mmap(NULL, sizeof(*ring), PROT_READ | PROT_WRITE, MAP_SHARED,
+		    dev_fd, 0);
+	if (ring == MAP_FAILED) {
+		printf("Can't map payload ring\n");
+		return -1;
+	}
+
+	efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	ev.events = EPOLLIN;
+	ev.data.fd = efd;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, efd, &ev);
+
+	efd_arg = efd;
+	if (ioctl(dev_fd, REG_EVENTFD, &efd_arg)) {
+		printf("Failed call to ioctl\n");
+		return -1;
+	}
+
+	ring->tail = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	dropped = ring->dropped;
+
+	pthread_create(&producer, NULL, producer_fn, NULL);
+	while (received < nr_events) {
+		if (epoll_wait(epfd, &ev, 1, IDLE_TIMEOUT_MS) <= 0)
+			break; /* idle: the rest was lost */
+
+		if (read(efd, &count, sizeof(count)) != sizeof(count))
+			continue;
+
+		/* one wakeup drains every queued payload */
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		for (tail = ring->tail; tail != head; tail++)
+			record(ring->data[tail & (ALM_RING_SIZE - 1)].value);
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+	}
+	pthread_join(producer, NULL);
+
+	printf("ring dropped: %u\n", ring->dropped - dropped);
+
+	ioctl(dev_fd, UNREG_EVENTFD);
+	munmap(ring, sizeof(*ring));
+	close(epfd);
+	close(efd);
+	return 0;
+}
+
+int run_read(void)
+{
+	struct alm_event evts[ALM_RING_SIZE];
+	struct pollfd pfd = { .fd = dev_fd, .events = POLLIN };
+	pthread_t producer;
+	ssize_t n;
+	int i;
+
+	pthread_create(&producer, NULL, producer_fn, NULL);
+	while (received < nr_events) {
+		if (poll(&pfd, 1, IDLE_TIMEOUT_MS) <= 0)
+			break; /* idle: the rest was lost */
+
+		n = read(dev_fd, evts, sizeof(evts));
+		for (i = 0; i < n / (ssize_t)sizeof(evts[0]); i++)
+			record(evts[i].value);
+	}
+	pthread_join(producer, NULL);
+
+	return 0;
+}
+
+int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+void report(const char *mode, uint64_t elapsed)
+{
+	uint64_t sum = 0;
+	int i;
+
+	printf("mode:     %s\n", mode);
+	printf("sent:     %d\n", nr_events);
+	printf("received: %d\n", received);
+	printf("lost:     %d\n", nr_events - received);
+	if (received == 0)
+		return;
+	printf("rate:     %.0f ev/s\n", received * 1e9 / elapsed);
+
+	qsort(lat, received, sizeof(*lat), cmp_u64);
+	for (i = 0; i < received; i++)
+		sum += lat[i];
+
+	printf("lat_avg:  %lu ns\n", (unsigned long)(sum / received));
+	printf("lat_p50:  %lu ns\n", (unsigned long)lat[received / 2]);
+	printf("lat_p99:  %lu ns\n",
+	       (unsigned long)lat[(uint64_t)received * 99 / 100]);
+	printf("lat_max:  %lu ns\n", (unsigned long)lat[received - 1]);
+}
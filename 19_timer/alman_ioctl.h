@@ -0,0 +1,40 @@
+#ifndef __ALMAN_IOCTL_H__
+#define __ALMAN_IOCTL_H__
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/* Shared between the driver and the userspace apps */
+#define ALM_TMR_SLACK_DEFAULT 0xffffffffU /* use the fd's slack */
+#define ALM_TMR_DEFERRABLE 0x1 /* don't wake an idle CPU for it */
+
+/*
+ * Arm or re-arm the timer identified by cookie. The first expiry is
+ * timeout_ms from now, then every interval_ms (0 for one-shot). The
+ * expiry may be pushed up to slack_ms later so nearby timers share a
+ * timer wheel tick.
+ */
+struct alm_tmr_arm {
+	__u64 cookie;
+	__u32 timeout_ms;
+	__u32 interval_ms;
+	__u32 slack_ms;
+	__u32 flags;
+};
+
+/*
+ * Read from the device as an array. overruns is the number of expiries
+ * merged into this record since it was last read (at least 1).
+ */
+struct alm_tmr_expiry {
+	__u64 cookie;
+	__u32 overruns;
+	__u32 reserved;
+};
+
+#define TMR_ARM _IOW('a', 'a', struct alm_tmr_arm)
+#define TMR_REARM _IOW('a', 'b', struct alm_tmr_arm)
+#define TMR_CANCEL _IOW('a', 'c', __u64)
+#define TMR_SET_SLACK _IOW('a', 'd', __u32)
+
+#endif /* __ALMAN_IOCTL_H__ */
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include "alman_ioctl.h"
+
+/*
+ * Usage: ./app [timers] [slack_ms] [seconds]
+ *
+ * Arms periodic timers with intervals spread over 100..1099 ms on one fd,
+ * then counts how many expiries and how many wakeups it took to consume
+ * them. A larger slack lets the driver coalesce expiries, so the same
+ * work costs fewer wakeups.
+ */
+
+#define DEV_PATH "/dev/alman_device"
+
+/* Private function prototypes */
+static uint64_t now_ms(void);
+
+/* Main function */
+int main(int argc, char *argv[])
+{
+	struct alm_tmr_expiry exp[256];
+	struct alm_tmr_arm arm;
+	struct pollfd pfd;
+	uint64_t expiries = 0, wakeups = 0, deadline;
+	uint32_t slack = 0;
+	int fd, i, n, nr_timers = 1000, seconds = 5;
+
+	if (argc > 1)
+		nr_timers = atoi(argv[1]);
+	if (argc > 2)
+		slack = atoi(argv[2]);
+	if (argc > 3)
+		seconds = atoi(argv[3]);
+
+	fd = open(DEV_PATH, O_RDWR | O_NONBLOCK);
+	if (fd < 0) {
+		printf("Can't open device file\n");
+		return -1;
+	}
+
+	if (ioctl(fd, TMR_SET_SLACK, &slack)) {
+		printf("Failed call to ioctl\n");
+		close(fd);
+		return -1;
+	}
+
+	memset(&arm, 0, sizeof(arm));
+	arm.slack_ms = ALM_TMR_SLACK_DEFAULT;
+	for (i = 0; i < nr_timers; i++) {
+		arm.cookie = i;
+		arm.interval_ms = 100 + i % 1000;
+		arm.timeout_ms = arm.interval_ms;
+		if (ioctl(fd, TMR_ARM, &arm)) {
+			printf("Can't arm timer %d: %s\n", i, strerror(errno));
+			close(fd);
+			return -1;
+		}
+	}
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	deadline = now_ms() + seconds * 1000ULL;
+	while (now_ms() < deadline) {
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+
+		wakeups++;
+		while ((n = read(fd, exp, sizeof(exp))) > 0) {
+			for (i = 0; i < n / (int)sizeof(exp[0]); i++)
+				expiries += exp[i].overruns;
+		}
+	}
+
+	/* every timer is cancelled on close */
+	close(fd);
+
+	printf("timers:   %d\n", nr_timers);
+	printf("slack:    %u ms\n", slack);
+	printf("expiries: %llu\n", (unsigned long long)expiries);
+	printf("wakeups:  %llu\n", (unsigned long long)wakeups);
+	if (wakeups)
+		printf("batch:    %.1f expiries/wakeup\n",
+		       (double)expiries / wakeups);
+	return 0;
+}
+
+/* Private function definitions */
+uint64_t now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
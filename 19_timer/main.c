@@ -3,16 +3,18 @@
 #include <linux/fs.h>
 #include <linux/cdev.h>
 #include <linux/device.h>
-// #include <linux/slab.h>
-#include <linux/ktime.h>
-#include <linux/hrtimer.h>
+#include <linux/slab.h>
+#include <linux/poll.h>
+#include <linux/uaccess.h>
+#include "tsched.h"
 
 /* Private macros */
 #define MOD_NAME "alman"
 #define DEV_INFO KERN_INFO MOD_NAME ": "
 
-#define TIM_INTERVAL_NS (1000000000L)
-#define TIM_INTERVAL_S (4)
+#define USE_DYNAMIC 1
+#define TIM_INTERVAL_MS (4000)
+#define EXP_BATCH (16) /* expiry records copied per lock round */
 
 /* Private variables */
 struct alm_dev {
@@ -24,6 +26,15 @@ struct alm_dev {
 static struct alm_dev alman = { 0 };
 static unsigned int count = 0;
 
+/* Module parameters */
+static unsigned int max_timers = 16384;
+module_param(max_timers, uint, 0644);
+MODULE_PARM_DESC(max_timers, "Timers per open file");
+
+static unsigned int slack_ms = 0;
+module_param(slack_ms, uint, 0644);
+MODULE_PARM_DESC(slack_ms, "Default coalescing window of a new open file");
+
 /* Module prototypes */
 static int __init alm_init(void);
 static void __exit alm_exit(void);
@@ -34,6 +45,8 @@ static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off);
 static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
 			 loff_t *off);
+static __poll_t alm_poll(struct file *filp, struct poll_table_struct *wait);
+static long alm_ioctl(struct file *filp, unsigned int cmd, unsigned long arg);
 /* Timer prototypes */
 static void timer_fn(struct timer_list *data);
 
@@ -41,8 +54,10 @@ static struct file_operations fops = {
 	.owner = THIS_MODULE,
 	.read = alm_read,
 	.write = alm_write,
+	.poll = alm_poll,
 	.open = alm_open,
 	.release = alm_release,
+	.unlocked_ioctl = alm_ioctl,
 };
 
 #if USE_DYNAMIC
@@ -62,14 +77,18 @@ static void timer_fn(struct timer_list *data)
 	mod_timer(&alm_timer, jiffies + msecs_to_jiffies(TIM_INTERVAL_MS));
 }
 /*
-** This function is called on device file open 
+** This function is called on device file open, every open file gets
+** its own timer scheduler
 */
 static int alm_open(struct inode *inode, struct file *filp)
 {
-	struct alm_dev *dev;
+	struct tsched *ts;
 
-	dev = container_of(&inode->i_cdev, struct alm_dev, cdev);
-	filp->private_data = dev;
+	if ((ts = kzalloc(sizeof(*ts), GFP_KERNEL)) == NULL)
+		return -ENOMEM;
+
+	tsched_init(ts, READ_ONCE(max_timers), READ_ONCE(slack_ms));
+	filp->private_data = ts;
 
 	pr_info(DEV_INFO "Driver open() called\n");
 	return 0;
@@ -80,42 +99,104 @@ static int alm_open(struct inode *inode, struct file *filp)
 */
 static int alm_release(struct inode *inode, struct file *filp)
 {
+	struct tsched *ts = filp->private_data;
+
+	tsched_destroy(ts);
+	kfree(ts);
+
 	pr_info(DEV_INFO "Driver release() called\n");
 	return 0;
 }
 
 /*
-** This function is called on device file read 
+** This function is called on device file read, it returns an array of
+** struct alm_tmr_expiry and blocks until one is available
 */
 static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off)
 {
-	pr_info(DEV_INFO "Driver read() called\n");
-	return 0;
+	struct tsched *ts = filp->private_data;
+	struct alm_tmr_expiry exp[EXP_BATCH];
+	size_t max = len / sizeof(exp[0]);
+	size_t count = 0;
+	int n;
+
+	if (max == 0)
+		return -EINVAL;
+
+	while (!tsched_has_expired(ts)) {
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		if (wait_event_interruptible(ts->wait, tsched_has_expired(ts)))
+			return -ERESTARTSYS;
+	}
+
+	while (count < max) {
+		n = tsched_pop(ts, exp, min_t(size_t, max - count, EXP_BATCH));
+		if (n == 0)
+			break;
+		if (copy_to_user(buf + count * sizeof(exp[0]), exp,
+				 n * sizeof(exp[0])))
+			return -EFAULT;
+		count += n;
+	}
+
+	return count * sizeof(exp[0]);
 }
 
 /*
-** This function is called on device file write 
+** This function is called on device file write
 */
 static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
 			 loff_t *off)
 {
-	// struct alm_dev *dev;
-	// uint8_t *buffer;
-
-	// dev = (struct alm_dev *)filp->private_data;
-
 	pr_info(DEV_INFO "Driver write() called\n");
+	return len;
+}
 
-	// if ((buffer = kmalloc(len, GFP_KERNEL)) == NULL)
-	// 	return -ENOMEM;
-
-	// if (copy_from_user(buffer, buf, len))
-	// 	return -EFAULT;
+static __poll_t alm_poll(struct file *filp, struct poll_table_struct *wait)
+{
+	struct tsched *ts = filp->private_data;
 
-	/* Do something with kernel buffer */
+	poll_wait(filp, &ts->wait, wait);
+	return tsched_has_expired(ts) ? EPOLLIN | EPOLLRDNORM : 0;
+}
 
-	return len;
+static long alm_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+	struct tsched *ts = filp->private_data;
+	void __user *argp = (void __user *)arg;
+	struct alm_tmr_arm arm;
+	u64 cookie;
+	u32 slack;
+
+	switch (cmd) {
+	case TMR_ARM:
+	case TMR_REARM:
+		if (copy_from_user(&arm, argp, sizeof(arm)))
+			return -EFAULT;
+		if (arm.flags & ~ALM_TMR_DEFERRABLE)
+			return -EINVAL;
+
+		if (cmd == TMR_ARM)
+			return tsched_arm(ts, &arm);
+		return tsched_rearm(ts, &arm);
+
+	case TMR_CANCEL:
+		if (get_user(cookie, (u64 __user *)argp))
+			return -EFAULT;
+		return tsched_cancel(ts, cookie);
+
+	case TMR_SET_SLACK:
+		if (get_user(slack, (u32 __user *)argp))
+			return -EFAULT;
+
+		WRITE_ONCE(ts->slack_ms, slack);
+		return 0;
+
+	default:
+		return -ENOTTY;
+	}
 }
 
 /*
@@ -131,18 +212,24 @@ static int __init alm_init(void)
 	printk(DEV_INFO "Major = %d, Minor = %d\n", MAJOR(alman.devno),
 	       MINOR(alman.devno));
 
+	/* Slab of the scheduled timers */
+	if (tsched_cache_create() < 0) {
+		pr_err(DEV_INFO "Can't create timer cache\n");
+		goto r_major;
+	}
+
 	/* Create struct chardev */
 	// cdev_init(&alman.cdev, &fops);
 	if ((alman.cdev = cdev_alloc()) == NULL) {
 		pr_err(DEV_INFO "Can't allocate cdev\n");
-		goto r_major;
+		goto r_cache;
 	}
 	alman.cdev->ops = &fops;
 
 	/* Add chardev to kernel */
 	if (cdev_add(alman.cdev, alman.devno, 1) < 0) {
 		pr_err(DEV_INFO "Can't add chardev to the system\n");
-		goto r_major;
+		goto r_cache;
 	}
 
 	/* Create struct class */
@@ -174,6 +261,8 @@ r_class:
 	class_destroy(alman.class);
 r_cdev:
 	cdev_del(alman.cdev);
+r_cache:
+	tsched_cache_destroy();
 r_major:
 	unregister_chrdev_region(alman.devno, 1);
 
@@ -185,11 +274,12 @@ r_major:
 */
 static void __exit alm_exit(void)
 {
-	del_timer(&alm_timer);
+	del_timer_sync(&alm_timer);
 
 	device_destroy(alman.class, alman.devno);
 	class_destroy(alman.class);
 	cdev_del(alman.cdev);
+	tsched_cache_destroy();
 	unregister_chrdev_region(alman.devno, 1);
 
 	printk(DEV_INFO "Driver removed\n");
@@ -0,0 +1,301 @@
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/jiffies.h>
+#include <linux/bitops.h>
+#include "tsched.h"
+
+/* Private types */
+struct tsched_timer {
+	struct timer_list timer;
+	struct hlist_node node;
+	struct list_head expired; /* empty unless waiting to be read */
+	struct tsched *ts;
+	u64 cookie;
+	unsigned long nominal; /* expiry before slack, keeps periods exact */
+	unsigned long interval;
+	unsigned long slack;
+	u32 overruns;
+	bool cancelled;
+};
+
+/* Private variables */
+static struct kmem_cache *tsched_cache;
+
+/* Function implementations */
+/*
+ * tsched_apply_slack - pick the roundest jiffy in [expires, expires + slack]
+ *
+ * Keeps every bit above the highest one differing between both ends, so
+ * timers with overlapping windows end up on the same jiffy and in the
+ * same timer wheel bucket, then expire in one softirq run.
+ */
+static unsigned long tsched_apply_slack(unsigned long expires,
+					unsigned long slack)
+{
+	unsigned long limit = expires + slack;
+	unsigned long mask = expires ^ limit;
+
+	if (mask == 0)
+		return expires;
+
+	mask = (1UL << __fls(mask)) - 1;
+	return limit & ~mask;
+}
+
+static struct tsched_timer *tsched_find(struct tsched *ts, u64 cookie)
+{
+	struct tsched_timer *t;
+
+	hash_for_each_possible (ts->timers, t, node, cookie) {
+		if (t->cookie == cookie)
+			return t;
+	}
+	return NULL;
+}
+
+static void tsched_timer_fn(struct timer_list *tl)
+{
+	struct tsched_timer *t = from_timer(t, tl, timer);
+	struct tsched *ts = t->ts;
+	bool wake = false;
+
+	spin_lock(&ts->lock);
+	/* cancelled, or re-armed while we were waiting for the lock */
+	if (t->cancelled || timer_pending(&t->timer))
+		goto out;
+
+	if (t->overruns++ == 0) {
+		list_add_tail(&t->expired, &ts->expired);
+		wake = true;
+	}
+
+	if (t->interval) {
+		/* periods missed while the CPU was busy count as overruns */
+		t->nominal += t->interval;
+		while (time_before_eq(t->nominal, jiffies)) {
+			t->nominal += t->interval;
+			t->overruns++;
+		}
+		mod_timer(&t->timer, tsched_apply_slack(t->nominal, t->slack));
+	}
+out:
+	spin_unlock(&ts->lock);
+
+	if (wake)
+		wake_up_interruptible(&ts->wait);
+}
+
+/*
+ * tsched_start - (re)program a timer, called with ts->lock held
+ */
+static void tsched_start(struct tsched *ts, struct tsched_timer *t,
+			 const struct alm_tmr_arm *arm)
+{
+	unsigned int slack_ms = arm->slack_ms;
+
+	if (slack_ms == ALM_TMR_SLACK_DEFAULT)
+		slack_ms = ts->slack_ms;
+
+	/* a pending expiry of the previous arming is superseded */
+	list_del_init(&t->expired);
+	t->overruns = 0;
+
+	t->interval = msecs_to_jiffies(arm->interval_ms);
+	t->slack = msecs_to_jiffies(slack_ms);
+	t->nominal = jiffies + msecs_to_jiffies(arm->timeout_ms);
+	mod_timer(&t->timer, tsched_apply_slack(t->nominal, t->slack));
+}
+
+/*
+ * tsched_unlink - detach a timer from lookup and delivery, called with
+ * ts->lock held. The caller must then tsched_free() it.
+ */
+static void tsched_unlink(struct tsched *ts, struct tsched_timer *t)
+{
+	hash_del(&t->node);
+	list_del_init(&t->expired);
+	t->cancelled = true;
+	ts->nr_timers--;
+}
+
+static void tsched_free(struct tsched_timer *t)
+{
+	del_timer_sync(&t->timer);
+	kmem_cache_free(tsched_cache, t);
+}
+
+/**
+ * tsched_cache_create - create the slab every timer is allocated from
+ *
+ * Return: 0 or -ENOMEM
+ */
+int tsched_cache_create(void)
+{
+	tsched_cache = KMEM_CACHE(tsched_timer, 0);
+	return tsched_cache ? 0 : -ENOMEM;
+}
+
+void tsched_cache_destroy(void)
+{
+	kmem_cache_destroy(tsched_cache);
+}
+
+void tsched_init(struct tsched *ts, unsigned int max_timers,
+		 unsigned int slack_ms)
+{
+	hash_init(ts->timers);
+	INIT_LIST_HEAD(&ts->expired);
+	spin_lock_init(&ts->lock);
+	init_waitqueue_head(&ts->wait);
+	ts->nr_timers = 0;
+	ts->max_timers = max_timers;
+	ts->slack_ms = slack_ms;
+}
+
+/**
+ * tsched_destroy - cancel and free every timer
+ */
+void tsched_destroy(struct tsched *ts)
+{
+	struct tsched_timer *t, *tmp;
+	struct hlist_node *n;
+	LIST_HEAD(dead);
+	int bkt;
+
+	spin_lock_bh(&ts->lock);
+	hash_for_each_safe (ts->timers, bkt, n, t, node) {
+		tsched_unlink(ts, t);
+		list_add(&t->expired, &dead);
+	}
+	spin_unlock_bh(&ts->lock);
+
+	list_for_each_entry_safe (t, tmp, &dead, expired)
+		tsched_free(t);
+}
+
+/**
+ * tsched_arm - register a new timer
+ *
+ * Return: 0, -EEXIST if the cookie is in use, -ENOSPC over max_timers
+ */
+int tsched_arm(struct tsched *ts, const struct alm_tmr_arm *arm)
+{
+	struct tsched_timer *t;
+	int err = 0;
+
+	if ((t = kmem_cache_zalloc(tsched_cache, GFP_KERNEL)) == NULL)
+		return -ENOMEM;
+
+	timer_setup(&t->timer, tsched_timer_fn,
+		    arm->flags & ALM_TMR_DEFERRABLE ? TIMER_DEFERRABLE : 0);
+	INIT_LIST_HEAD(&t->expired);
+	t->ts = ts;
+	t->cookie = arm->cookie;
+
+	spin_lock_bh(&ts->lock);
+	if (ts->nr_timers >= ts->max_timers)
+		err = -ENOSPC;
+	else if (tsched_find(ts, arm->cookie))
+		err = -EEXIST;
+	else {
+		hash_add(ts->timers, &t->node, t->cookie);
+		ts->nr_timers++;
+		tsched_start(ts, t, arm);
+	}
+	spin_unlock_bh(&ts->lock);
+
+	if (err)
+		kmem_cache_free(tsched_cache, t);
+	return err;
+}
+
+/**
+ * tsched_rearm - reprogram an existing timer, its flags are kept
+ *
+ * Return: 0 or -ENOENT
+ */
+int tsched_rearm(struct tsched *ts, const struct alm_tmr_arm *arm)
+{
+	struct tsched_timer *t;
+	int err = 0;
+
+	spin_lock_bh(&ts->lock);
+	if ((t = tsched_find(ts, arm->cookie)) != NULL)
+		tsched_start(ts, t, arm);
+	else
+		err = -ENOENT;
+	spin_unlock_bh(&ts->lock);
+
+	return err;
+}
+
+/**
+ * tsched_cancel - stop and free a timer, dropping any unread expiry
+ *
+ * Return: 0 or -ENOENT
+ */
+int tsched_cancel(struct tsched *ts, u64 cookie)
+{
+	struct tsched_timer *t;
+
+	spin_lock_bh(&ts->lock);
+	if ((t = tsched_find(ts, cookie)) != NULL)
+		tsched_unlink(ts, t);
+	spin_unlock_bh(&ts->lock);
+
+	if (t == NULL)
+		return -ENOENT;
+
+	tsched_free(t);
+	return 0;
+}
+
+/**
+ * tsched_pop - dequeue up to @max expiries
+ *
+ * One-shot timers are released once their expiry has been read, the
+ * cookie can be armed again afterward.
+ *
+ * Return: number of records stored in @exp
+ */
+int tsched_pop(struct tsched *ts, struct alm_tmr_expiry *exp, int max)
+{
+	struct tsched_timer *t, *tmp;
+	LIST_HEAD(dead);
+	int n = 0;
+
+	spin_lock_bh(&ts->lock);
+	while (n < max && !list_empty(&ts->expired)) {
+		t = list_first_entry(&ts->expired, struct tsched_timer,
+				     expired);
+		list_del_init(&t->expired);
+
+		exp[n].cookie = t->cookie;
+		exp[n].overruns = t->overruns;
+		exp[n].reserved = 0;
+		t->overruns = 0;
+		n++;
+
+		if (t->interval == 0) {
+			tsched_unlink(ts, t);
+			list_add(&t->expired, &dead);
+		}
+	}
+	spin_unlock_bh(&ts->lock);
+
+	list_for_each_entry_safe (t, tmp, &dead, expired)
+		tsched_free(t);
+
+	return n;
+}
+
+bool tsched_has_expired(struct tsched *ts)
+{
+	bool ret;
+
+	spin_lock_bh(&ts->lock);
+	ret = !list_empty(&ts->expired);
+	spin_unlock_bh(&ts->lock);
+
+	return ret;
+}
@@ -0,0 +1,40 @@
+#ifndef __TSCHED_H__
+#define __TSCHED_H__
+
+#include <linux/timer.h>
+#include <linux/hashtable.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include "alman_ioctl.h"
+
+#define TSCHED_HASH_BITS (10)
+
+/*
+ * Timer scheduler of one open file. Every timeout is a plain timer_list
+ * on the kernel timer wheel, looked up by cookie. Expired timers are
+ * queued once on the expired list until read, later expiries of a queued
+ * timer are merged into its overrun count.
+ */
+struct tsched {
+	DECLARE_HASHTABLE(timers, TSCHED_HASH_BITS);
+	struct list_head expired;
+	spinlock_t lock; /* protects everything, taken from timer softirq */
+	wait_queue_head_t wait;
+	unsigned int nr_timers;
+	unsigned int max_timers;
+	unsigned int slack_ms;
+};
+
+/* exported functions */
+int tsched_cache_create(void);
+void tsched_cache_destroy(void);
+void tsched_init(struct tsched *ts, unsigned int max_timers,
+		 unsigned int slack_ms);
+void tsched_destroy(struct tsched *ts);
+int tsched_arm(struct tsched *ts, const struct alm_tmr_arm *arm);
+int tsched_rearm(struct tsched *ts, const struct alm_tmr_arm *arm);
+int tsched_cancel(struct tsched *ts, u64 cookie);
+int tsched_pop(struct tsched *ts, struct alm_tmr_expiry *exp, int max);
+bool tsched_has_expired(struct tsched *ts);
+
+#endif /* __TSCHED_H__ */
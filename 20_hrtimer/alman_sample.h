@@ -0,0 +1,17 @@
+#ifndef __ALMAN_SAMPLE_H__
+#define __ALMAN_SAMPLE_H__
+
+#include <linux/types.h>
+
+/*
+ * Shared between the driver and the userspace apps, read() returns an
+ * array of it. value is the GPIO level, or the per-CPU sample counter
+ * when no GPIO is configured.
+ */
+struct alm_sample {
+	__u64 ts_ns; /* CLOCK_MONOTONIC of the callback */
+	__u32 cpu;
+	__s32 value;
+};
+
+#endif /* __ALMAN_SAMPLE_H__ */
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include "alman_sample.h"
+
+/*
+ * Usage: ./app [seconds]
+ *
+ * Starts the sampler, drains samples for the given time, stops it and
+ * prints the rate and the largest gap between two samples of each CPU.
+ * The expiry jitter histogram is in /sys/kernel/debug/alman_sampler.
+ */
+
+#define DEV_PATH "/dev/alman_device"
+#define MAX_CPUS 256
+
+/* Private variables */
+static struct alm_sample buf[4096];
+static uint64_t count[MAX_CPUS], last[MAX_CPUS], max_gap[MAX_CPUS];
+
+/* Main function */
+int main(int argc, char *argv[])
+{
+	struct timespec ts;
+	uint64_t gap;
+	time_t deadline;
+	ssize_t n;
+	int fd, i, cpu, seconds = 5;
+
+	if (argc > 1)
+		seconds = atoi(argv[1]);
+	if (seconds <= 0)
+		seconds = 1;
+
+	fd = open(DEV_PATH, O_RDWR);
+	if (fd < 0) {
+		printf("Can't open device file\n");
+		return -1;
+	}
+
+	if (write(fd, "1", 1) < 0) {
+		printf("Can't start sampler\n");
+		close(fd);
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	deadline = ts.tv_sec + seconds;
+	do {
+		n = read(fd, buf, sizeof(buf));
+		for (i = 0; i < n / (ssize_t)sizeof(buf[0]); i++) {
+			cpu = buf[i].cpu;
+			if (cpu >= MAX_CPUS)
+				continue;
+
+			gap = last[cpu] ? buf[i].ts_ns - last[cpu] : 0;
+			if (gap > max_gap[cpu])
+				max_gap[cpu] = gap;
+			last[cpu] = buf[i].ts_ns;
+			count[cpu]++;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+	} while (n > 0 && ts.tv_sec < deadline);
+
+	/* drain what was sampled until the stop */
+	write(fd, "0", 1);
+	while (read(fd, buf, sizeof(buf)) > 0)
+		;
+	close(fd);
+
+	printf("%4s %12s %12s %14s\n", "cpu", "samples", "rate/s",
+	       "max_gap_ns");
+	for (cpu = 0; cpu < MAX_CPUS; cpu++) {
+		if (count[cpu] == 0)
+			continue;
+		printf("%4d %12lu %12lu %14lu\n", cpu,
+		       (unsigned long)count[cpu],
+		       (unsigned long)(count[cpu] / seconds),
+		       (unsigned long)max_gap[cpu]);
+	}
+	return 0;
+}
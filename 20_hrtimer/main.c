@@ -3,16 +3,16 @@
 #include <linux/fs.h>
 #include <linux/cdev.h>
 #include <linux/device.h>
-// #include <linux/slab.h>
-#include <linux/kthread.h>
-#include <linux/completion.h>
+#include <linux/gpio.h>
+#include <linux/poll.h>
+#include <linux/debugfs.h>
+#include <linux/uaccess.h>
+#include "sampler.h"
 
 /* Private macros */
 #define MOD_NAME "alman"
 #define DEV_INFO KERN_INFO MOD_NAME ": "
 
-#define USE_DYNAMIC 1
-
 /* Private variables */
 struct alm_dev {
 	dev_t devno;
@@ -21,15 +21,21 @@ struct alm_dev {
 };
 
 static struct alm_dev alman = { 0 };
+static struct sampler alm_sampler;
+static struct dentry *alm_debugfs;
+
+/* Module parameters */
+static unsigned int period_us = 100;
+module_param(period_us, uint, 0644);
+MODULE_PARM_DESC(period_us, "Sampling period, at least 10 us");
 
-static uint32_t read_count = 0;
-static int completion_flag = 0;
-static struct task_struct *wait_thread;
-#if USE_DYNAMIC
-static struct completion data_read_done;
-#else
-static DECLARE_COMPLETION(data_read_done);
-#endif
+static int sample_gpio = -1;
+module_param(sample_gpio, int, 0444);
+MODULE_PARM_DESC(sample_gpio, "Input to sample, -1 samples a counter");
+
+static unsigned int wake_batch = 64;
+module_param(wake_batch, uint, 0644);
+MODULE_PARM_DESC(wake_batch, "Samples per reader wakeup");
 
 /* Module prototypes */
 static int __init alm_init(void);
@@ -41,48 +47,24 @@ static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off);
 static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
 			 loff_t *off);
-/* Thread prototypes */
-static int wait_fn(void *unused);
+static __poll_t alm_poll(struct file *filp, struct poll_table_struct *wait);
 
 static struct file_operations fops = {
 	.owner = THIS_MODULE,
 	.read = alm_read,
 	.write = alm_write,
+	.poll = alm_poll,
 	.open = alm_open,
 	.release = alm_release,
 };
 
 /* Function implementations */
-static int wait_fn(void *unused)
-{
-	while (!kthread_should_stop()) {
-		pr_info(DEV_INFO "wait_fn: Wait for event...\n");
-
-		wait_for_completion(&data_read_done);
-		if (completion_flag == 2) {
-			pr_info(DEV_INFO "wait_fn: got event from exit func\n");
-			goto quit;
-		}
-
-		pr_info(DEV_INFO "wait_fn: got event from read func %d\n",
-			read_count++);
-		completion_flag = 0;
-	}
-
-quit:
-	do_exit(0);
-	return 0;
-}
-
 /*
-** This function is called on device file open 
+** This function is called on device file open
 */
 static int alm_open(struct inode *inode, struct file *filp)
 {
-	struct alm_dev *dev;
-
-	dev = container_of(&inode->i_cdev, struct alm_dev, cdev);
-	filp->private_data = dev;
+	filp->private_data = &alm_sampler;
 
 	pr_info(DEV_INFO "Driver open() called\n");
 	return 0;
@@ -98,43 +80,62 @@ static int alm_release(struct inode *inode, struct file *filp)
 }
 
 /*
-** This function is called on device file read 
+** This function is called on device file read, it returns an array of
+** struct alm_sample gathered from every CPU. A blocking read waits for
+** wake_batch samples, or returns 0 once sampling is stopped and drained.
 */
 static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off)
 {
-	pr_info(DEV_INFO "Driver read() called\n");
+	struct sampler *s = filp->private_data;
+	ssize_t ret;
 
-	completion_flag = 1;
-	if (!completion_done(&data_read_done)) {
-		complete(&data_read_done);
-	}
+	if (len < sizeof(struct alm_sample))
+		return -EINVAL;
 
-	return 0;
+	if (!(filp->f_flags & O_NONBLOCK) &&
+	    wait_event_interruptible(s->wait, sampler_ready(s)))
+		return -ERESTARTSYS;
+
+	ret = sampler_read(s, buf, len);
+	if (ret == 0 && (filp->f_flags & O_NONBLOCK) && READ_ONCE(s->running))
+		return -EAGAIN;
+	return ret;
 }
 
 /*
-** This function is called on device file write 
+** This function is called on device file write, "1" starts sampling with
+** the current module parameters and "0" stops it
 */
 static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
 			 loff_t *off)
 {
-	// struct alm_dev *dev;
-	// uint8_t *buffer;
-
-	// dev = (struct alm_dev *)filp->private_data;
-
-	pr_info(DEV_INFO "Driver write() called\n");
-
-	// if ((buffer = kmalloc(len, GFP_KERNEL)) == NULL)
-	// 	return -ENOMEM;
+	struct sampler *s = filp->private_data;
+	u64 period_ns = (u64)READ_ONCE(period_us) * NSEC_PER_USEC;
+	bool start;
+	int err;
+
+	if ((err = kstrtobool_from_user(buf, len, &start)) < 0)
+		return err;
+
+	if (start) {
+		err = sampler_start(s, period_ns, sample_gpio,
+				    READ_ONCE(wake_batch));
+		if (err < 0)
+			return err;
+	} else {
+		sampler_stop(s);
+	}
 
-	// if (copy_from_user(buffer, buf, len))
-	// 	return -EFAULT;
+	return len;
+}
 
-	/* Do something with kernel buffer */
+static __poll_t alm_poll(struct file *filp, struct poll_table_struct *wait)
+{
+	struct sampler *s = filp->private_data;
 
-	return len;
+	poll_wait(filp, &s->wait, wait);
+	return sampler_ready(s) ? EPOLLIN | EPOLLRDNORM : 0;
 }
 
 /*
@@ -156,7 +157,6 @@ static int __init alm_init(void)
 		pr_err(DEV_INFO "Can't allocate cdev\n");
 		goto r_major;
 	}
-	alman.cdev->owner = THIS_MODULE;
 	alman.cdev->ops = &fops;
 
 	/* Add chardev to kernel */
@@ -179,21 +179,37 @@ static int __init alm_init(void)
 		goto r_class;
 	}
 
-	/* Kernel thread: Create & Wakeup */
-	if ((wait_thread = kthread_run(wait_fn, NULL, "wait_thread")) == NULL) {
-		pr_info(DEV_INFO "Can't create thread\n");
-		goto r_dev;
+	/* Optional input, must be readable from the timer callback */
+	if (sample_gpio >= 0) {
+		if (!gpio_is_valid(sample_gpio) ||
+		    gpio_request(sample_gpio, MOD_NAME) < 0) {
+			pr_err(DEV_INFO "Can't request GPIO %d\n", sample_gpio);
+			goto r_device;
+		}
+		if (gpio_direction_input(sample_gpio) < 0 ||
+		    gpio_cansleep(sample_gpio)) {
+			pr_err(DEV_INFO "GPIO %d can't be sampled\n",
+			       sample_gpio);
+			goto r_gpio;
+		}
 	}
 
-	/* Init completion */
-#if USE_DYNAMIC
-	init_completion(&data_read_done);
-#endif
+	/* Sampler setup, started from write() */
+	if (sampler_init(&alm_sampler) < 0) {
+		pr_err(DEV_INFO "Can't allocate sampler\n");
+		goto r_gpio;
+	}
+
+	alm_debugfs = debugfs_create_dir(MOD_NAME "_sampler", NULL);
+	sampler_debugfs(&alm_sampler, alm_debugfs);
 
 	printk(DEV_INFO "Driver inserted\n");
 	return 0;
 
-r_dev:
+r_gpio:
+	if (sample_gpio >= 0)
+		gpio_free(sample_gpio);
+r_device:
 	device_destroy(alman.class, alman.devno);
 r_class:
 	class_destroy(alman.class);
@@ -210,10 +226,10 @@ r_major:
 */
 static void __exit alm_exit(void)
 {
-	completion_flag = 2;
-	if (!completion_done(&data_read_done)) {
-		complete(&data_read_done);
-	}
+	debugfs_remove_recursive(alm_debugfs);
+	sampler_destroy(&alm_sampler);
+	if (sample_gpio >= 0)
+		gpio_free(sample_gpio);
 
 	device_destroy(alman.class, alman.devno);
 	class_destroy(alman.class);
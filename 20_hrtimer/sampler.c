@@ -0,0 +1,349 @@
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/log2.h>
+#include <linux/cpu.h>
+#include <linux/smp.h>
+#include <linux/gpio.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <linux/version.h>
+#include "sampler.h"
+
+/* Private macros */
+/*
+ * Pinned so every CPU owns its ring. The callback wakes readers and reads
+ * the GPIO, both take locks that sleep on PREEMPT_RT, so there it expires
+ * in the softirq thread, and the jitter includes that thread's latency.
+ */
+#ifdef CONFIG_PREEMPT_RT
+#define SMPL_HRTIMER_MODE HRTIMER_MODE_ABS_PINNED_SOFT
+#else
+#define SMPL_HRTIMER_MODE HRTIMER_MODE_ABS_PINNED
+#endif
+
+/* Function implementations */
+static u32 smpl_ring_count(struct smpl_cpu *sc)
+{
+	return smp_load_acquire(&sc->head) - sc->tail;
+}
+
+/*
+ * smpl_account - fold one actual-vs-expected expiry delta into the stats
+ */
+static void smpl_account(struct smpl_cpu *sc, s64 jitter)
+{
+	unsigned int bucket;
+
+	if (jitter < 0)
+		jitter = 0;
+
+	sc->jitter_min = min(sc->jitter_min, jitter);
+	sc->jitter_max = max(sc->jitter_max, jitter);
+	sc->jitter_sum += jitter;
+
+	bucket = min_t(unsigned int, ilog2(jitter + 1), SMPL_HIST_BUCKETS - 1);
+	sc->hist[bucket]++;
+}
+
+static enum hrtimer_restart smpl_timer_fn(struct hrtimer *timer)
+{
+	struct smpl_cpu *sc = container_of(timer, struct smpl_cpu, timer);
+	struct sampler *s = sc->s;
+	ktime_t now = ktime_get();
+	struct alm_sample *e;
+	u64 overruns;
+	s64 jitter;
+	u32 head;
+
+	jitter = ktime_to_ns(ktime_sub(now, hrtimer_get_expires(timer)));
+	smpl_account(sc, jitter);
+
+	head = sc->head;
+	if (head - READ_ONCE(sc->tail) < SMPL_RING_SIZE) {
+		e = &sc->ring[head & (SMPL_RING_SIZE - 1)];
+		e->ts_ns = ktime_to_ns(now);
+		e->cpu = sc->cpu;
+		e->value = s->gpio >= 0 ? gpio_get_value(s->gpio) :
+					  (s32)sc->count;
+		/* publish the sample before the new head */
+		smp_store_release(&sc->head, ++head);
+
+		if ((head & s->wake_mask) == 0)
+			wake_up_interruptible(&s->wait);
+	} else {
+		sc->dropped++;
+	}
+	sc->count++;
+
+	/*
+	 * Drift-free: the expiry moves by whole periods from the previous
+	 * expiry, never from now, so latency of one callback does not shift
+	 * the following ones.
+	 */
+	overruns = hrtimer_forward(timer, now, s->period);
+	if (overruns > 1)
+		sc->missed += overruns - 1;
+
+	return HRTIMER_RESTART;
+}
+
+/*
+ * smpl_start_on_cpu - called by IPI on the CPU the timer is pinned to
+ */
+static void smpl_start_on_cpu(void *info)
+{
+	struct smpl_cpu *sc = info;
+
+	hrtimer_start(&sc->timer, sc->s->start, SMPL_HRTIMER_MODE);
+}
+
+static void smpl_cpu_reset(struct smpl_cpu *sc)
+{
+	sc->head = 0;
+	sc->tail = 0;
+	sc->count = 0;
+	sc->missed = 0;
+	sc->dropped = 0;
+	sc->jitter_min = S64_MAX;
+	sc->jitter_max = 0;
+	sc->jitter_sum = 0;
+	memset(sc->hist, 0, sizeof(sc->hist));
+}
+
+/**
+ * sampler_init - prepare one pinned timer per possible CPU
+ *
+ * Return: 0 or -ENOMEM
+ */
+int sampler_init(struct sampler *s)
+{
+	struct smpl_cpu *sc;
+	int cpu;
+
+	if ((s->pcpu = alloc_percpu(struct smpl_cpu)) == NULL)
+		return -ENOMEM;
+
+	if (!zalloc_cpumask_var(&s->cpus, GFP_KERNEL)) {
+		free_percpu(s->pcpu);
+		return -ENOMEM;
+	}
+
+	for_each_possible_cpu (cpu) {
+		sc = per_cpu_ptr(s->pcpu, cpu);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+		hrtimer_setup(&sc->timer, smpl_timer_fn, CLOCK_MONOTONIC,
+			      SMPL_HRTIMER_MODE);
+#else
+		hrtimer_init(&sc->timer, CLOCK_MONOTONIC, SMPL_HRTIMER_MODE);
+		sc->timer.function = smpl_timer_fn;
+#endif
+		sc->s = s;
+		sc->cpu = cpu;
+	}
+
+	s->running = false;
+	mutex_init(&s->lock);
+	init_waitqueue_head(&s->wait);
+	return 0;
+}
+
+void sampler_destroy(struct sampler *s)
+{
+	int cpu;
+
+	sampler_stop(s);
+
+	/* rings are allocated on the first run of a CPU */
+	for_each_possible_cpu (cpu)
+		kvfree(per_cpu_ptr(s->pcpu, cpu)->ring);
+
+	free_cpumask_var(s->cpus);
+	free_percpu(s->pcpu);
+}
+
+/**
+ * sampler_start - start sampling on every online CPU
+ * @period_ns: clamped to SMPL_MIN_PERIOD_NS
+ * @gpio: input to sample, or < 0 for the per-CPU counter
+ * @wake_batch: readers are woken every that many samples (power of 2)
+ *
+ * Return: 0, -EBUSY when already running or -ENOMEM
+ */
+int sampler_start(struct sampler *s, u64 period_ns, int gpio,
+		  unsigned int wake_batch)
+{
+	struct smpl_cpu *sc;
+	u64 now;
+	int cpu, err = 0;
+
+	period_ns = max_t(u64, period_ns, SMPL_MIN_PERIOD_NS);
+	wake_batch = roundup_pow_of_two(clamp(wake_batch, 1U, SMPL_RING_SIZE));
+
+	mutex_lock(&s->lock);
+	if (s->running) {
+		err = -EBUSY;
+		goto out;
+	}
+
+	cpus_read_lock();
+	cpumask_copy(s->cpus, cpu_online_mask);
+
+	for_each_cpu (cpu, s->cpus) {
+		sc = per_cpu_ptr(s->pcpu, cpu);
+		if (sc->ring == NULL)
+			sc->ring = kvcalloc(SMPL_RING_SIZE, sizeof(*sc->ring),
+					    GFP_KERNEL);
+		if (sc->ring == NULL) {
+			err = -ENOMEM;
+			goto unlock;
+		}
+		smpl_cpu_reset(sc);
+	}
+
+	s->period = ns_to_ktime(period_ns);
+	s->gpio = gpio;
+	s->wake_mask = wake_batch - 1;
+
+	/* same period aligned first expiry, so CPUs can be compared */
+	now = ktime_get_ns();
+	s->start = ns_to_ktime((div64_u64(now, period_ns) + 2) * period_ns);
+
+	for_each_cpu (cpu, s->cpus)
+		smp_call_function_single(cpu, smpl_start_on_cpu,
+					 per_cpu_ptr(s->pcpu, cpu), 1);
+	s->running = true;
+unlock:
+	cpus_read_unlock();
+out:
+	mutex_unlock(&s->lock);
+	return err;
+}
+
+void sampler_stop(struct sampler *s)
+{
+	int cpu;
+
+	mutex_lock(&s->lock);
+	if (s->running) {
+		for_each_cpu (cpu, s->cpus)
+			hrtimer_cancel(&per_cpu_ptr(s->pcpu, cpu)->timer);
+		WRITE_ONCE(s->running, false);
+	}
+	mutex_unlock(&s->lock);
+
+	/* let blocked readers collect the tail of the run */
+	wake_up_interruptible(&s->wait);
+}
+
+/**
+ * sampler_ready - enough samples for a reader wakeup, or end of run
+ */
+bool sampler_ready(struct sampler *s)
+{
+	u32 avail = 0;
+	int cpu;
+
+	if (!READ_ONCE(s->running))
+		return true;
+
+	for_each_cpu (cpu, s->cpus)
+		avail += smpl_ring_count(per_cpu_ptr(s->pcpu, cpu));
+
+	return avail > s->wake_mask;
+}
+
+/**
+ * sampler_read - move whole samples of every CPU ring to userspace
+ *
+ * Return: bytes copied, or -EFAULT
+ */
+ssize_t sampler_read(struct sampler *s, char __user *buf, size_t len)
+{
+	size_t max = len / sizeof(struct alm_sample);
+	size_t count = 0;
+	struct smpl_cpu *sc;
+	u32 avail, idx, n;
+	int cpu, err = 0;
+
+	mutex_lock(&s->lock);
+	for_each_cpu (cpu, s->cpus) {
+		sc = per_cpu_ptr(s->pcpu, cpu);
+		if (sc->ring == NULL)
+			continue;
+
+		avail = min_t(size_t, smpl_ring_count(sc), max - count);
+		while (avail) {
+			/* contiguous chunk up to the end of the ring */
+			idx = sc->tail & (SMPL_RING_SIZE - 1);
+			n = min(avail, SMPL_RING_SIZE - idx);
+			if (copy_to_user(buf + count * sizeof(*sc->ring),
+					 &sc->ring[idx],
+					 n * sizeof(*sc->ring))) {
+				err = -EFAULT;
+				goto out;
+			}
+			/* release the slots back to the timer */
+			smp_store_release(&sc->tail, sc->tail + n);
+			count += n;
+			avail -= n;
+		}
+	}
+out:
+	mutex_unlock(&s->lock);
+	return count ? count * sizeof(struct alm_sample) : err;
+}
+
+/*
+ * smpl_jitter_show - per-CPU summary and the merged jitter histogram
+ *
+ * Read without stopping the run, a value may lag behind by one sample.
+ */
+static int smpl_jitter_show(struct seq_file *m, void *unused)
+{
+	struct sampler *s = m->private;
+	struct smpl_cpu *sc;
+	u64 hist[SMPL_HIST_BUCKETS] = { 0 };
+	u64 count;
+	int cpu, i;
+
+	mutex_lock(&s->lock);
+	seq_printf(m, "period:  %lld ns\n", ktime_to_ns(s->period));
+	seq_printf(m, "running: %d\n\n", s->running);
+
+	seq_printf(m, "%4s %12s %10s %10s %10s %10s %10s\n", "cpu", "count",
+		   "missed", "dropped", "min_ns", "avg_ns", "max_ns");
+	for_each_cpu (cpu, s->cpus) {
+		sc = per_cpu_ptr(s->pcpu, cpu);
+		count = READ_ONCE(sc->count);
+		if (count == 0)
+			continue;
+
+		seq_printf(m, "%4d %12llu %10llu %10llu %10lld %10lld %10lld\n",
+			   cpu, count, READ_ONCE(sc->missed),
+			   READ_ONCE(sc->dropped), READ_ONCE(sc->jitter_min),
+			   div64_s64(READ_ONCE(sc->jitter_sum), count),
+			   READ_ONCE(sc->jitter_max));
+
+		for (i = 0; i < SMPL_HIST_BUCKETS; i++)
+			hist[i] += READ_ONCE(sc->hist[i]);
+	}
+
+	seq_printf(m, "\n%12s %14s\n", "<ns", "expiries");
+	for (i = 0; i < SMPL_HIST_BUCKETS; i++) {
+		if (hist[i])
+			seq_printf(m, "%12llu %14llu\n", 2ULL << i, hist[i]);
+	}
+	mutex_unlock(&s->lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(smpl_jitter);
+
+/**
+ * sampler_debugfs - export the jitter statistic as <parent>/jitter
+ */
+void sampler_debugfs(struct sampler *s, struct dentry *parent)
+{
+	debugfs_create_file("jitter", 0444, parent, s, &smpl_jitter_fops);
+}
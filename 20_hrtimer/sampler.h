@@ -0,0 +1,59 @@
+#ifndef __SAMPLER_H__
+#define __SAMPLER_H__
+
+#include <linux/hrtimer.h>
+#include <linux/cpumask.h>
+#include <linux/mutex.h>
+#include <linux/wait.h>
+#include <linux/debugfs.h>
+#include "alman_sample.h"
+
+#define SMPL_RING_SIZE (8192) /* samples per CPU, must be power of 2 */
+#define SMPL_HIST_BUCKETS (32) /* log2(ns) jitter histogram */
+#define SMPL_MIN_PERIOD_NS (10 * NSEC_PER_USEC)
+
+struct sampler;
+
+/*
+ * Everything the callback touches lives in the per-CPU part and is only
+ * written by the CPU the timer is pinned to.
+ */
+struct smpl_cpu {
+	struct hrtimer timer;
+	struct sampler *s;
+	struct alm_sample *ring;
+	u32 head; /* written by the timer */
+	u32 tail; /* written by the reader */
+	u64 count;
+	u64 missed; /* periods skipped by hrtimer_forward() */
+	u64 dropped; /* samples lost to a full ring */
+	s64 jitter_min;
+	s64 jitter_max;
+	s64 jitter_sum;
+	u64 hist[SMPL_HIST_BUCKETS];
+	int cpu;
+};
+
+struct sampler {
+	struct smpl_cpu __percpu *pcpu;
+	cpumask_var_t cpus; /* CPUs sampling in the current run */
+	ktime_t period;
+	ktime_t start; /* first, period aligned, expiry of every CPU */
+	int gpio; /* < 0 to sample the counter */
+	u32 wake_mask;
+	bool running;
+	struct mutex lock; /* serializes start/stop/read */
+	wait_queue_head_t wait;
+};
+
+/* exported functions */
+int sampler_init(struct sampler *s);
+void sampler_destroy(struct sampler *s);
+int sampler_start(struct sampler *s, u64 period_ns, int gpio,
+		  unsigned int wake_batch);
+void sampler_stop(struct sampler *s);
+ssize_t sampler_read(struct sampler *s, char __user *buf, size_t len);
+bool sampler_ready(struct sampler *s);
+void sampler_debugfs(struct sampler *s, struct dentry *parent);
+
+#endif /* __SAMPLER_H__ */
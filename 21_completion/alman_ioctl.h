@@ -0,0 +1,29 @@
+#ifndef __ALMAN_IOCTL_H__
+#define __ALMAN_IOCTL_H__
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/* Shared between the driver and the userspace apps */
+enum alm_op {
+	ALM_OP_NOP,
+	ALM_OP_ECHO, /* result = arg */
+	ALM_OP_SLEEP, /* worker sleeps arg ms, to exercise timeouts */
+	ALM_OP_MAX,
+};
+
+/*
+ * Synchronous device command. The caller waits at most timeout_ms
+ * (0 for the driver default, capped at 10 s), the ioctl fails with
+ * ETIMEDOUT after. A fatal signal ends the wait.
+ */
+struct alm_cmd {
+	__u32 op;
+	__u32 timeout_ms;
+	__s64 arg;
+	__s64 result;
+};
+
+#define ALM_CMD _IOWR('a', 'a', struct alm_cmd)
+
+#endif /* __ALMAN_IOCTL_H__ */
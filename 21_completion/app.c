@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include "alman_ioctl.h"
+
+/*
+ * Usage: ./app <nop|echo|sleep> [arg] [timeout_ms]
+ *
+ * Runs one synchronous command. "sleep 2000 500" shows a bounded wait
+ * giving up while the worker still finishes the request.
+ */
+
+/* Private variables */
+static const char *const op_name[ALM_OP_MAX] = {
+	[ALM_OP_NOP] = "nop",
+	[ALM_OP_ECHO] = "echo",
+	[ALM_OP_SLEEP] = "sleep",
+};
+
+/* Main function */
+int main(int argc, char *argv[])
+{
+	struct alm_cmd cmd;
+	int fd, op;
+
+	if (argc < 2) {
+		printf("Usage: %s <nop|echo|sleep> [arg] [timeout_ms]\n",
+		       argv[0]);
+		return -1;
+	}
+
+	for (op = 0; op < ALM_OP_MAX; op++) {
+		if (strcmp(argv[1], op_name[op]) == 0)
+			break;
+	}
+	if (op == ALM_OP_MAX) {
+		printf("Unknown command %s\n", argv[1]);
+		return -1;
+	}
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.op = op;
+	if (argc > 2)
+		cmd.arg = atoll(argv[2]);
+	if (argc > 3)
+		cmd.timeout_ms = atoi(argv[3]);
+
+	fd = open("/dev/alman_device", O_RDWR);
+	if (fd < 0) {
+		printf("Can't open device file\n");
+		return -1;
+	}
+
+	if (ioctl(fd, ALM_CMD, &cmd) < 0)
+		printf("%s failed: %s\n", op_name[op], strerror(errno));
+	else
+		printf("%s: result = %lld\n", op_name[op],
+		       (long long)cmd.result);
+
+	close(fd);
+	return 0;
+}
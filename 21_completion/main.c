@@ -0,0 +1,290 @@
+#include <linux/module.h>
+#include <linux/kdev_t.h>
+#include <linux/fs.h>
+#include <linux/cdev.h>
+#include <linux/device.h>
+#include <linux/mutex.h>
+#include <linux/uaccess.h>
+#include "reqq.h"
+
+/* Private macros */
+#define MOD_NAME "alman"
+#define DEV_INFO KERN_INFO MOD_NAME ": "
+
+#define CMD_SIZE (16)
+#define STAT_BUF_SIZE (512)
+#define TIMEOUT_MAX_MS (10000) /* longest wait a caller may ask for */
+
+/* Private variables */
+struct alm_dev {
+	dev_t devno;
+	struct cdev *cdev;
+	struct class *class;
+};
+
+static struct alm_dev alman = { 0 };
+static struct reqq alm_reqq;
+
+/* Depth 1 and depth N results of the last run */
+static DEFINE_MUTEX(run_lock);
+static struct reqq_bench results[2];
+
+/* Module parameters */
+static unsigned int pool_min = 64;
+module_param(pool_min, uint, 0444);
+MODULE_PARM_DESC(pool_min, "Requests reserved in the mempool");
+
+static unsigned int batch_max = 32;
+module_param(batch_max, uint, 0444);
+MODULE_PARM_DESC(batch_max, "Requests completed per worker wakeup");
+
+static unsigned int batch_cost_us = 20;
+module_param(batch_cost_us, uint, 0444);
+MODULE_PARM_DESC(batch_cost_us, "Simulated device cost of one batch");
+
+static unsigned int timeout_ms = 1000;
+module_param(timeout_ms, uint, 0644);
+MODULE_PARM_DESC(timeout_ms, "Default wait bound of a request, at most "
+			     "10000");
+
+static unsigned int bench_depth = 32;
+module_param(bench_depth, uint, 0644);
+MODULE_PARM_DESC(bench_depth, "Requests in flight of the depth N run");
+
+static unsigned int bench_reqs = 20000;
+module_param(bench_reqs, uint, 0644);
+MODULE_PARM_DESC(bench_reqs, "Requests per benchmark run");
+
+/* Module prototypes */
+static int __init alm_init(void);
+static void __exit alm_exit(void);
+/* Cdev prototypes */
+static int alm_open(struct inode *inode, struct file *filp);
+static int alm_release(struct inode *inode, struct file *filp);
+static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
+			loff_t *off);
+static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
+			 loff_t *off);
+static long alm_ioctl(struct file *filp, unsigned int cmd, unsigned long arg);
+
+static struct file_operations fops = {
+	.owner = THIS_MODULE,
+	.read = alm_read,
+	.write = alm_write,
+	.open = alm_open,
+	.release = alm_release,
+	.unlocked_ioctl = alm_ioctl,
+};
+
+/* Function implementations */
+/*
+** This function is called on device file open 
+*/
+static int alm_open(struct inode *inode, struct file *filp)
+{
+	filp->private_data = &alm_reqq;
+
+	pr_info(DEV_INFO "Driver open() called\n");
+	return 0;
+}
+
+/*
+** This function is called on device file close
+*/
+static int alm_release(struct inode *inode, struct file *filp)
+{
+	pr_info(DEV_INFO "Driver release() called\n");
+	return 0;
+}
+
+/*
+** This function is called on device file read, it shows the benchmark
+** results and the worker statistic
+*/
+static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
+			loff_t *off)
+{
+	struct reqq *q = filp->private_data;
+	char kbuf[STAT_BUF_SIZE];
+	u64 completed, batches;
+	int i, n;
+
+	mutex_lock(&run_lock);
+	n = scnprintf(kbuf, sizeof(kbuf), "%6s %10s %12s %10s %9s\n", "depth",
+		      "reqs", "reqs/s", "avg_ns", "timeouts");
+	for (i = 0; i < ARRAY_SIZE(results); i++) {
+		struct reqq_bench *r = &results[i];
+		u64 ns = max_t(u64, r->ns, 1);
+
+		if (r->reqs == 0)
+			continue;
+
+		n += scnprintf(kbuf + n, sizeof(kbuf) - n,
+			       "%6u %10llu %12llu %10llu %9llu\n", r->depth,
+			       r->reqs, div64_u64(r->reqs * NSEC_PER_SEC, ns),
+			       div64_u64(ns, r->reqs), r->timeouts);
+	}
+	mutex_unlock(&run_lock);
+
+	completed = READ_ONCE(q->completed);
+	batches = READ_ONCE(q->batches);
+	n += scnprintf(kbuf + n, sizeof(kbuf) - n,
+		       "\ncompleted: %llu\nbatches:   %llu\navg_batch: %llu\n",
+		       completed, batches,
+		       batches ? div64_u64(completed, batches) : 0);
+
+	return simple_read_from_buffer(buf, len, off, kbuf, n);
+}
+
+/*
+** This function is called on device file write, "bench" runs bench_reqs
+** requests at depth 1 then at depth bench_depth
+*/
+static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
+			 loff_t *off)
+{
+	struct reqq *q = filp->private_data;
+	unsigned long timeout = msecs_to_jiffies(min_t(unsigned int,
+						       READ_ONCE(timeout_ms),
+						       TIMEOUT_MAX_MS));
+	unsigned int depth[ARRAY_SIZE(results)] = { 1, READ_ONCE(bench_depth) };
+	unsigned int nr = READ_ONCE(bench_reqs);
+	char cmd[CMD_SIZE];
+	int i, ret = 0;
+
+	if (len >= sizeof(cmd))
+		return -EINVAL;
+	if (copy_from_user(cmd, buf, len))
+		return -EFAULT;
+	cmd[len] = '\0';
+
+	if (strcmp(strim(cmd), "bench") || depth[1] == 0 || nr == 0)
+		return -EINVAL;
+
+	mutex_lock(&run_lock);
+	for (i = 0; i < ARRAY_SIZE(results); i++) {
+		if ((ret = reqq_bench(q, depth[i], nr, timeout,
+				      &results[i])) < 0)
+			break;
+	}
+	mutex_unlock(&run_lock);
+
+	return ret < 0 ? ret : len;
+}
+
+/*
+** This function is called on ioctl, ALM_CMD runs one synchronous command
+** with a bounded wait
+*/
+static long alm_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+	struct reqq *q = filp->private_data;
+	struct alm_cmd c;
+	int err;
+
+	if (cmd != ALM_CMD)
+		return -ENOTTY;
+
+	if (copy_from_user(&c, (void __user *)arg, sizeof(c)))
+		return -EFAULT;
+	if (c.op >= ALM_OP_MAX)
+		return -EINVAL;
+	if (c.timeout_ms == 0)
+		c.timeout_ms = READ_ONCE(timeout_ms);
+	c.timeout_ms = min_t(u32, c.timeout_ms, TIMEOUT_MAX_MS);
+
+	err = reqq_exec(q, c.op, c.arg, &c.result,
+			msecs_to_jiffies(c.timeout_ms));
+	if (err < 0)
+		return err;
+
+	if (copy_to_user((void __user *)arg, &c, sizeof(c)))
+		return -EFAULT;
+	return 0;
+}
+
+/*
+** This function is called at the first time module inserted
+*/
+static int __init alm_init(void)
+{
+	/* Allocate major number */
+	if (alloc_chrdev_region(&alman.devno, 0, 1, MOD_NAME "_dev") < 0) {
+		pr_err(DEV_INFO "Can't allocate major number for device\n");
+		return -1;
+	}
+	printk(DEV_INFO "Major = %d, Minor = %d\n", MAJOR(alman.devno),
+	       MINOR(alman.devno));
+
+	/* Request queue: mempool and worker thread, ready before any open */
+	if (reqq_init(&alm_reqq, pool_min, batch_max, batch_cost_us) < 0) {
+		pr_err(DEV_INFO "Can't create request queue\n");
+		goto r_major;
+	}
+
+	/* Create struct chardev */
+	// cdev_init(&alman.cdev, &fops);
+	if ((alman.cdev = cdev_alloc()) == NULL) {
+		pr_err(DEV_INFO "Can't allocate cdev\n");
+		goto r_reqq;
+	}
+	alman.cdev->owner = THIS_MODULE;
+	alman.cdev->ops = &fops;
+
+	/* Add chardev to kernel */
+	if (cdev_add(alman.cdev, alman.devno, 1) < 0) {
+		pr_err(DEV_INFO "Can't add chardev to the system\n");
+		goto r_reqq;
+	}
+
+	/* Create struct class */
+	if ((alman.class = class_create(THIS_MODULE, MOD_NAME "_class")) ==
+	    NULL) {
+		pr_err(DEV_INFO "Can't create struct class for device\n");
+		goto r_cdev;
+	}
+
+	/* Create the device */
+	if (device_create(alman.class, NULL, alman.devno, NULL,
+			  MOD_NAME "_device") == NULL) {
+		pr_err(DEV_INFO "Can't create the device\n");
+		goto r_class;
+	}
+
+	printk(DEV_INFO "Driver inserted\n");
+	return 0;
+
+r_class:
+	class_destroy(alman.class);
+r_cdev:
+	cdev_del(alman.cdev);
+r_reqq:
+	reqq_destroy(&alm_reqq);
+r_major:
+	unregister_chrdev_region(alman.devno, 1);
+
+	return -1;
+}
+
+/*
+** This function is called at the last time module removed 
+*/
+static void __exit alm_exit(void)
+{
+	device_destroy(alman.class, alman.devno);
+	class_destroy(alman.class);
+	cdev_del(alman.cdev);
+	reqq_destroy(&alm_reqq);
+	unregister_chrdev_region(alman.devno, 1);
+
+	printk(DEV_INFO "Driver removed\n");
+}
+
+module_init(alm_init);
+module_exit(alm_exit);
+
+/* Module description */
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Pudja Mansyurin");
+MODULE_DESCRIPTION(MOD_NAME);
+MODULE_VERSION("3:5.4");
@@ -0,0 +1,277 @@
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/kthread.h>
+#include <linux/delay.h>
+#include <linux/ktime.h>
+#include "reqq.h"
+
+/* Private macros */
+#define REQQ_SLEEP_MAX_MS (10000)
+
+/* Function implementations */
+static void reqq_put(struct reqq *q, struct alm_req *req)
+{
+	if (refcount_dec_and_test(&req->ref))
+		mempool_free(req, q->pool);
+}
+
+/*
+ * reqq_process - execute one command, stands in for the device
+ */
+static void reqq_process(struct alm_req *req)
+{
+	switch (req->op) {
+	case ALM_OP_NOP:
+		break;
+	case ALM_OP_ECHO:
+		req->result = req->arg;
+		break;
+	case ALM_OP_SLEEP:
+		msleep(clamp_t(s64, req->arg, 0, REQQ_SLEEP_MAX_MS));
+		break;
+	default:
+		req->status = -EINVAL;
+		break;
+	}
+}
+
+static int reqq_worker_fn(void *data)
+{
+	struct reqq *q = data;
+	struct alm_req *req, *tmp;
+	LIST_HEAD(batch);
+	unsigned int n;
+
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(q->wait,
+					 !list_empty_careful(&q->pending) ||
+						 kthread_should_stop());
+
+		/* take up to batch_max requests with one lock round */
+		spin_lock(&q->lock);
+		for (n = 0; n < q->batch_max && !list_empty(&q->pending); n++)
+			list_move_tail(q->pending.next, &batch);
+		spin_unlock(&q->lock);
+
+		if (n == 0)
+			continue;
+
+		/* fixed cost per batch, amortized over all its requests */
+		if (q->batch_cost_us)
+			usleep_range(q->batch_cost_us, q->batch_cost_us + 10);
+
+		list_for_each_entry_safe (req, tmp, &batch, node) {
+			list_del(&req->node);
+			reqq_process(req);
+			complete(&req->done);
+			reqq_put(q, req);
+		}
+
+		q->completed += n;
+		q->batches++;
+	}
+
+	return 0;
+}
+
+/**
+ * reqq_init - create the request pool and start the worker
+ * @pool_min: requests kept in reserve, so submission always progresses
+ * @batch_max: requests handled per worker wakeup
+ * @batch_cost_us: simulated fixed cost of a batch
+ *
+ * Return: 0 or errno
+ */
+int reqq_init(struct reqq *q, unsigned int pool_min, unsigned int batch_max,
+	      unsigned int batch_cost_us)
+{
+	int err;
+
+	spin_lock_init(&q->lock);
+	INIT_LIST_HEAD(&q->pending);
+	init_waitqueue_head(&q->wait);
+	q->batch_max = max(batch_max, 1U);
+	q->batch_cost_us = batch_cost_us;
+	q->completed = 0;
+	q->batches = 0;
+
+	if ((q->cache = KMEM_CACHE(alm_req, 0)) == NULL)
+		return -ENOMEM;
+
+	if ((q->pool = mempool_create_slab_pool(pool_min, q->cache)) == NULL) {
+		err = -ENOMEM;
+		goto r_cache;
+	}
+
+	q->worker = kthread_run(reqq_worker_fn, q, "alman_reqq");
+	if (IS_ERR(q->worker)) {
+		err = PTR_ERR(q->worker);
+		goto r_pool;
+	}
+
+	return 0;
+
+r_pool:
+	mempool_destroy(q->pool);
+r_cache:
+	kmem_cache_destroy(q->cache);
+	return err;
+}
+
+/**
+ * reqq_destroy - stop the worker, fail whatever it did not pick up
+ */
+void reqq_destroy(struct reqq *q)
+{
+	struct alm_req *req, *tmp;
+	LIST_HEAD(dead);
+
+	kthread_stop(q->worker);
+
+	spin_lock(&q->lock);
+	list_splice_init(&q->pending, &dead);
+	spin_unlock(&q->lock);
+
+	list_for_each_entry_safe (req, tmp, &dead, node) {
+		list_del(&req->node);
+		req->status = -ESHUTDOWN;
+		complete(&req->done);
+		reqq_put(q, req);
+	}
+
+	mempool_destroy(q->pool);
+	kmem_cache_destroy(q->cache);
+}
+
+/**
+ * reqq_alloc - get a request from the pool, may sleep
+ *
+ * Return: request owned by the caller, or NULL
+ */
+struct alm_req *reqq_alloc(struct reqq *q, u32 op, s64 arg)
+{
+	struct alm_req *req;
+
+	if ((req = mempool_alloc(q->pool, GFP_KERNEL)) == NULL)
+		return NULL;
+
+	init_completion(&req->done);
+	refcount_set(&req->ref, 1);
+	req->op = op;
+	req->arg = arg;
+	req->result = 0;
+	req->status = 0;
+	return req;
+}
+
+/**
+ * reqq_submit - queue a request, the worker gets its own reference
+ */
+void reqq_submit(struct reqq *q, struct alm_req *req)
+{
+	refcount_inc(&req->ref);
+
+	spin_lock(&q->lock);
+	list_add_tail(&req->node, &q->pending);
+	spin_unlock(&q->lock);
+
+	wake_up(&q->wait);
+}
+
+/**
+ * reqq_wait - wait for a submitted request and drop the caller reference
+ * @timeout: in jiffies
+ * @result: optional, set on success
+ *
+ * A fatal signal ends the wait early, the worker still owns the request.
+ *
+ * Return: status of the request, -ETIMEDOUT or -ERESTARTSYS
+ */
+int reqq_wait(struct reqq *q, struct alm_req *req, unsigned long timeout,
+	      s64 *result)
+{
+	long left = wait_for_completion_killable_timeout(&req->done, timeout);
+	int err;
+
+	if (left < 0)
+		err = left;
+	else if (left == 0)
+		err = -ETIMEDOUT;
+	else if ((err = req->status) == 0 && result)
+		*result = req->result;
+
+	reqq_put(q, req);
+	return err;
+}
+
+/**
+ * reqq_exec - synchronous command: allocate, submit and wait
+ *
+ * Return: status of the request, -ETIMEDOUT, -ERESTARTSYS or -ENOMEM
+ */
+int reqq_exec(struct reqq *q, u32 op, s64 arg, s64 *result,
+	      unsigned long timeout)
+{
+	struct alm_req *req;
+
+	if ((req = reqq_alloc(q, op, arg)) == NULL)
+		return -ENOMEM;
+
+	reqq_submit(q, req);
+	return reqq_wait(q, req, timeout, result);
+}
+
+/**
+ * reqq_bench - complete @nr NOP requests keeping @depth of them in flight
+ *
+ * Requests complete in submission order, so the oldest one is waited for
+ * and its slot in the window refilled right away.
+ *
+ * Return: 0, -ENOMEM or -ERESTARTSYS
+ */
+int reqq_bench(struct reqq *q, unsigned int depth, unsigned int nr,
+	       unsigned long timeout, struct reqq_bench *res)
+{
+	struct alm_req **win;
+	unsigned int submitted = 0, done = 0;
+	int err = 0;
+	u64 t0;
+
+	if ((win = kcalloc(depth, sizeof(*win), GFP_KERNEL)) == NULL)
+		return -ENOMEM;
+
+	memset(res, 0, sizeof(*res));
+	res->depth = depth;
+
+	t0 = ktime_get_ns();
+	while (done < nr) {
+		while (submitted - done < depth && submitted < nr) {
+			if ((win[submitted % depth] =
+				     reqq_alloc(q, ALM_OP_NOP, 0)) == NULL) {
+				err = -ENOMEM;
+				goto out;
+			}
+			reqq_submit(q, win[submitted % depth]);
+			submitted++;
+		}
+
+		err = reqq_wait(q, win[done % depth], timeout, NULL);
+		done++;
+		if (err == -ERESTARTSYS)
+			goto out;
+		if (err < 0)
+			res->timeouts++;
+		err = 0;
+	}
+out:
+	/* never leave a submitted request behind, after a kill it won't wait */
+	while (done < submitted) {
+		reqq_wait(q, win[done % depth], timeout, NULL);
+		done++;
+	}
+
+	res->ns = ktime_get_ns() - t0;
+	res->reqs = done;
+	kfree(win);
+	return err;
+}
@@ -0,0 +1,59 @@
+#ifndef __REQQ_H__
+#define __REQQ_H__
+
+#include <linux/completion.h>
+#include <linux/mempool.h>
+#include <linux/refcount.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include "alman_ioctl.h"
+
+/*
+ * One command in flight. The submitter and the worker hold a reference
+ * each, so a caller that gives up on timeout can leave the request to
+ * the worker, which returns it to the pool once done.
+ */
+struct alm_req {
+	struct list_head node;
+	struct completion done;
+	refcount_t ref;
+	u32 op;
+	s64 arg;
+	s64 result;
+	int status;
+};
+
+struct reqq {
+	struct kmem_cache *cache;
+	mempool_t *pool;
+	spinlock_t lock; /* protects pending */
+	struct list_head pending;
+	wait_queue_head_t wait;
+	struct task_struct *worker;
+	unsigned int batch_max;
+	unsigned int batch_cost_us; /* per batch, e.g. a doorbell round trip */
+	u64 completed;
+	u64 batches;
+};
+
+struct reqq_bench {
+	unsigned int depth;
+	u64 reqs;
+	u64 ns;
+	u64 timeouts;
+};
+
+/* exported functions */
+int reqq_init(struct reqq *q, unsigned int pool_min, unsigned int batch_max,
+	      unsigned int batch_cost_us);
+void reqq_destroy(struct reqq *q);
+struct alm_req *reqq_alloc(struct reqq *q, u32 op, s64 arg);
+void reqq_submit(struct reqq *q, struct alm_req *req);
+int reqq_wait(struct reqq *q, struct alm_req *req, unsigned long timeout,
+	      s64 *result);
+int reqq_exec(struct reqq *q, u32 op, s64 arg, s64 *result,
+	      unsigned long timeout);
+int reqq_bench(struct reqq *q, unsigned int depth, unsigned int nr,
+	       unsigned long timeout, struct reqq_bench *res);
+
+#endif /* __REQQ_H__ */
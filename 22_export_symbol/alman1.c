@@ -3,14 +3,19 @@
 #include <linux/fs.h>
 #include <linux/cdev.h>
 #include <linux/device.h>
-// #include <linux/slab.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/rculist.h>
+#include <linux/percpu.h>
+#include <linux/jump_label.h>
+#include <linux/uaccess.h>
+#include "alman_api.h"
 
 /* Private macros */
 #define MOD_NAME "alman1"
 #define DEV_INFO KERN_INFO MOD_NAME ": "
 
-/* Exported variables */
-int alm_count = 0;
+#define STAT_BUF_SIZE (1024)
 
 /* Private variables */
 struct alm_dev {
@@ -21,6 +26,19 @@ struct alm_dev {
 
 static struct alm_dev alman = { 0 };
 
+/*
+ * Registered consumers. Writers serialize on alm_ops_lock, the hot path
+ * walks the list under RCU. The static key is enabled while at least one
+ * consumer is registered, so without consumers alm_shared_fn() is a
+ * per-CPU increment and a patched-out branch.
+ */
+static LIST_HEAD(alm_ops_list);
+static DEFINE_MUTEX(alm_ops_lock);
+static DEFINE_STATIC_KEY_FALSE(alm_hooks_key);
+static atomic_t alm_nr_ops = ATOMIC_INIT(0);
+static DEFINE_PER_CPU(u64, alm_calls);
+static DEFINE_PER_CPU(u64, alm_hook_calls);
+
 /* Module prototypes */
 static int __init alm_init(void);
 static void __exit alm_exit(void);
@@ -31,8 +49,6 @@ static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off);
 static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
 			 loff_t *off);
-/* Thread prototypes */
-void alm_shared_fn(void);
 
 static struct file_operations fops = {
 	.owner = THIS_MODULE,
@@ -43,14 +59,132 @@ static struct file_operations fops = {
 };
 
 /* Exported symbols */
-// EXPORT_SYMBOL_GPL(alm_shared_fn);
-// EXPORT_SYMBOL(alm_count);
-EXPORT_SYMBOL(alm_shared_fn);
+EXPORT_SYMBOL_GPL(alm_api_version);
+EXPORT_SYMBOL_GPL(alm_register_ops);
+EXPORT_SYMBOL_GPL(alm_unregister_ops);
+EXPORT_SYMBOL_GPL(alm_ops_get);
+EXPORT_SYMBOL_GPL(alm_ops_put);
+EXPORT_SYMBOL_GPL(alm_shared_fn);
 
 /* Function implementations */
-void alm_shared_fn(void)
+u32 alm_api_version(void)
+{
+	return ALM_API_VERSION;
+}
+
+/**
+ * alm_register_ops - add a consumer, its hook runs from now on
+ *
+ * Return: 0, -EPROTO on API major mismatch, -EEXIST on duplicate name
+ */
+int alm_register_ops(struct alm_ops *ops)
+{
+	struct alm_ops *cur;
+	int err = 0;
+
+	if (ops->name == NULL || ops->event == NULL)
+		return -EINVAL;
+
+	if ((ops->version >> 16) != ALM_API_MAJOR) {
+		pr_err(DEV_INFO "%s built for API %u.%u, provider is %u.%u\n",
+		       ops->name, ops->version >> 16, ops->version & 0xffff,
+		       ALM_API_MAJOR, ALM_API_MINOR);
+		return -EPROTO;
+	}
+
+	mutex_lock(&alm_ops_lock);
+	list_for_each_entry (cur, &alm_ops_list, node) {
+		if (strcmp(cur->name, ops->name) == 0) {
+			err = -EEXIST;
+			goto out;
+		}
+	}
+
+	list_add_tail_rcu(&ops->node, &alm_ops_list);
+	atomic_inc(&alm_nr_ops);
+	static_branch_inc(&alm_hooks_key);
+out:
+	mutex_unlock(&alm_ops_lock);
+	return err;
+}
+
+/**
+ * alm_unregister_ops - remove a consumer
+ *
+ * Once it returns no hook call is in flight, @ops can be freed.
+ */
+void alm_unregister_ops(struct alm_ops *ops)
+{
+	mutex_lock(&alm_ops_lock);
+	list_del_rcu(&ops->node);
+	atomic_dec(&alm_nr_ops);
+	static_branch_dec(&alm_hooks_key);
+	mutex_unlock(&alm_ops_lock);
+
+	synchronize_rcu();
+}
+
+/**
+ * alm_ops_get - look up a consumer by name and pin its module
+ *
+ * Return: ops to be released with alm_ops_put(), or NULL
+ */
+struct alm_ops *alm_ops_get(const char *name)
+{
+	struct alm_ops *ops, *found = NULL;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu (ops, &alm_ops_list, node) {
+		if (strcmp(ops->name, name) == 0) {
+			if (try_module_get(ops->owner))
+				found = ops;
+			break;
+		}
+	}
+	rcu_read_unlock();
+
+	return found;
+}
+
+void alm_ops_put(struct alm_ops *ops)
 {
-	pr_info(DEV_INFO "Shared function called %d\n", alm_count++);
+	module_put(ops->owner);
+}
+
+/*
+ * Kept out of line, so the disabled path stays a few instructions
+ */
+static noinline void alm_run_hooks(u64 val)
+{
+	struct alm_ops *ops;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu (ops, &alm_ops_list, node) {
+		ops->event(ops->priv, val);
+		this_cpu_inc(alm_hook_calls);
+	}
+	rcu_read_unlock();
+}
+
+/**
+ * alm_shared_fn - hot path, fans @val out to every registered consumer
+ */
+void alm_shared_fn(u64 val)
+{
+	this_cpu_inc(alm_calls);
+
+	if (static_branch_unlikely(&alm_hooks_key))
+		alm_run_hooks(val);
+}
+
+static u64 alm_pcpu_sum(u64 __percpu *var)
+{
+	u64 sum = 0;
+	int cpu;
+
+	for_each_possible_cpu (cpu)
+		sum += *per_cpu_ptr(var, cpu);
+	return sum;
 }
 
 /*
@@ -77,13 +211,37 @@ static int alm_release(struct inode *inode, struct file *filp)
 }
 
 /*
-** This function is called on device file read 
+** This function is called on device file read, it shows the registered
+** consumers and the counters
 */
 static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off)
 {
-	pr_info(DEV_INFO "Driver read() called\n");
-	return 0;
+	struct alm_ops *ops;
+	char *kbuf;
+	ssize_t ret;
+	int n;
+
+	if ((kbuf = kmalloc(STAT_BUF_SIZE, GFP_KERNEL)) == NULL)
+		return -ENOMEM;
+
+	n = scnprintf(kbuf, STAT_BUF_SIZE,
+		      "api:        %u.%u\nconsumers:  %d\nhooks:      %s\n"
+		      "calls:      %llu\nhook_calls: %llu\n",
+		      ALM_API_MAJOR, ALM_API_MINOR, atomic_read(&alm_nr_ops),
+		      static_key_enabled(&alm_hooks_key) ? "on" : "off",
+		      alm_pcpu_sum(&alm_calls), alm_pcpu_sum(&alm_hook_calls));
+
+	rcu_read_lock();
+	list_for_each_entry_rcu (ops, &alm_ops_list, node)
+		n += scnprintf(kbuf + n, STAT_BUF_SIZE - n, "- %s (%u.%u)\n",
+			       ops->name, ops->version >> 16,
+			       ops->version & 0xffff);
+	rcu_read_unlock();
+
+	ret = simple_read_from_buffer(buf, len, off, kbuf, n);
+	kfree(kbuf);
+	return ret;
 }
 
 /*
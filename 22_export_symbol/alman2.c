@@ -3,12 +3,19 @@
 #include <linux/fs.h>
 #include <linux/cdev.h>
 #include <linux/device.h>
-// #include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+#include "alman_api.h"
 
 /* Private macros */
 #define MOD_NAME "alman2"
 #define DEV_INFO KERN_INFO MOD_NAME ": "
 
+#define CMD_SIZE (16)
+#define STAT_BUF_SIZE (512)
+
 /* Private variables */
 struct alm_dev {
 	dev_t devno;
@@ -18,6 +25,25 @@ struct alm_dev {
 
 static struct alm_dev alman = { 0 };
 
+/* Consumer side of the alman1 API */
+static void alm_event(void *priv, u64 val);
+static DEFINE_PER_CPU(u64, alm_events);
+static struct alm_ops alm_ops = ALM_OPS_INIT(MOD_NAME, alm_event, NULL);
+static bool alm_hooked;
+
+/* Hooks off/on cost of alm_shared_fn(), in ps per call */
+static DEFINE_MUTEX(run_lock);
+static u64 bench_ps[2];
+
+/* Module parameters */
+static bool hook = true;
+module_param(hook, bool, 0444);
+MODULE_PARM_DESC(hook, "Register the hook at load time");
+
+static unsigned int bench_iters = 10000000;
+module_param(bench_iters, uint, 0644);
+MODULE_PARM_DESC(bench_iters, "alm_shared_fn() calls per benchmark run");
+
 /* Module prototypes */
 static int __init alm_init(void);
 static void __exit alm_exit(void);
@@ -28,8 +54,6 @@ static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off);
 static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
 			 loff_t *off);
-/* Thread prototypes */
-void alm_shared_fn(void); // declared outside this file scope
 
 static struct file_operations fops = {
 	.owner = THIS_MODULE,
@@ -39,6 +63,53 @@ static struct file_operations fops = {
 	.release = alm_release,
 };
 
+/* Function implementations */
+static void alm_event(void *priv, u64 val)
+{
+	this_cpu_inc(alm_events);
+}
+
+/*
+** Register or unregister the hook, serialized by run_lock (or by init/exit)
+*/
+static int alm_hook_set(bool on)
+{
+	int err = 0;
+
+	if (on == alm_hooked)
+		return 0;
+
+	if (on)
+		err = alm_register_ops(&alm_ops);
+	else
+		alm_unregister_ops(&alm_ops);
+
+	if (err == 0)
+		alm_hooked = on;
+	return err;
+}
+
+/*
+** Time @nr calls of the exported hot path
+**
+** Return: picoseconds per call
+*/
+static u64 alm_bench(unsigned int nr)
+{
+	unsigned int i;
+	u64 t0, ns;
+
+	t0 = ktime_get_ns();
+	for (i = 0; i < nr; i++) {
+		alm_shared_fn(i);
+		if ((i & 0xffff) == 0)
+			cond_resched();
+	}
+	ns = ktime_get_ns() - t0;
+
+	return nr ? div64_u64(ns * 1000, nr) : 0;
+}
+
 /*
 ** This function is called on device file open 
 */
@@ -63,38 +134,65 @@ static int alm_release(struct inode *inode, struct file *filp)
 }
 
 /*
-** This function is called on device file read 
+** This function is called on device file read
 */
 static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off)
 {
-	pr_info(DEV_INFO "Driver read() called\n");
-	alm_shared_fn();
-	return 0;
+	char kbuf[STAT_BUF_SIZE];
+	u64 events = 0;
+	int cpu, n;
+
+	for_each_possible_cpu (cpu)
+		events += *per_cpu_ptr(&alm_events, cpu);
+
+	mutex_lock(&run_lock);
+	n = scnprintf(kbuf, sizeof(kbuf),
+		      "hooked:       %d\nevents:       %llu\n"
+		      "hooks_off_ps: %llu\nhooks_on_ps:  %llu\n",
+		      alm_hooked, events, bench_ps[0], bench_ps[1]);
+	mutex_unlock(&run_lock);
+
+	return simple_read_from_buffer(buf, len, off, kbuf, n);
 }
 
 /*
-** This function is called on device file write 
+** This function is called on device file write, "on" and "off" toggle
+** the hook, "bench" times alm_shared_fn() with hooks off then on
 */
 static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
 			 loff_t *off)
 {
-	// struct alm_dev *dev;
-	// uint8_t *buffer;
-
-	// dev = (struct alm_dev *)filp->private_data;
-
-	pr_info(DEV_INFO "Driver write() called\n");
+	char cmd[CMD_SIZE];
+	bool was_hooked;
+	int err = 0;
 
-	// if ((buffer = kmalloc(len, GFP_KERNEL)) == NULL)
-	// 	return -ENOMEM;
+	if (len >= sizeof(cmd))
+		return -EINVAL;
+	if (copy_from_user(cmd, buf, len))
+		return -EFAULT;
+	cmd[len] = '\0';
+	strim(cmd);
 
-	// if (copy_from_user(buffer, buf, len))
-	// 	return -EFAULT;
-
-	/* Do something with kernel buffer */
+	mutex_lock(&run_lock);
+	if (strcmp(cmd, "on") == 0) {
+		err = alm_hook_set(true);
+	} else if (strcmp(cmd, "off") == 0) {
+		err = alm_hook_set(false);
+	} else if (strcmp(cmd, "bench") == 0) {
+		/* "off" only means no consumer when we are the only one */
+		was_hooked = alm_hooked;
+		alm_hook_set(false);
+		bench_ps[0] = alm_bench(READ_ONCE(bench_iters));
+		if ((err = alm_hook_set(true)) == 0)
+			bench_ps[1] = alm_bench(READ_ONCE(bench_iters));
+		alm_hook_set(was_hooked);
+	} else {
+		err = -EINVAL;
+	}
+	mutex_unlock(&run_lock);
 
-	return len;
+	return err < 0 ? err : len;
 }
 
 /*
@@ -102,6 +200,14 @@ static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
 */
 static int __init alm_init(void)
 {
+	/* Refuse to run against an incompatible provider */
+	if ((alm_api_version() >> 16) != ALM_API_MAJOR) {
+		pr_err(DEV_INFO "alman1 API %u.%u, expected %u.x\n",
+		       alm_api_version() >> 16, alm_api_version() & 0xffff,
+		       ALM_API_MAJOR);
+		return -1;
+	}
+
 	/* Allocate major number */
 	if (alloc_chrdev_region(&alman.devno, 0, 1, MOD_NAME "_dev") < 0) {
 		pr_err(DEV_INFO "Can't allocate major number for device\n");
@@ -139,11 +245,16 @@ static int __init alm_init(void)
 		goto r_class;
 	}
 
+	if (hook && alm_hook_set(true) < 0) {
+		pr_err(DEV_INFO "Can't register hook\n");
+		goto r_dev;
+	}
+
 	printk(DEV_INFO "Driver inserted\n");
 	return 0;
 
-// r_dev:
-//   device_destroy(alman.class, alman.devno);
+r_dev:
+	device_destroy(alman.class, alman.devno);
 r_class:
 	class_destroy(alman.class);
 r_cdev:
@@ -159,6 +270,8 @@ r_major:
 */
 static void __exit alm_exit(void)
 {
+	alm_hook_set(false);
+
 	device_destroy(alman.class, alman.devno);
 	class_destroy(alman.class);
 	cdev_del(alman.cdev);
@@ -0,0 +1,46 @@
+#ifndef __ALMAN_API_H__
+#define __ALMAN_API_H__
+
+#include <linux/module.h>
+#include <linux/list.h>
+#include <linux/types.h>
+
+/*
+ * Stable interface between alman1 (provider) and its consumers. The
+ * major number changes on incompatible changes of struct alm_ops or of
+ * the exported functions, the minor one on backward compatible ones.
+ */
+#define ALM_API_MAJOR (1)
+#define ALM_API_MINOR (0)
+#define ALM_API_VERSION ((ALM_API_MAJOR << 16) | ALM_API_MINOR)
+
+/*
+ * Consumer ops table. A registered event hook is called from
+ * alm_shared_fn() under rcu_read_lock(), so it must not sleep.
+ */
+struct alm_ops {
+	const char *name;
+	u32 version; /* ALM_API_VERSION the consumer was built with */
+	struct module *owner;
+	void (*event)(void *priv, u64 val);
+	void *priv;
+
+	/* provider private */
+	struct list_head node;
+};
+
+#define ALM_OPS_INIT(_name, _event, _priv)                                     \
+	{                                                                      \
+		.name = (_name), .version = ALM_API_VERSION,                   \
+		.owner = THIS_MODULE, .event = (_event), .priv = (_priv),      \
+	}
+
+/* exported functions */
+u32 alm_api_version(void);
+int alm_register_ops(struct alm_ops *ops);
+void alm_unregister_ops(struct alm_ops *ops);
+struct alm_ops *alm_ops_get(const char *name);
+void alm_ops_put(struct alm_ops *ops);
+void alm_shared_fn(u64 val);
+
+#endif /* __ALMAN_API_H__ */
@@ -0,0 +1,439 @@
+#include <linux/module.h>
+#include <linux/kdev_t.h>
+#include <linux/fs.h>
+#include <linux/cdev.h>
+#include <linux/device.h>
+#include <linux/slab.h>
+#include <linux/kthread.h>
+#include <linux/delay.h>
+#include <linux/atomic.h>
+#include <linux/spinlock.h>
+#include <linux/completion.h>
+#include <linux/sched/clock.h>
+#include <linux/uaccess.h>
+#include "snapshot.h"
+
+/* Private macros */
+#define MOD_NAME "alman"
+#define DEV_INFO KERN_INFO MOD_NAME ": "
+#define MAX_THREAD (64)
+#define STAT_WORDS (8)
+#define CMD_SIZE (16)
+#define STAT_BUF_SIZE (1024)
+
+/* Private types */
+/* 64 byte multi-word state, every word carries the same generation */
+struct alm_stats {
+	u64 v[STAT_WORDS];
+};
+
+enum snap_mode {
+	SNAP_SEQ = 0,
+	SNAP_RCU,
+	SNAP_RWLOCK,
+	SNAP_MAX,
+};
+
+struct reader_data {
+	struct task_struct *thread;
+	u64 reads;
+	u64 retries;
+	u64 torn;
+} ____cacheline_aligned_in_smp;
+
+struct bench_result {
+	u64 reads;
+	u64 reads_per_sec;
+	u64 retries;
+	u64 torn;
+	u64 writes;
+	unsigned int readers;
+	bool valid;
+};
+
+struct alm_dev {
+	atomic_long_t shared_var; /* publish generation */
+	struct snap_seq seq;
+	struct snap_rcu rcu;
+	rwlock_t rwlock;
+	struct alm_stats rw_stats;
+
+	dev_t devno;
+	struct cdev *cdev;
+	struct class *class;
+};
+
+/* Module parameters */
+static unsigned int nr_readers = 4;
+module_param(nr_readers, uint, 0644);
+MODULE_PARM_DESC(nr_readers, "Number of reader threads");
+
+static unsigned int duration_ms = 1000;
+module_param(duration_ms, uint, 0644);
+MODULE_PARM_DESC(duration_ms, "Run time of each mode (ms)");
+
+/* Private variables */
+static struct alm_dev alm = { 0 };
+static const char *const mode_name[SNAP_MAX] = { "seq", "rcu", "rwlock" };
+static struct bench_result results[SNAP_MAX];
+static struct reader_data *readers;
+static struct task_struct *writer;
+static enum snap_mode run_mode;
+static unsigned int run_readers;
+static DEFINE_MUTEX(run_lock);
+
+/* Module prototypes */
+static int __init alm_init(void);
+static void __exit alm_exit(void);
+/* Cdev prototypes */
+static int alm_open(struct inode *inode, struct file *filp);
+static int alm_release(struct inode *inode, struct file *filp);
+static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
+			loff_t *off);
+static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
+			 loff_t *off);
+/* Thread prototypes */
+static int writer_fn(void *pv);
+static int reader_fn(void *pv);
+
+static struct file_operations fops = {
+	.owner = THIS_MODULE,
+	.read = alm_read,
+	.write = alm_write,
+	.open = alm_open,
+	.release = alm_release,
+};
+
+/* Function implementations */
+static void stats_fill(struct alm_stats *st, u64 gen)
+{
+	int i;
+
+	for (i = 0; i < STAT_WORDS; i++)
+		st->v[i] = gen;
+}
+
+static bool stats_torn(const struct alm_stats *st)
+{
+	int i;
+
+	for (i = 1; i < STAT_WORDS; i++)
+		if (st->v[i] != st->v[0])
+			return true;
+	return false;
+}
+
+static int writer_fn(void *pv)
+{
+	struct alm_stats st;
+	u64 gen;
+
+	/* until kthread_stop(), returning earlier would free the task */
+	while (!kthread_should_stop()) {
+		gen = atomic_long_inc_return(&alm.shared_var);
+		stats_fill(&st, gen);
+
+		switch (run_mode) {
+		case SNAP_SEQ:
+			snap_seq_publish(&alm.seq, &st);
+			break;
+		case SNAP_RCU:
+			snap_rcu_publish(&alm.rcu, &st);
+			break;
+		default:
+			write_lock(&alm.rwlock);
+			alm.rw_stats = st;
+			write_unlock(&alm.rwlock);
+			break;
+		}
+		cond_resched();
+	}
+	return 0;
+}
+
+static int reader_fn(void *pv)
+{
+	struct reader_data *rd = pv;
+	struct alm_stats st;
+
+	/* until kthread_stop(), returning earlier would free the task */
+	while (!kthread_should_stop()) {
+		switch (run_mode) {
+		case SNAP_SEQ:
+			rd->retries += snap_seq_read(&alm.seq, &st);
+			break;
+		case SNAP_RCU:
+			snap_rcu_read(&alm.rcu, &st);
+			break;
+		default:
+			read_lock(&alm.rwlock);
+			st = alm.rw_stats;
+			read_unlock(&alm.rwlock);
+			break;
+		}
+
+		if (stats_torn(&st))
+			rd->torn++;
+		if ((++rd->reads & 0xffff) == 0)
+			cond_resched();
+	}
+	return 0;
+}
+
+/* Benchmark: 1 writer and run_readers readers on one publish mode */
+static int bench_run(enum snap_mode mode)
+{
+	struct bench_result *res = &results[mode];
+	u64 start, elapsed, writes;
+	unsigned int i, started = 0;
+	int ret = 0;
+
+	run_mode = mode;
+	run_readers = nr_readers;
+	memset(readers, 0, sizeof(*readers) * run_readers);
+	writes = atomic_long_read(&alm.shared_var);
+
+	start = local_clock();
+	for (i = 0; i < run_readers; i++) {
+		readers[i].thread = kthread_run(reader_fn, &readers[i],
+						"reader_%u", i);
+		if (IS_ERR(readers[i].thread)) {
+			ret = PTR_ERR(readers[i].thread);
+			goto r_readers;
+		}
+		started++;
+	}
+
+	writer = kthread_run(writer_fn, NULL, "writer");
+	if (IS_ERR(writer)) {
+		ret = PTR_ERR(writer);
+		goto r_readers;
+	}
+
+	msleep(duration_ms);
+	kthread_stop(writer);
+
+r_readers:
+	for (i = 0; i < started; i++)
+		kthread_stop(readers[i].thread);
+	elapsed = local_clock() - start;
+
+	if (ret < 0)
+		return ret;
+
+	memset(res, 0, sizeof(*res));
+	for (i = 0; i < run_readers; i++) {
+		res->reads += readers[i].reads;
+		res->retries += readers[i].retries;
+		res->torn += readers[i].torn;
+	}
+	res->reads_per_sec = div64_u64(res->reads * NSEC_PER_SEC, elapsed);
+	res->writes = atomic_long_read(&alm.shared_var) - writes;
+	res->readers = run_readers;
+	res->valid = true;
+
+	pr_info(DEV_INFO "%s: %llu reads/s, %llu writes\n", mode_name[mode],
+		res->reads_per_sec, res->writes);
+	return 0;
+}
+
+/*
+** This function is called on device file open 
+*/
+static int alm_open(struct inode *inode, struct file *filp)
+{
+	filp->private_data = &alm;
+
+	pr_info(DEV_INFO "Driver open() called\n");
+	return 0;
+}
+
+/*
+** This function is called on device file close
+*/
+static int alm_release(struct inode *inode, struct file *filp)
+{
+	pr_info(DEV_INFO "Driver release() called\n");
+	return 0;
+}
+
+/*
+** This function is called on device file read 
+*/
+static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
+			loff_t *off)
+{
+	char kbuf[STAT_BUF_SIZE];
+	int i, n;
+
+	pr_info(DEV_INFO "Driver read() called\n");
+
+	mutex_lock(&run_lock);
+	n = scnprintf(kbuf, sizeof(kbuf), "%-7s %7s %14s %14s %10s %10s %5s\n",
+		      "mode", "readers", "reads", "reads/s", "writes",
+		      "retries", "torn");
+	for (i = 0; i < SNAP_MAX; i++) {
+		struct bench_result *r = &results[i];
+
+		if (!r->valid)
+			continue;
+
+		n += scnprintf(kbuf + n, sizeof(kbuf) - n,
+			       "%-7s %7u %14llu %14llu %10llu %10llu %5llu\n",
+			       mode_name[i], r->readers, r->reads,
+			       r->reads_per_sec, r->writes, r->retries,
+			       r->torn);
+	}
+	mutex_unlock(&run_lock);
+
+	return simple_read_from_buffer(buf, len, off, kbuf, n);
+}
+
+/*
+** This function is called on device file write
+*/
+static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
+			 loff_t *off)
+{
+	char cmd[CMD_SIZE];
+	int i, ret = 0;
+	bool all;
+
+	pr_info(DEV_INFO "Driver write() called\n");
+
+	/* Accept a mode name ("seq", "rcu", "rwlock") or "all" */
+	if (len >= sizeof(cmd))
+		return -EINVAL;
+	if (copy_from_user(cmd, buf, len))
+		return -EFAULT;
+	cmd[len] = '\0';
+	strim(cmd);
+
+	if (nr_readers == 0 || nr_readers > MAX_THREAD)
+		return -EINVAL;
+
+	all = strcmp(cmd, "all") == 0;
+
+	mutex_lock(&run_lock);
+	for (i = 0; i < SNAP_MAX; i++) {
+		if (!all && strcmp(cmd, mode_name[i]))
+			continue;
+		if ((ret = bench_run(i)) < 0 || !all)
+			break;
+	}
+	mutex_unlock(&run_lock);
+
+	if (ret < 0)
+		return ret;
+	if (!all && i == SNAP_MAX)
+		return -EINVAL;
+
+	return len;
+}
+
+/*
+** This function is called at the first time module inserted
+*/
+static int __init alm_init(void)
+{
+	/* Allocate major number */
+	if (alloc_chrdev_region(&alm.devno, 0, 1, MOD_NAME "_dev") < 0) {
+		pr_err(DEV_INFO "Can't allocate major number for device\n");
+		return -1;
+	}
+	printk(DEV_INFO "Major = %d, Minor = %d\n", MAJOR(alm.devno),
+	       MINOR(alm.devno));
+
+	/* Create struct chardev */
+	// cdev_init(alm.cdev, &fops);
+	if ((alm.cdev = cdev_alloc()) == NULL) {
+		pr_err(DEV_INFO "Can't allocate cdev\n");
+		goto r_major;
+	}
+	alm.cdev->owner = THIS_MODULE;
+	alm.cdev->ops = &fops;
+
+	/* Add chardev to kernel */
+	if (cdev_add(alm.cdev, alm.devno, 1) < 0) {
+		pr_err(DEV_INFO "Can't add chardev to the system\n");
+		goto r_major;
+	}
+
+	/* Create struct class */
+	if ((alm.class = class_create(THIS_MODULE, MOD_NAME "_class")) ==
+	    NULL) {
+		pr_err(DEV_INFO "Can't create struct class for device\n");
+		goto r_cdev;
+	}
+
+	/* Create the device */
+	if (device_create(alm.class, NULL, alm.devno, NULL,
+			  MOD_NAME "_device") == NULL) {
+		pr_err(DEV_INFO "Can't create the device\n");
+		goto r_class;
+	}
+
+	/* Snapshot: Initiate publishers */
+	if ((readers = kcalloc(MAX_THREAD, sizeof(*readers), GFP_KERNEL)) ==
+	    NULL) {
+		pr_err(DEV_INFO "Can't allocate reader threads\n");
+		goto r_dev;
+	}
+
+	if (snap_seq_init(&alm.seq, sizeof(struct alm_stats)) < 0) {
+		pr_err(DEV_INFO "Can't allocate seqcount snapshot\n");
+		goto r_readers;
+	}
+
+	if (snap_rcu_init(&alm.rcu, sizeof(struct alm_stats)) < 0) {
+		pr_err(DEV_INFO "Can't allocate rcu snapshot\n");
+		goto r_seq;
+	}
+
+	rwlock_init(&alm.rwlock);
+	atomic_long_set(&alm.shared_var, 0);
+
+	printk(DEV_INFO "Driver inserted\n");
+	return 0;
+
+r_seq:
+	snap_seq_destroy(&alm.seq);
+r_readers:
+	kfree(readers);
+r_dev:
+	device_destroy(alm.class, alm.devno);
+r_class:
+	class_destroy(alm.class);
+r_cdev:
+	cdev_del(alm.cdev);
+r_major:
+	unregister_chrdev_region(alm.devno, 1);
+
+	return -1;
+}
+
+/*
+** This function is called at the last time module removed 
+*/
+static void __exit alm_exit(void)
+{
+	snap_rcu_destroy(&alm.rcu);
+	snap_seq_destroy(&alm.seq);
+	kfree(readers);
+
+	device_destroy(alm.class, alm.devno);
+	class_destroy(alm.class);
+	cdev_del(alm.cdev);
+	unregister_chrdev_region(alm.devno, 1);
+
+	printk(DEV_INFO "Driver removed\n");
+}
+
+module_init(alm_init);
+module_exit(alm_exit);
+
+/* Module description */
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Pudja Mansyurin");
+MODULE_DESCRIPTION(MOD_NAME);
+MODULE_VERSION("3:5.4");
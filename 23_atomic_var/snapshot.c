@@ -0,0 +1,134 @@
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include "snapshot.h"
+
+/**
+ * snap_seq_init - allocate payload of seqcount publisher
+ * @size: payload size in bytes
+ *
+ * Return: errno
+ */
+int snap_seq_init(struct snap_seq *s, size_t size)
+{
+	if ((s->data = kzalloc(size, GFP_KERNEL)) == NULL)
+		return -ENOMEM;
+
+	seqcount_init(&s->seq);
+	spin_lock_init(&s->lock);
+	s->size = size;
+
+	return 0;
+}
+
+/**
+ * snap_seq_destroy - free payload of seqcount publisher
+ */
+void snap_seq_destroy(struct snap_seq *s)
+{
+	kfree(s->data);
+	s->data = NULL;
+}
+
+/**
+ * snap_seq_publish - replace the whole payload
+ * @src: new payload, s->size bytes
+ */
+void snap_seq_publish(struct snap_seq *s, const void *src)
+{
+	spin_lock(&s->lock);
+	write_seqcount_begin(&s->seq);
+	memcpy(s->data, src, s->size);
+	write_seqcount_end(&s->seq);
+	spin_unlock(&s->lock);
+}
+
+/**
+ * snap_seq_read - take a torn-free copy of the payload
+ * @dst: destination, s->size bytes
+ *
+ * Return: number of retries caused by concurrent writers
+ */
+unsigned int snap_seq_read(struct snap_seq *s, void *dst)
+{
+	unsigned int seq, retry = 0;
+
+	for (;;) {
+		seq = read_seqcount_begin(&s->seq);
+		memcpy(dst, s->data, s->size);
+		if (!read_seqcount_retry(&s->seq, seq))
+			break;
+		retry++;
+	}
+
+	return retry;
+}
+
+/**
+ * snap_rcu_init - allocate both buffers of RCU publisher
+ * @size: payload size in bytes
+ *
+ * Return: errno
+ */
+int snap_rcu_init(struct snap_rcu *s, size_t size)
+{
+	s->buf[0] = kzalloc(size, GFP_KERNEL);
+	s->buf[1] = kzalloc(size, GFP_KERNEL);
+	if (s->buf[0] == NULL || s->buf[1] == NULL) {
+		kfree(s->buf[0]);
+		kfree(s->buf[1]);
+		return -ENOMEM;
+	}
+
+	mutex_init(&s->lock);
+	s->size = size;
+	s->next = 1;
+	RCU_INIT_POINTER(s->cur, s->buf[0]);
+
+	return 0;
+}
+
+/**
+ * snap_rcu_destroy - free both buffers of RCU publisher
+ */
+void snap_rcu_destroy(struct snap_rcu *s)
+{
+	RCU_INIT_POINTER(s->cur, NULL);
+	synchronize_rcu();
+	kfree(s->buf[0]);
+	kfree(s->buf[1]);
+}
+
+/**
+ * snap_rcu_publish - fill the idle buffer and publish it
+ * @src: new payload, s->size bytes
+ *
+ * Sleeps for one grace period, so the buffer just retired is free of
+ * readers before the next publish overwrites it.
+ */
+void snap_rcu_publish(struct snap_rcu *s, const void *src)
+{
+	void *dst;
+
+	mutex_lock(&s->lock);
+	dst = s->buf[s->next];
+	memcpy(dst, src, s->size);
+	rcu_assign_pointer(s->cur, dst);
+	s->next ^= 1;
+	synchronize_rcu();
+	mutex_unlock(&s->lock);
+}
+
+/**
+ * snap_rcu_read - copy the published payload
+ * @dst: destination, s->size bytes
+ */
+void snap_rcu_read(struct snap_rcu *s, void *dst)
+{
+	void *src;
+
+	rcu_read_lock();
+	src = rcu_dereference(s->cur);
+	memcpy(dst, src, s->size);
+	rcu_read_unlock();
+}
@@ -0,0 +1,46 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <linux/module.h>
+#include <linux/seqlock.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/rcupdate.h>
+
+/*
+ * Seqcount publisher: for small payloads (a few cachelines). Writers are
+ * serialized by a spinlock, readers copy without any lock and retry when
+ * a write raced with them.
+ */
+struct snap_seq {
+	seqcount_t seq;
+	spinlock_t lock;
+	size_t size;
+	void *data;
+};
+
+/*
+ * RCU double-buffer publisher: for larger payloads. Readers copy from the
+ * published buffer inside an RCU read-side section, writers fill the idle
+ * buffer, publish it and wait a grace period before the next reuse.
+ */
+struct snap_rcu {
+	void __rcu *cur;
+	void *buf[2];
+	unsigned int next;
+	struct mutex lock;
+	size_t size;
+};
+
+/* exported functions */
+int snap_seq_init(struct snap_seq *s, size_t size);
+void snap_seq_destroy(struct snap_seq *s);
+void snap_seq_publish(struct snap_seq *s, const void *src);
+unsigned int snap_seq_read(struct snap_seq *s, void *dst);
+
+int snap_rcu_init(struct snap_rcu *s, size_t size);
+void snap_rcu_destroy(struct snap_rcu *s);
+void snap_rcu_publish(struct snap_rcu *s, const void *src);
+void snap_rcu_read(struct snap_rcu *s, void *dst);
+
+#endif /* __SNAPSHOT_H__ */
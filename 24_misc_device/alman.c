@@ -2,11 +2,40 @@
 #include <linux/miscdevice.h>
 #include <linux/fs.h>
 #include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/poll.h>
+#include <linux/kfifo.h>
+#include <linux/timer.h>
+#include <linux/uaccess.h>
+#include <linux/version.h>
+#include "alman_ioctl.h"
 
 /* Private macros */
 #define MOD_NAME "alman"
 #define DEV_INFO KERN_INFO MOD_NAME ": "
 
+/* Private types */
+struct alm_client {
+	struct list_head node;
+	DECLARE_KFIFO(fifo, struct alm_event, ALM_FIFO_SIZE);
+	wait_queue_head_t wait;
+	struct fasync_struct *fasync;
+	struct mutex read_lock; /* kfifo has a single consumer */
+	unsigned long dropped;
+};
+
+/* Private variables */
+static struct alm_status *alm_status; /* one zeroed page */
+static LIST_HEAD(alm_clients);
+static DEFINE_SPINLOCK(alm_lock); /* clients list and status writers */
+static struct timer_list alm_tick;
+static s32 alm_tick_value;
+
+/* Module parameters */
+static unsigned int tick_ms = 0;
+module_param(tick_ms, uint, 0644);
+MODULE_PARM_DESC(tick_ms, "Period of the kernel state updates, 0 stops them");
+
 /* Module prototypes */
 static int __init alm_init(void);
 static void __exit alm_exit(void);
@@ -17,11 +46,19 @@ static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off);
 static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
 			 loff_t *off);
+static __poll_t alm_poll(struct file *filp, struct poll_table_struct *wait);
+static int alm_fasync(int fd, struct file *filp, int on);
+static int alm_mmap(struct file *filp, struct vm_area_struct *vma);
+static long alm_ioctl(struct file *filp, unsigned int cmd, unsigned long arg);
 
 static struct file_operations fops = {
 	.owner = THIS_MODULE,
 	.read = alm_read,
 	.write = alm_write,
+	.poll = alm_poll,
+	.fasync = alm_fasync,
+	.mmap = alm_mmap,
+	.unlocked_ioctl = alm_ioctl,
 	.open = alm_open,
 	.release = alm_release,
 	.llseek = no_llseek,
@@ -35,10 +72,88 @@ static struct miscdevice alm_miscdev = {
 
 /* Function implementations */
 /*
-** This function is called on device file open 
+ * alm_status_begin - open a status update, called with alm_lock held.
+ * Userspace sees an odd seq until alm_status_end().
+ */
+static void alm_status_begin(struct alm_status *st)
+{
+	WRITE_ONCE(st->seq, st->seq + 1);
+	smp_wmb();
+}
+
+static void alm_status_end(struct alm_status *st)
+{
+	smp_wmb();
+	WRITE_ONCE(st->seq, st->seq + 1);
+}
+
+/*
+ * alm_publish - update the status page and queue the event to every open,
+ * safe from process and softirq context
+ */
+static void alm_publish(s32 value)
+{
+	struct alm_status *st = alm_status;
+	struct alm_client *c;
+	struct alm_event evt = {
+		.ts_ns = ktime_get_ns(),
+		.value = value,
+	};
+
+	spin_lock_bh(&alm_lock);
+
+	alm_status_begin(st);
+	evt.seq = ++st->events;
+	st->last_ns = evt.ts_ns;
+	st->value = value;
+	alm_status_end(st);
+
+	list_for_each_entry (c, &alm_clients, node) {
+		if (!kfifo_put(&c->fifo, evt)) {
+			c->dropped++;
+			continue;
+		}
+		wake_up_interruptible(&c->wait);
+		kill_fasync(&c->fasync, SIGIO, POLL_IN);
+	}
+
+	spin_unlock_bh(&alm_lock);
+}
+
+/*
+** This function is called by the kernel tick, it publishes a counter
+*/
+static void alm_tick_fn(struct timer_list *t)
+{
+	unsigned int ms = READ_ONCE(tick_ms);
+
+	alm_publish(alm_tick_value++);
+	if (ms)
+		mod_timer(&alm_tick, jiffies + msecs_to_jiffies(ms));
+}
+
+/*
+** This function is called on device file open
 */
 static int alm_open(struct inode *inode, struct file *filp)
 {
+	struct alm_client *c;
+
+	if ((c = kzalloc(sizeof(*c), GFP_KERNEL)) == NULL)
+		return -ENOMEM;
+
+	INIT_KFIFO(c->fifo);
+	init_waitqueue_head(&c->wait);
+	mutex_init(&c->read_lock);
+	filp->private_data = c;
+
+	spin_lock_bh(&alm_lock);
+	list_add_tail(&c->node, &alm_clients);
+	alm_status_begin(alm_status);
+	alm_status->clients++;
+	alm_status_end(alm_status);
+	spin_unlock_bh(&alm_lock);
+
 	pr_info(DEV_INFO "Driver open() called\n");
 	return 0;
 }
@@ -48,39 +163,142 @@ static int alm_open(struct inode *inode, struct file *filp)
 */
 static int alm_release(struct inode *inode, struct file *filp)
 {
+	struct alm_client *c = filp->private_data;
+
+	spin_lock_bh(&alm_lock);
+	list_del(&c->node);
+	alm_status_begin(alm_status);
+	alm_status->clients--;
+	alm_status_end(alm_status);
+	spin_unlock_bh(&alm_lock);
+
+	alm_fasync(-1, filp, 0);
+	if (c->dropped)
+		pr_info(DEV_INFO "Client dropped %lu events\n", c->dropped);
+	kfree(c);
+
 	pr_info(DEV_INFO "Driver release() called\n");
 	return 0;
 }
 
 /*
-** This function is called on device file read 
+** This function is called on device file read, it returns an array of
+** struct alm_event queued since the last read. A blocking read waits for
+** at least one event.
 */
 static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off)
 {
-	pr_info(DEV_INFO "Driver read() called\n");
-	return 0;
+	struct alm_client *c = filp->private_data;
+	unsigned int copied;
+	int err;
+
+	if (len < sizeof(struct alm_event))
+		return -EINVAL;
+
+	do {
+		if (kfifo_is_empty(&c->fifo)) {
+			if (filp->f_flags & O_NONBLOCK)
+				return -EAGAIN;
+			if (wait_event_interruptible(
+				    c->wait, !kfifo_is_empty(&c->fifo)))
+				return -ERESTARTSYS;
+		}
+
+		if (mutex_lock_interruptible(&c->read_lock))
+			return -ERESTARTSYS;
+		err = kfifo_to_user(&c->fifo, buf, len, &copied);
+		mutex_unlock(&c->read_lock);
+		if (err < 0)
+			return err;
+	} while (copied == 0); /* raced with another reader */
+
+	return copied;
 }
 
 /*
-** This function is called on device file write 
+** This function is called on device file write, the decimal value is
+** published as a new state
 */
 static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
 			 loff_t *off)
 {
-	// uint8_t *buffer;
+	s32 value;
+	int err;
 
-	pr_info(DEV_INFO "Driver write() called\n");
+	if ((err = kstrtos32_from_user(buf, len, 0, &value)) < 0)
+		return err;
 
-	// if ((buffer = kmalloc(len, GFP_KERNEL)) == NULL)
-	// 	return -ENOMEM;
+	alm_publish(value);
+	return len;
+}
 
-	// if (copy_from_user(buffer, buf, len))
-	// 	return -EFAULT;
+static __poll_t alm_poll(struct file *filp, struct poll_table_struct *wait)
+{
+	struct alm_client *c = filp->private_data;
 
-	/* Do something with kernel buffer */
+	poll_wait(filp, &c->wait, wait);
+	return kfifo_is_empty(&c->fifo) ? 0 : EPOLLIN | EPOLLRDNORM;
+}
 
-	return len;
+/*
+** This function is called on F_SETFL O_ASYNC, SIGIO follows every event
+*/
+static int alm_fasync(int fd, struct file *filp, int on)
+{
+	struct alm_client *c = filp->private_data;
+
+	return fasync_helper(fd, filp, on, &c->fasync);
+}
+
+/*
+ * alm_mmap - map the status page, read-only since the driver is the only
+ * writer
+ */
+static int alm_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start > PAGE_SIZE)
+		return -EINVAL;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+	return remap_pfn_range(vma, vma->vm_start,
+			       virt_to_phys(alm_status) >> PAGE_SHIFT,
+			       vma->vm_end - vma->vm_start, vma->vm_page_prot);
+}
+
+/*
+** This function is called on device file ioctl, the syscall counterpart
+** of a load from the status page
+*/
+static long alm_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+	struct alm_status st;
+	u32 seq;
+
+	switch (cmd) {
+	case ALM_GET_STATUS:
+		do {
+			seq = smp_load_acquire(&alm_status->seq);
+			st = *alm_status;
+			smp_rmb();
+		} while ((seq & 1) || seq != READ_ONCE(alm_status->seq));
+
+		if (copy_to_user((struct alm_status __user *)arg, &st,
+				 sizeof(st)))
+			return -EFAULT;
+		break;
+	default:
+		return -ENOTTY;
+	}
+
+	return 0;
 }
 
 /*
@@ -90,21 +308,35 @@ static int __init alm_init(void)
 {
 	int err;
 
+	alm_status = (struct alm_status *)get_zeroed_page(GFP_KERNEL);
+	if (alm_status == NULL) {
+		pr_err(DEV_INFO "Can't allocate status page\n");
+		return -ENOMEM;
+	}
+
 	if ((err = misc_register(&alm_miscdev))) {
 		pr_err(DEV_INFO "Register failed: %d\n", err);
+		free_page((unsigned long)alm_status);
 		return err;
 	}
 
+	timer_setup(&alm_tick, alm_tick_fn, 0);
+	if (tick_ms)
+		mod_timer(&alm_tick, jiffies + msecs_to_jiffies(tick_ms));
+
 	printk(DEV_INFO "Driver inserted\n");
 	return 0;
 }
 
 /*
-** This function is called at the last time module removed 
+** This function is called at the last time module removed
 */
 static void __exit alm_exit(void)
 {
+	WRITE_ONCE(tick_ms, 0);
+	del_timer_sync(&alm_tick);
 	misc_deregister(&alm_miscdev);
+	free_page((unsigned long)alm_status);
 	printk(DEV_INFO "Driver removed\n");
 }
 
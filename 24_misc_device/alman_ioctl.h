@@ -0,0 +1,44 @@
+#ifndef __ALMAN_IOCTL_H__
+#define __ALMAN_IOCTL_H__
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/* Shared between the driver and the userspace apps */
+#define ALM_DEV_PATH "/dev/alman_misc"
+#define ALM_FIFO_SIZE 256 /* events per open, must be power of 2 */
+
+#define ALM_GET_STATUS _IOR('a', 'a', struct alm_status)
+
+/*
+ * One state change, written to the device as a decimal value or produced
+ * by the periodic kernel tick, and read back as an array of this struct.
+ */
+struct alm_event {
+	__u64 ts_ns; /* CLOCK_MONOTONIC */
+	__u64 seq; /* 1-based, equals status.events when published */
+	__s32 value;
+	__u32 reserved;
+};
+
+/*
+ * Device state, mmap()-ed read-only from offset 0 (one page, shared by
+ * every open). The driver bumps seq to odd before an update and back to
+ * even after it, a reader retries while seq is odd or has changed:
+ *
+ *	do {
+ *		s = load_acquire(&st->seq);
+ *		snapshot = *st;
+ *		fence_acquire();
+ *	} while ((s & 1) || s != st->seq);
+ */
+struct alm_status {
+	__u32 seq;
+	__u32 clients; /* current opens */
+	__u64 events; /* total published */
+	__u64 last_ns; /* ts_ns of the last event */
+	__s32 value; /* last value */
+	__u32 reserved;
+};
+
+#endif /* __ALMAN_IOCTL_H__ */
@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include "alman_ioctl.h"
+
+/*
+ * Usage: ./bench [iterations]
+ *
+ * Two measurements of how fast a client learns the device state:
+ *  - state: cost of one consistent snapshot, a plain load from the
+ *    mmap()-ed status page vs the ALM_GET_STATUS syscall.
+ *  - update: time from before write() of a new value until the client
+ *    sees it, spinning on the status page vs a blocking read().
+ *
+ * Load the module with tick_ms=0, the status page only keeps the last
+ * value so a kernel tick can hide an update from the spinning client.
+ */
+
+#define UPDATE_GAP_US 50
+
+/* Private variables */
+static int dev_fd;
+static int iterations = 100000;
+static const volatile struct alm_status *status;
+static uint64_t *lat;
+static volatile int32_t seen = -1;
+
+/* Private function prototypes */
+static uint64_t now_ns(void);
+static void status_load(struct alm_status *st);
+static void bench_state(void);
+static void *producer_fn(void *arg);
+static void bench_update(const char *mode, int use_mmap);
+static int cmp_u64(const void *a, const void *b);
+static void report(const char *mode, int n);
+
+/* Main function */
+int main(int argc, char *argv[])
+{
+	if (argc > 1)
+		iterations = atoi(argv[1]);
+
+	lat = calloc(iterations, sizeof(*lat));
+	if (lat == NULL || iterations <= 0) {
+		printf("Invalid number of iterations\n");
+		return -1;
+	}
+
+	dev_fd = open(ALM_DEV_PATH, O_RDWR);
+	if (dev_fd < 0) {
+		printf("Can't open device file\n");
+		return -1;
+	}
+
+	status = mmap(NULL, sizeof(*status), PROT_READ, MAP_SHARED, dev_fd, 0);
+	if (status == MAP_FAILED) {
+		printf("Can't map status page\n");
+		close(dev_fd);
+		return -1;
+	}
+
+	bench_state();
+	bench_update("update mmap", 1);
+	bench_update("update read", 0);
+
+	munmap((void *)status, sizeof(*status));
+	close(dev_fd);
+	return 0;
+}
+
+/* Private function definitions */
+uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void status_load(struct alm_status *st)
+{
+	uint32_t seq;
+
+	do {
+		seq = __atomic_load_n(&status->seq, __ATOMIC_ACQUIRE);
+		memcpy(st, (const void *)status, sizeof(*st));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((seq & 1) || seq != status->seq);
+}
+
+void bench_state(void)
+{
+	struct alm_status st;
+	uint64_t t0;
+	int i;
+
+	for (i = 0; i < iterations; i++) {
+		t0 = now_ns();
+		status_load(&st);
+		lat[i] = now_ns() - t0;
+	}
+	report("state mmap", iterations);
+
+	for (i = 0; i < iterations; i++) {
+		t0 = now_ns();
+		if (ioctl(dev_fd, ALM_GET_STATUS, &st) < 0)
+			break;
+		lat[i] = now_ns() - t0;
+	}
+	report("state ioctl", i);
+}
+
+void *producer_fn(void *arg)
+{
+	int fd = *(int *)arg;
+	char buf[16];
+	int i, n;
+
+	for (i = 0; i < iterations; i++) {
+		/* wait until the previous value was seen */
+		while (__atomic_load_n(&seen, __ATOMIC_ACQUIRE) != i - 1)
+			;
+		usleep(UPDATE_GAP_US);
+
+		n = snprintf(buf, sizeof(buf), "%d", i);
+		lat[i] = now_ns();
+		if (write(fd, buf, n) < 0)
+			break;
+	}
+	return NULL;
+}
+
+void bench_update(const char *mode, int use_mmap)
+{
+	struct alm_event evts[ALM_FIFO_SIZE];
+	struct alm_status st;
+	pthread_t producer;
+	uint64_t last_events;
+	ssize_t n, i;
+	int wfd, got = 0;
+
+	/* a separate open, so the producer doesn't share our event queue */
+	wfd = open(ALM_DEV_PATH, O_WRONLY);
+	if (wfd < 0) {
+		printf("Can't open device file\n");
+		return;
+	}
+
+	/* drop whatever queued up before the run */
+	fcntl(dev_fd, F_SETFL, O_NONBLOCK);
+	while (read(dev_fd, evts, sizeof(evts)) > 0)
+		;
+	fcntl(dev_fd, F_SETFL, 0);
+
+	status_load(&st);
+	last_events = st.events;
+
+	__atomic_store_n(&seen, -1, __ATOMIC_RELEASE);
+	pthread_create(&producer, NULL, producer_fn, &wfd);
+
+	while (got < iterations) {
+		if (use_mmap) {
+			/* a new event, the value alone may be stale */
+			status_load(&st);
+			if (st.events == last_events)
+				continue;
+			last_events = st.events;
+			if (st.value != got)
+				continue; /* kernel tick, not ours */
+		} else {
+			n = read(dev_fd, evts, sizeof(evts));
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0)
+				break;
+			for (i = 0; i < n / (ssize_t)sizeof(evts[0]); i++)
+				if (evts[i].value == got)
+					break;
+			if (i == n / (ssize_t)sizeof(evts[0]))
+				continue; /* kernel tick, not ours */
+		}
+
+		lat[got] = now_ns() - lat[got];
+		__atomic_store_n(&seen, got++, __ATOMIC_RELEASE);
+	}
+
+	pthread_join(producer, NULL);
+	close(wfd);
+	report(mode, got);
+}
+
+int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+void report(const char *mode, int n)
+{
+	uint64_t sum = 0;
+	int i;
+
+	printf("%-12s: ", mode);
+	if (n <= 0) {
+		printf("failed\n");
+		return;
+	}
+
+	qsort(lat, n, sizeof(*lat), cmp_u64);
+	for (i = 0; i < n; i++)
+		sum += lat[i];
+
+	printf("n %d avg %lu p50 %lu p99 %lu max %lu ns\n", n,
+	       (unsigned long)(sum / n), (unsigned long)lat[n / 2],
+	       (unsigned long)lat[(uint64_t)n * 99 / 100],
+	       (unsigned long)lat[n - 1]);
+}
@@ -1,14 +1,38 @@
 #include <linux/module.h>
 #include <linux/miscdevice.h>
 #include <linux/fs.h>
-#include <linux/slab.h>
 #include <linux/gpio.h>
-#include <linux/delay.h>
+#include <linux/gpio/consumer.h>
+#include <linux/gpio/driver.h>
+#include <linux/gpio/machine.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/bitmap.h>
+#include <linux/uaccess.h>
+#include "alman_ioctl.h"
 
 /* Private macros */
 #define MOD_NAME "alman"
 #define DEV_INFO KERN_INFO MOD_NAME ": "
 #define GPIO_LED (23)
+#define STAT_BUF_SIZE 16
+
+/* Private variables */
+static struct platform_device *alm_pdev; /* consumer of the lines */
+static struct gpiod_lookup_table *alm_lookup;
+static struct gpio_descs *alm_gpios; /* bit N is desc[N] */
+static u32 alm_all_mask; /* every requested line */
+static u32 alm_out_mask; /* lines driven as outputs */
+
+/* Module parameters */
+static int gpios[ALM_GPIO_MAX] = { GPIO_LED };
+static int nr_gpios = 1;
+module_param_array(gpios, int, &nr_gpios, 0444);
+MODULE_PARM_DESC(gpios, "GPIO number of every line, bit N is gpios[N]");
+
+static uint out_mask = ~0U;
+module_param(out_mask, uint, 0444);
+MODULE_PARM_DESC(out_mask, "Lines configured as outputs, the rest are inputs");
 
 /* Module prototypes */
 static int __init alm_init(void);
@@ -20,11 +44,13 @@ static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off);
 static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
 			 loff_t *off);
+static long alm_ioctl(struct file *filp, unsigned int cmd, unsigned long arg);
 
 static struct file_operations fops = {
 	.owner = THIS_MODULE,
 	.read = alm_read,
 	.write = alm_write,
+	.unlocked_ioctl = alm_ioctl,
 	.open = alm_open,
 	.release = alm_release,
 	// .llseek = no_llseek,
@@ -38,7 +64,123 @@ static struct miscdevice alm_miscdev = {
 
 /* Function implementations */
 /*
-** This function is called on device file open 
+ * alm_gpio_set - drive the lines in mask to the matching bits of value,
+ * with one gpiolib call that batches lines sharing a chip
+ */
+static int alm_gpio_set(u32 mask, u32 value)
+{
+	struct gpio_desc *descs[ALM_GPIO_MAX];
+	DECLARE_BITMAP(bits, ALM_GPIO_MAX);
+	unsigned long m = mask;
+	unsigned int i, n = 0;
+
+	if (mask & ~alm_out_mask)
+		return -EINVAL;
+
+	/*
+	 * every line: bit N already is array index N, and the array info
+	 * lets gpiolib write a whole chip at once
+	 */
+	if (mask == alm_all_mask) {
+		bits[0] = value;
+		return gpiod_set_array_value_cansleep(alm_gpios->ndescs,
+						      alm_gpios->desc,
+						      alm_gpios->info, bits);
+	}
+
+	bitmap_zero(bits, ALM_GPIO_MAX);
+	for_each_set_bit (i, &m, ALM_GPIO_MAX) {
+		descs[n] = alm_gpios->desc[i];
+		__assign_bit(n, bits, value & BIT(i));
+		n++;
+	}
+
+	return n ? gpiod_set_array_value_cansleep(n, descs, NULL, bits) : 0;
+}
+
+/*
+ * alm_gpio_get - sample the lines in mask, in one gpiolib call
+ * Return: 0 with the levels in *value, or a negative errno
+ */
+static int alm_gpio_get(u32 mask, u32 *value)
+{
+	struct gpio_desc *descs[ALM_GPIO_MAX];
+	DECLARE_BITMAP(bits, ALM_GPIO_MAX);
+	unsigned long m = mask;
+	unsigned int i, n = 0;
+	int err;
+
+	*value = 0;
+	if (mask & ~alm_all_mask)
+		return -EINVAL;
+
+	if (mask == alm_all_mask) {
+		err = gpiod_get_array_value_cansleep(alm_gpios->ndescs,
+						     alm_gpios->desc,
+						     alm_gpios->info, bits);
+		if (err == 0)
+			*value = bits[0] & mask;
+		return err;
+	}
+
+	for_each_set_bit (i, &m, ALM_GPIO_MAX)
+		descs[n++] = alm_gpios->desc[i];
+	if (n == 0)
+		return 0;
+
+	if ((err = gpiod_get_array_value_cansleep(n, descs, NULL, bits)) < 0)
+		return err;
+
+	n = 0;
+	for_each_set_bit (i, &m, ALM_GPIO_MAX)
+		if (test_bit(n++, bits))
+			*value |= BIT(i);
+	return 0;
+}
+
+/*
+ * alm_lookup_add - describe the gpios param as lines of alm_pdev, so they
+ * are acquired as one array. A legacy number becomes chip label and
+ * offset, chips must have unique labels.
+ * Return: 0 or a negative errno
+ */
+static int alm_lookup_add(void)
+{
+	struct gpio_desc *desc;
+	struct gpio_chip *chip;
+	int i;
+
+	alm_lookup = kzalloc(struct_size(alm_lookup, table, nr_gpios + 1),
+			     GFP_KERNEL);
+	if (alm_lookup == NULL)
+		return -ENOMEM;
+
+	alm_lookup->dev_id = dev_name(&alm_pdev->dev);
+	for (i = 0; i < nr_gpios; i++) {
+		if ((desc = gpio_to_desc(gpios[i])) == NULL ||
+		    (chip = gpiod_to_chip(desc)) == NULL) {
+			pr_err(DEV_INFO "GPIO %d doesn't exist\n", gpios[i]);
+			kfree(alm_lookup);
+			return -ENODEV;
+		}
+
+		alm_lookup->table[i] = (struct gpiod_lookup)GPIO_LOOKUP_IDX(
+			chip->label, gpios[i] - chip->base, NULL, i,
+			GPIO_ACTIVE_HIGH);
+	}
+
+	gpiod_add_lookup_table(alm_lookup);
+	return 0;
+}
+
+static void alm_lookup_del(void)
+{
+	gpiod_remove_lookup_table(alm_lookup);
+	kfree(alm_lookup);
+}
+
+/*
+** This function is called on device file open
 */
 static int alm_open(struct inode *inode, struct file *filp)
 {
@@ -56,61 +198,67 @@ static int alm_release(struct inode *inode, struct file *filp)
 }
 
 /*
-** This function is called on device file read 
+** This function is called on device file read, it returns the level of
+** every line as a hex bitmask
 */
 static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off)
 {
-	bool led_state;
+	char kbuf[STAT_BUF_SIZE];
+	u32 value;
+	int err, n;
 
-	pr_info(DEV_INFO "Driver read() called\n");
-
-	led_state = gpio_get_value(GPIO_LED);
-	if (copy_to_user(buf, &led_state, 1)) {
-		pr_err(DEV_INFO "Failed copy to user\n");
-		return -EFAULT;
-	}
+	if ((err = alm_gpio_get(alm_all_mask, &value)) < 0)
+		return err;
 
-	pr_info(DEV_INFO "Read GPIO_LED = %d\n", led_state);
-	return 0;
+	n = scnprintf(kbuf, sizeof(kbuf), "0x%08x\n", value);
+	return simple_read_from_buffer(buf, len, off, kbuf, n);
 }
 
 /*
-** This function is called on device file write 
+** This function is called on device file write, "1" or "0" drives every
+** output line
 */
 static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
 			 loff_t *off)
 {
-	int err = 0;
-	uint8_t *buffer;
-	bool led_state;
-
-	pr_info(DEV_INFO "Driver write() called\n");
+	bool state;
+	int err;
 
-	if ((buffer = kmalloc(len, GFP_KERNEL)) == NULL) {
-		return -ENOMEM;
-	}
+	if ((err = kstrtobool_from_user(buf, len, &state)) < 0)
+		return err;
 
-	if (copy_from_user(buffer, buf, len)) {
-		err = -EFAULT;
-		goto r_kmalloc;
-	}
+	if ((err = alm_gpio_set(alm_out_mask, state ? ~0U : 0)) < 0)
+		return err;
 
-	/* Do something with kernel buffer */
-	if (kstrtobool(buffer, &led_state) < 0) {
-		pr_err(DEV_INFO "Invalid command state\n");
-		err = -EFAULT;
-		goto r_kmalloc;
-	}
+	return len;
+}
 
-	gpio_set_value(GPIO_LED, led_state);
+/*
+** This function is called on device file ioctl, one call covers every
+** line in the mask
+*/
+static long alm_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+	struct alm_gpio_mask __user *uarg = (void __user *)arg;
+	struct alm_gpio_mask m;
+	int err;
 
-	kfree(buffer);
-	return len;
+	if (copy_from_user(&m, uarg, sizeof(m)))
+		return -EFAULT;
 
-r_kmalloc:
-	kfree(buffer);
-	return err;
+	switch (cmd) {
+	case GPIO_SET:
+		return alm_gpio_set(m.mask, m.value);
+	case GPIO_GET:
+		if ((err = alm_gpio_get(m.mask, &m.value)) < 0)
+			return err;
+		if (put_user(m.value, &uarg->value))
+			return -EFAULT;
+		return 0;
+	default:
+		return -ENOTTY;
+	}
 }
 
 /*
@@ -118,38 +266,61 @@ r_kmalloc:
 */
 static int __init alm_init(void)
 {
-	int err;
+	int i, err;
 
-	if ((err = misc_register(&alm_miscdev))) {
-		pr_err(DEV_INFO "Register failed: %d\n", err);
-		return err;
+	if (nr_gpios < 1) {
+		pr_err(DEV_INFO "No GPIO given\n");
+		return -EINVAL;
 	}
 
-	/* GPIO: check is valid */
-	if (gpio_is_valid(GPIO_LED) == false) {
-		pr_err(DEV_INFO "GPIO %d is invalid\n", GPIO_LED);
-		return -EINVAL;
+	/* Lines first, the device is usable as soon as it is registered */
+	alm_pdev = platform_device_register_simple(
+		MOD_NAME, PLATFORM_DEVID_NONE, NULL, 0);
+	if (IS_ERR(alm_pdev)) {
+		pr_err(DEV_INFO "Can't register platform device\n");
+		return PTR_ERR(alm_pdev);
 	}
 
-	/* GPIO: request to kernel */
-	if (gpio_request(GPIO_LED, "GPIO_LED") < 0) {
-		pr_err(DEV_INFO "GPIO %d failed request\n", GPIO_LED);
-		goto r_gpio;
+	if ((err = alm_lookup_add()) < 0)
+		goto r_pdev;
+
+	alm_gpios = gpiod_get_array(&alm_pdev->dev, NULL, GPIOD_ASIS);
+	if (IS_ERR(alm_gpios)) {
+		err = PTR_ERR(alm_gpios);
+		pr_err(DEV_INFO "GPIO request failed: %d\n", err);
+		goto r_lookup;
 	}
 
-	/* GPIO: set as output */
-	gpio_direction_output(GPIO_LED, 0);
+	for (i = 0; i < nr_gpios; i++) {
+		if (out_mask & BIT(i))
+			err = gpiod_direction_output(alm_gpios->desc[i], 0);
+		else
+			err = gpiod_direction_input(alm_gpios->desc[i]);
+		if (err < 0) {
+			pr_err(DEV_INFO "GPIO %d can't set direction\n",
+			       gpios[i]);
+			goto r_gpio;
+		}
+	}
+	alm_all_mask = (u32)GENMASK(nr_gpios - 1, 0);
+	alm_out_mask = out_mask & alm_all_mask;
 
-	/* GPIO: export to sysfs */
-	gpio_export(GPIO_LED, false);
+	if ((err = misc_register(&alm_miscdev))) {
+		pr_err(DEV_INFO "Register failed: %d\n", err);
+		goto r_gpio;
+	}
 
-	printk(DEV_INFO "Driver inserted\n");
+	printk(DEV_INFO "Driver inserted, %d line(s)\n", nr_gpios);
 	return 0;
 
 r_gpio:
-	gpio_free(GPIO_LED);
+	gpiod_put_array(alm_gpios);
+r_lookup:
+	alm_lookup_del();
+r_pdev:
+	platform_device_unregister(alm_pdev);
 
-	return -1;
+	return err;
 }
 
 /*
@@ -157,10 +328,11 @@ r_gpio:
 */
 static void __exit alm_exit(void)
 {
-	gpio_unexport(GPIO_LED);
-	gpio_free(GPIO_LED);
-
 	misc_deregister(&alm_miscdev);
+	gpiod_put_array(alm_gpios);
+	alm_lookup_del();
+	platform_device_unregister(alm_pdev);
+
 	printk(DEV_INFO "Driver removed\n");
 }
 
@@ -0,0 +1,24 @@
+#ifndef __ALMAN_IOCTL_H__
+#define __ALMAN_IOCTL_H__
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/* Shared between the driver and the userspace apps */
+#define ALM_DEV_PATH "/dev/alman_misc"
+#define ALM_GPIO_MAX 32 /* one bit per line, in "gpios" param order */
+
+/*
+ * Bitmask access to every line in one syscall. Only the lines set in
+ * mask are touched: GPIO_SET drives them to the matching bits of value,
+ * GPIO_GET returns their level in value (other bits read as 0).
+ */
+struct alm_gpio_mask {
+	__u32 mask;
+	__u32 value;
+};
+
+#define GPIO_SET _IOW('a', 'a', struct alm_gpio_mask)
+#define GPIO_GET _IOWR('a', 'b', struct alm_gpio_mask)
+
+#endif /* __ALMAN_IOCTL_H__ */
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include "alman_ioctl.h"
+
+/*
+ * Usage: ./app get [mask]
+ *        ./app set <mask> <value>
+ *        ./app bench <mask> [cycles]
+ *
+ * Without hardware, make test runs gpio_sim_test.sh: it backs the lines
+ * with gpio-sim (configfs, 5.17+) and checks GPIO_SET on the simulated
+ * lines and GPIO_GET against their pulls. On older kernels gpio-mockup
+ * gives lines as well:
+ *
+ *   modprobe gpio-mockup gpio_mockup_ranges=-1,16
+ *   insmod alman.ko gpios=B,B+1,...,B+15
+ *
+ * with the chip's base B from /sys/kernel/debug/gpio, and inputs driven
+ * through its debugfs files.
+ */
+
+/* Private function prototypes */
+static uint64_t now_ns(void);
+static int bench(int fd, uint32_t mask, int cycles);
+
+/* Main function */
+int main(int argc, char *argv[])
+{
+	struct alm_gpio_mask m = { .mask = ~0U };
+	int fd, ret = 0;
+
+	if (argc < 2) {
+		printf("Usage: %s <get [mask]|set <mask> <value>|"
+		       "bench <mask> [cycles]>\n", argv[0]);
+		return -1;
+	}
+
+	fd = open(ALM_DEV_PATH, O_RDWR);
+	if (fd < 0) {
+		printf("Can't open device file\n");
+		return -1;
+	}
+
+	if (strcmp(argv[1], "get") == 0) {
+		if (argc > 2)
+			m.mask = strtoul(argv[2], NULL, 0);
+		ret = ioctl(fd, GPIO_GET, &m);
+		if (ret == 0)
+			printf("mask 0x%08x value 0x%08x\n", m.mask, m.value);
+	} else if (strcmp(argv[1], "set") == 0 && argc > 3) {
+		m.mask = strtoul(argv[2], NULL, 0);
+		m.value = strtoul(argv[3], NULL, 0);
+		ret = ioctl(fd, GPIO_SET, &m);
+	} else if (strcmp(argv[1], "bench") == 0 && argc > 2) {
+		ret = bench(fd, strtoul(argv[2], NULL, 0),
+			    argc > 3 ? atoi(argv[3]) : 100000);
+	} else {
+		ret = -1;
+	}
+
+	if (ret)
+		printf("Failed call to ioctl\n");
+
+	close(fd);
+	return ret;
+}
+
+/* Private function definitions */
+uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Toggle the output lines in mask, one syscall per cycle */
+int bench(int fd, uint32_t mask, int cycles)
+{
+	struct alm_gpio_mask m = { .mask = mask };
+	uint64_t start, elapsed;
+	int i;
+
+	if (cycles <= 0)
+		return -1;
+
+	start = now_ns();
+	for (i = 0; i < cycles; i++) {
+		m.value = (i & 1) ? ~0U : 0;
+		if (ioctl(fd, GPIO_SET, &m))
+			return -1;
+	}
+	elapsed = now_ns() - start;
+
+	printf("mask:   0x%08x\n", mask);
+	printf("cycles: %d\n", cycles);
+	printf("cost:   %lu ns/cycle\n", (unsigned long)(elapsed / cycles));
+	return 0;
+}
@@ -0,0 +1,111 @@
+#!/bin/sh
+#
+# Run the bitmask ioctl against eight gpio-sim lines (5.17+,
+# CONFIG_GPIO_SIM): GPIO_SET must drive exactly the masked outputs, seen
+# on the simulated lines, GPIO_GET must return the simulated pulls of the
+# inputs, and a mask with an input must be refused. The all-lines fast
+# path is covered by a second load with every line an output.
+#
+# Build first (make), then run as root from anywhere: ./gpio_sim_test.sh
+# Exits non-zero if any check fails.
+
+set -eu
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+MOD=$HERE/alman.ko
+APP=$(mktemp -d)/app
+CFG=/sys/kernel/config/gpio-sim/alman-test
+DEV=/dev/alman_misc
+fail=0
+
+cleanup() {
+	rmmod alman 2>/dev/null || true
+	if [ -d $CFG ]; then
+		echo 0 > $CFG/live || true
+		rmdir $CFG/bank0 $CFG || true
+	fi
+	rm -rf "$(dirname "$APP")"
+}
+
+check() {
+	if [ "$2" = "$3" ]; then
+		echo "ok   $1"
+	else
+		echo "FAIL $1: expected '$2', got '$3'"
+		fail=1
+	fi
+}
+
+sim_pull() {
+	echo "$2" > $SIM/sim_gpio$1/pull
+}
+
+# levels of lines 0..n-1 of the simulator, line 0 first
+sim_values() {
+	for i in $(seq 0 $(($1 - 1))); do
+		printf "%s" "$(cat $SIM/sim_gpio$i/value)"
+	done
+}
+
+trap cleanup EXIT
+
+${CC:-cc} -o "$APP" "$HERE/app.c"
+modprobe gpio-sim
+mountpoint -q /sys/kernel/debug || mount -t debugfs none /sys/kernel/debug
+
+mkdir $CFG $CFG/bank0
+echo 8 > $CFG/bank0/num_lines
+echo 1 > $CFG/live
+
+CHIP=$(cat $CFG/bank0/chip_name)
+SIM=/sys/devices/platform/$(cat $CFG/dev_name)/$CHIP
+BASE=$(sed -n "s/^$CHIP: GPIOs \([0-9]*\)-.*/\1/p" /sys/kernel/debug/gpio)
+[ -n "$BASE" ] || { echo "no base for $CHIP"; exit 1; }
+GPIOS=$(seq -s, $BASE $((BASE + 7)))
+
+# lines 0-3 outputs, 4-7 inputs
+insmod $MOD gpios=$GPIOS out_mask=0x0f
+
+check "outputs start low" "0000" "$(sim_values 4)"
+"$APP" set 0x0f 0x05 >/dev/null
+check "set 0x0f 0x05" "1010" "$(sim_values 4)"
+"$APP" set 0x06 0x06 >/dev/null
+check "set 0x06 0x06 leaves lines 0 and 3" "1110" "$(sim_values 4)"
+if "$APP" set 0x10 0x10 >/dev/null; then
+	check "set on an input" "refused" "accepted"
+else
+	check "set on an input" "refused" "refused"
+fi
+
+# inputs 5 and 7 pulled up, 4 and 6 down
+sim_pull 4 pull-down
+sim_pull 5 pull-up
+sim_pull 6 pull-down
+sim_pull 7 pull-up
+check "get 0xf0" "mask 0x000000f0 value 0x000000a0" "$("$APP" get 0xf0)"
+check "get 0x20" "mask 0x00000020 value 0x00000020" "$("$APP" get 0x20)"
+check "get 0xff" "mask 0x000000ff value 0x000000a7" "$("$APP" get 0xff)"
+sim_pull 5 pull-down
+check "get 0xff after pull-down" "mask 0x000000ff value 0x00000087" \
+	"$("$APP" get 0xff)"
+check "read" "0x00000087" "$(cat $DEV)"
+
+# write drives every output, the inputs stay as pulled
+echo 0 > $DEV
+check "write 0" "0000" "$(sim_values 4)"
+echo 1 > $DEV
+check "write 1" "1111" "$(sim_values 4)"
+check "read after write 1" "0x0000008f" "$(cat $DEV)"
+
+rmmod alman
+
+# every line an output: mask == all takes the array fast path
+insmod $MOD gpios=$GPIOS out_mask=0xff
+"$APP" set 0xff 0x3c >/dev/null
+check "all outputs set 0xff 0x3c" "00111100" "$(sim_values 8)"
+check "all outputs get" "mask 0x000000ff value 0x0000003c" \
+	"$("$APP" get 0xff)"
+"$APP" set 0xff 0xc3 >/dev/null
+check "all outputs set 0xff 0xc3" "11000011" "$(sim_values 8)"
+
+exit $fail
@@ -1,24 +1,65 @@
 #include <linux/module.h>
 #include <linux/miscdevice.h>
 #include <linux/fs.h>
-#include <linux/slab.h>
 #include <linux/gpio.h>
-#include <linux/delay.h>
 #include <linux/interrupt.h>
+#include <linux/kfifo.h>
+#include <linux/poll.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include "alman_ioctl.h"
 
 /* Private macros */
 #define MOD_NAME "alman"
 #define DEV_INFO KERN_INFO MOD_NAME ": "
 
-#define USE_SW_DEBOUNCE (1)
-#define DEBOUNCE_MS (250)
 #define GPIO_LED (23)
 #define GPIO_BTN (24)
+#define MAX_LINES 8
+#define RAW_FIFO_SIZE 256 /* edges per line between two thread runs */
+#define EDGE_FIFO_SIZE 4096 /* debounced edges waiting for read() */
+
+/* Private types */
+struct alm_line {
+	unsigned int index;
+	int gpio;
+	int irq;
+	bool cansleep;
+	bool primary; /* gpio_edge_handler() runs, the irq is not nested */
+	/* hard irq -> thread, single producer and single consumer */
+	DECLARE_KFIFO(raw, struct alm_edge, RAW_FIFO_SIZE);
+	u64 last_ns; /* last accepted edge, thread only */
+	/* statistic */
+	u64 irqs;
+	u64 accepted;
+	u64 bounced;
+	u64 overruns; /* raw fifo full in hard irq */
+};
 
-#if (USE_SW_DEBOUNCE)
-#include <linux/jiffies.h>
-static unsigned long last_jiffies = 0;
-#endif
+/* Private variables */
+static struct alm_line alm_lines[MAX_LINES];
+static DEFINE_KFIFO(alm_edges, struct alm_edge, EDGE_FIFO_SIZE);
+static DEFINE_SPINLOCK(alm_edges_lock); /* producers: one thread per line */
+static DEFINE_MUTEX(alm_read_lock);
+static DECLARE_WAIT_QUEUE_HEAD(alm_wait);
+static u64 alm_edges_lost; /* edge fifo full, under alm_edges_lock */
+static struct dentry *alm_debugfs;
+
+/* Module parameters */
+static int gpios[MAX_LINES] = { GPIO_BTN };
+static int nr_gpios = 1;
+module_param_array(gpios, int, &nr_gpios, 0444);
+MODULE_PARM_DESC(gpios, "Input GPIO of every line");
+
+static int led_gpio = GPIO_LED;
+module_param(led_gpio, int, 0444);
+MODULE_PARM_DESC(led_gpio, "Output mirroring line 0, -1 disables");
+
+static ulong debounce_ns = 0;
+module_param(debounce_ns, ulong, 0644);
+MODULE_PARM_DESC(debounce_ns, "Edges closer than this to the last one are "
+			      "dropped, 0 keeps every edge");
 
 /* Module prototypes */
 static int __init alm_init(void);
@@ -28,13 +69,12 @@ static int alm_open(struct inode *inode, struct file *filp);
 static int alm_release(struct inode *inode, struct file *filp);
 static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off);
-static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
-			 loff_t *off);
+static __poll_t alm_poll(struct file *filp, struct poll_table_struct *wait);
 
 static struct file_operations fops = {
 	.owner = THIS_MODULE,
 	.read = alm_read,
-	.write = alm_write,
+	.poll = alm_poll,
 	.open = alm_open,
 	.release = alm_release,
 };
@@ -46,29 +86,98 @@ static struct miscdevice alm_miscdev = {
 };
 
 /* Function implementations */
-/* 
- * GPIO interrupt handler 
+/*
+ * GPIO interrupt handler, hard irq context: timestamp the edge and leave
+ * everything else to the thread
  */
-static irqreturn_t gpio_button_handler(int irq, void *dev_id)
+static irqreturn_t gpio_edge_handler(int irq, void *dev_id)
 {
-	unsigned long flags;
+	struct alm_line *line = dev_id;
+	struct alm_edge e = {
+		.ts_ns = ktime_get_ns(),
+		.line = line->index,
+		.level = line->cansleep ? -1 : gpio_get_value(line->gpio),
+	};
+
+	WRITE_ONCE(line->primary, true);
+	line->irqs++;
+	if (!kfifo_put(&line->raw, e))
+		line->overruns++;
+
+	return IRQ_WAKE_THREAD;
+}
 
-#if USE_SW_DEBOUNCE
-	if ((jiffies - last_jiffies) < msecs_to_jiffies(DEBOUNCE_MS)) {
-		return IRQ_HANDLED;
+/*
+ * gpio_edge_nested - queue the edge of an irq nested in the thread of a
+ * controller behind a bus, e.g. an I2C expander: the core never calls
+ * gpio_edge_handler() then. The timestamp is only taken here, after the
+ * controller thread read its status over the bus, so it lags the edge by
+ * that transfer, typically tens to hundreds of us, and edges closer than
+ * that merge into one.
+ */
+static void gpio_edge_nested(struct alm_line *line)
+{
+	struct alm_edge e = {
+		.ts_ns = ktime_get_ns(),
+		.line = line->index,
+		.level = gpio_get_value_cansleep(line->gpio),
+	};
+
+	line->irqs++;
+	if (!kfifo_put(&line->raw, e))
+		line->overruns++;
+}
+
+/*
+ * GPIO interrupt thread: debounce and publish every edge queued since the
+ * last run. Wakeups coalesce, so one run may drain many edges.
+ */
+static irqreturn_t gpio_edge_thread(int irq, void *dev_id)
+{
+	struct alm_line *line = dev_id;
+	u64 debounce = READ_ONCE(debounce_ns);
+	struct alm_edge e;
+	bool woken = false;
+	int level = -1;
+
+	/* the hard handler sets it before waking us, so clear means nested */
+	if (!READ_ONCE(line->primary))
+		gpio_edge_nested(line);
+
+	while (kfifo_get(&line->raw, &e)) {
+		if (line->accepted && e.ts_ns - line->last_ns < debounce) {
+			line->bounced++;
+			continue;
+		}
+		line->last_ns = e.ts_ns;
+		line->accepted++;
+
+		/*
+		 * sleeping controllers with a hard irq, e.g. gpio-sim: only
+		 * the newest edge gets a level
+		 */
+		if (e.level < 0 && kfifo_is_empty(&line->raw))
+			e.level = gpio_get_value_cansleep(line->gpio);
+		level = e.level;
+
+		spin_lock(&alm_edges_lock);
+		if (!kfifo_put(&alm_edges, e))
+			alm_edges_lost++;
+		spin_unlock(&alm_edges_lock);
+		woken = true;
 	}
-#endif
 
-	local_irq_save(flags);
-	gpio_set_value(GPIO_LED, gpio_get_value(GPIO_BTN));
-	pr_info(DEV_INFO "Button interrupt handler called\n");
-	local_irq_restore(flags);
+	if (woken) {
+		wake_up_interruptible(&alm_wait);
+		if (line->index == 0 && led_gpio >= 0 && level >= 0)
+			gpio_set_value_cansleep(led_gpio, level);
+	}
 
 	return IRQ_HANDLED;
 }
 
 /*
-** This function is called on device file open 
+** This function is called on device file open
 */
 static int alm_open(struct inode *inode, struct file *filp)
 {
@@ -86,139 +195,174 @@ static int alm_release(struct inode *inode, struct file *filp)
 }
 
 /*
-** This function is called on device file read 
+** This function is called on device file read, it returns an array of
+** struct alm_edge. A blocking read waits for at least one edge.
 */
 static ssize_t alm_read(struct file *filp, char __user *buf, size_t len,
 			loff_t *off)
 {
-	bool led_state;
+	unsigned int copied;
+	int err;
 
-	pr_info(DEV_INFO "Driver read() called\n");
+	if (len < sizeof(struct alm_edge))
+		return -EINVAL;
+
+	do {
+		if (kfifo_is_empty(&alm_edges)) {
+			if (filp->f_flags & O_NONBLOCK)
+				return -EAGAIN;
+			if (wait_event_interruptible(
+				    alm_wait, !kfifo_is_empty(&alm_edges)))
+				return -ERESTARTSYS;
+		}
+
+		if (mutex_lock_interruptible(&alm_read_lock))
+			return -ERESTARTSYS;
+		err = kfifo_to_user(&alm_edges, buf, len, &copied);
+		mutex_unlock(&alm_read_lock);
+		if (err < 0)
+			return err;
+	} while (copied == 0); /* raced with another reader */
+
+	return copied;
+}
 
-	led_state = gpio_get_value(GPIO_LED);
-	if (copy_to_user(buf, &led_state, 1)) {
-		pr_err(DEV_INFO "Failed copy to user\n");
-		return -EFAULT;
-	}
+static __poll_t alm_poll(struct file *filp, struct poll_table_struct *wait)
+{
+	poll_wait(filp, &alm_wait, wait);
+	return kfifo_is_empty(&alm_edges) ? 0 : EPOLLIN | EPOLLRDNORM;
+}
 
-	pr_info(DEV_INFO "Read GPIO_LED = %d\n", led_state);
+static int alm_stats_show(struct seq_file *m, void *unused)
+{
+	struct alm_line *line;
+	int i;
+
+	seq_printf(m, "debounce: %lu ns\n", READ_ONCE(debounce_ns));
+	seq_printf(m, "queued:   %u\n", kfifo_len(&alm_edges));
+	seq_printf(m, "lost:     %llu\n\n", READ_ONCE(alm_edges_lost));
+
+	seq_printf(m, "%4s %5s %12s %12s %12s %10s\n", "line", "gpio", "irqs",
+		   "accepted", "bounced", "overruns");
+	for (i = 0; i < nr_gpios; i++) {
+		line = &alm_lines[i];
+		seq_printf(m, "%4u %5d %12llu %12llu %12llu %10llu\n",
+			   line->index, line->gpio, READ_ONCE(line->irqs),
+			   READ_ONCE(line->accepted), READ_ONCE(line->bounced),
+			   READ_ONCE(line->overruns));
+	}
 	return 0;
 }
 
+DEFINE_SHOW_ATTRIBUTE(alm_stats);
+
 /*
-** This function is called on device file write 
-*/
-static ssize_t alm_write(struct file *filp, const char __user *buf, size_t len,
-			 loff_t *off)
+ * alm_line_setup - request one input line and its threaded irq
+ * Return: 0 on success, or a negative errno
+ */
+static int alm_line_setup(struct alm_line *line, unsigned int index, int gpio)
 {
-	int err = 0;
-	uint8_t *buffer;
-	bool led_state;
+	int err;
 
-	pr_info(DEV_INFO "Driver write() called\n");
+	line->index = index;
+	line->gpio = gpio;
+	INIT_KFIFO(line->raw);
 
-	if ((buffer = kmalloc(len, GFP_KERNEL)) == NULL) {
-		return -ENOMEM;
+	if (!gpio_is_valid(gpio) || gpio_request(gpio, MOD_NAME "_btn") < 0) {
+		pr_err(DEV_INFO "GPIO %d failed request\n", gpio);
+		return -EBUSY;
 	}
+	gpio_direction_input(gpio);
+	line->cansleep = gpio_cansleep(gpio);
 
-	if (copy_from_user(buffer, buf, len)) {
-		err = -EFAULT;
-		goto r_kmalloc;
+	if ((line->irq = gpio_to_irq(gpio)) < 0) {
+		pr_err(DEV_INFO "GPIO %d has no irq\n", gpio);
+		err = line->irq;
+		goto r_gpio;
 	}
 
-	/* Do something with kernel buffer */
-	if (kstrtobool(buffer, &led_state) < 0) {
-		pr_err(DEV_INFO "Invalid command state\n");
-		err = -EFAULT;
-		goto r_kmalloc;
+	/* no IRQF_ONESHOT, edges keep being timestamped during the thread */
+	err = request_threaded_irq(line->irq, gpio_edge_handler,
+				   gpio_edge_thread,
+				   IRQF_TRIGGER_RISING | IRQF_TRIGGER_FALLING,
+				   MOD_NAME "_dev", line);
+	if (err < 0) {
+		pr_err(DEV_INFO "Can't register IRQ for GPIO %d\n", gpio);
+		goto r_gpio;
 	}
+	return 0;
 
-	gpio_set_value(GPIO_LED, led_state);
-
-	kfree(buffer);
-	return len;
-
-r_kmalloc:
-	kfree(buffer);
+r_gpio:
+	gpio_free(gpio);
 	return err;
 }
 
+static void alm_line_cleanup(struct alm_line *line)
+{
+	free_irq(line->irq, line);
+	gpio_free(line->gpio);
+}
+
 /*
 ** This function is called at the first time module inserted
 */
 static int __init alm_init(void)
 {
-	int err;
-
-	if ((err = misc_register(&alm_miscdev))) {
-		pr_err(DEV_INFO "Register failed: %d\n", err);
-		return err;
-	}
-
-	/* GPIO: check is valid */
-	if (gpio_is_valid(GPIO_LED) == false) {
-		pr_err(DEV_INFO "GPIO %d is invalid\n", GPIO_LED);
-		goto r_misc;
-	}
+	int i, err;
 
-	/* GPIO: request to kernel */
-	if (gpio_request(GPIO_LED, "GPIO_LED") < 0) {
-		pr_err(DEV_INFO "GPIO %d failed request\n", GPIO_LED);
-		goto r_gpio_led;
+	if (nr_gpios < 1) {
+		pr_err(DEV_INFO "No GPIO given\n");
+		return -EINVAL;
 	}
 
-	if (gpio_request(GPIO_BTN, "GPIO_BTN") < 0) {
-		pr_err(DEV_INFO "GPIO %d failed request\n", GPIO_BTN);
-		goto r_gpio_btn;
+	if (led_gpio >= 0) {
+		if (!gpio_is_valid(led_gpio) ||
+		    gpio_request(led_gpio, "GPIO_LED") < 0) {
+			pr_err(DEV_INFO "GPIO %d failed request\n", led_gpio);
+			return -1;
+		}
+		gpio_direction_output(led_gpio, 0);
 	}
 
-	/* GPIO: set as output/input */
-	gpio_direction_output(GPIO_LED, 0);
-	gpio_direction_input(GPIO_BTN);
+	for (i = 0; i < nr_gpios; i++)
+		if (alm_line_setup(&alm_lines[i], i, gpios[i]) < 0)
+			goto r_lines;
 
-	/* GPIO: export to sysfs */
-	gpio_export(GPIO_LED, false);
-
-	/* GPIO: set input debounce */
-#if USE_SW_DEBOUNCE
-
-#else
-	if (gpio_set_debounce(GPIO_BTN, 200) < 0) {
-		pr_err(DEV_INFO "GPIO %d debounce failed\n", GPIO_BTN);
-		goto r_gpio_btn;
+	if ((err = misc_register(&alm_miscdev))) {
+		pr_err(DEV_INFO "Register failed: %d\n", err);
+		goto r_lines;
 	}
-#endif
 
-	/* IRQ: setup for GPIO_BTN */
-	if (request_irq(gpio_to_irq(GPIO_BTN), gpio_button_handler,
-			IRQF_TRIGGER_RISING, MOD_NAME "_dev", NULL)) {
-		pr_err(DEV_INFO "Can't regiest IRQ for gpio\n");
-		goto r_gpio_btn;
-	}
+	alm_debugfs = debugfs_create_dir(MOD_NAME "_gpio_irq", NULL);
+	debugfs_create_file("stats", 0444, alm_debugfs, NULL,
+			    &alm_stats_fops);
 
-	printk(DEV_INFO "Driver inserted\n");
+	printk(DEV_INFO "Driver inserted, %d line(s)\n", nr_gpios);
 	return 0;
 
-r_gpio_btn:
-	gpio_free(GPIO_BTN);
-r_gpio_led:
-	gpio_free(GPIO_LED);
-r_misc:
-	misc_deregister(&alm_miscdev);
+r_lines:
+	while (--i >= 0)
+		alm_line_cleanup(&alm_lines[i]);
+	if (led_gpio >= 0)
+		gpio_free(led_gpio);
 	return -1;
 }
 
 /*
-** This function is called at the last time module removed 
+** This function is called at the last time module removed
 */
 static void __exit alm_exit(void)
 {
-	free_irq(gpio_to_irq(GPIO_BTN), NULL);
-	gpio_free(GPIO_BTN);
-	gpio_unexport(GPIO_LED);
-	gpio_free(GPIO_LED);
+	int i;
 
+	debugfs_remove_recursive(alm_debugfs);
 	misc_deregister(&alm_miscdev);
+
+	for (i = 0; i < nr_gpios; i++)
+		alm_line_cleanup(&alm_lines[i]);
+	if (led_gpio >= 0)
+		gpio_free(led_gpio);
+
 	printk(DEV_INFO "Driver removed\n");
 }
 
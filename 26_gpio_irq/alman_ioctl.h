@@ -0,0 +1,24 @@
+#ifndef __ALMAN_IOCTL_H__
+#define __ALMAN_IOCTL_H__
+
+#include <linux/types.h>
+
+/* Shared between the driver and the userspace apps */
+#define ALM_DEV_PATH "/dev/alman_dev"
+
+/*
+ * One debounced edge, read from the device as an array of this struct.
+ * ts_ns is CLOCK_MONOTONIC taken in the hard irq handler, or in the irq
+ * thread, after a bus transfer, for controllers behind a bus (nested
+ * irqs). line is the index in the "gpios" module parameter. level is the
+ * line level right after the edge, or -1 when the controller can't be
+ * read in hard irq context and the line changed again before the thread
+ * sampled it.
+ */
+struct alm_edge {
+	__u64 ts_ns;
+	__u32 line;
+	__s32 level;
+};
+
+#endif /* __ALMAN_IOCTL_H__ */
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include "alman_ioctl.h"
+
+/*
+ * Usage: ./app [seconds]
+ *
+ * Prints every edge, or with a duration only counts them and reports the
+ * rate per line. Drops are visible in /sys/kernel/debug/alman_gpio_irq/stats.
+ *
+ * Without hardware, gpio_sim_test.sh (make test) runs the module on
+ * gpio-sim lines (5.17+) and checks the edges, debounce and poll(). By
+ * hand: create a gpio-sim chip and load the module on its lines (numbers
+ * from /sys/kernel/debug/gpio):
+ *
+ *   mkdir -p /sys/kernel/config/gpio-sim/alm/bank0
+ *   echo 4 > /sys/kernel/config/gpio-sim/alm/bank0/num_lines
+ *   echo 1 > /sys/kernel/config/gpio-sim/alm/live
+ *   insmod alman.ko gpios=B,B+1 led_gpio=B+3
+ *
+ * then toggle an input through its pull attribute, e.g.
+ *
+ *   cd /sys/devices/platform/gpio-sim.0/gpiochipN/sim_gpio0
+ *   while :; do echo pull-up > pull; echo pull-down > pull; done
+ */
+
+#define MAX_LINES 8
+
+/* Main function */
+int main(int argc, char *argv[])
+{
+	struct alm_edge edges[256];
+	struct pollfd pfd;
+	uint64_t count[MAX_LINES] = { 0 };
+	uint64_t first = 0, last = 0;
+	int seconds = 0;
+	ssize_t n;
+	int fd, i;
+
+	if (argc > 1)
+		seconds = atoi(argv[1]);
+
+	fd = open(ALM_DEV_PATH, O_RDONLY);
+	if (fd < 0) {
+		printf("Can't open device file\n");
+		return -1;
+	}
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+
+	while (1) {
+		if (poll(&pfd, 1, seconds ? seconds * 1000 : -1) <= 0)
+			break; /* idle, or interrupted */
+
+		n = read(fd, edges, sizeof(edges));
+		if (n < 0)
+			break;
+
+		for (i = 0; i < n / (ssize_t)sizeof(edges[0]); i++) {
+			if (first == 0)
+				first = edges[i].ts_ns;
+			last = edges[i].ts_ns;
+
+			if (seconds == 0) {
+				printf("%llu.%09llu line %u level %d\n",
+				       (unsigned long long)(last / 1000000000),
+				       (unsigned long long)(last % 1000000000),
+				       edges[i].line, edges[i].level);
+				continue;
+			}
+			if (edges[i].line < MAX_LINES)
+				count[edges[i].line]++;
+		}
+
+		if (seconds && last - first >= seconds * 1000000000ULL)
+			break;
+	}
+
+	if (seconds && last > first) {
+		for (i = 0; i < MAX_LINES; i++)
+			if (count[i])
+				printf("line %d: %llu edges, %.0f edges/s\n", i,
+				       (unsigned long long)count[i],
+				       count[i] * 1e9 / (last - first));
+	}
+
+	close(fd);
+	return 0;
+}
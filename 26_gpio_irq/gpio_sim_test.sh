@@ -0,0 +1,134 @@
+#!/bin/sh
+#
+# Run the edge driver on gpio-sim lines (5.17+, CONFIG_GPIO_SIM): inputs
+# are toggled through the simulated pulls and the test checks the edges
+# read back (line, level and order), the LED mirror of line 0, the
+# debounce, a non-blocking read of an empty queue and a blocking reader
+# woken through poll().
+#
+# Build first (make), then run as root from anywhere: ./gpio_sim_test.sh
+# Exits non-zero if any check fails.
+
+set -eu
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+MOD=$HERE/alman.ko
+TMP=$(mktemp -d)
+APP=$TMP/app
+CFG=/sys/kernel/config/gpio-sim/alman-test
+DEV=/dev/alman_dev
+STATS=/sys/kernel/debug/alman_gpio_irq/stats
+DEBOUNCE=/sys/module/alman/parameters/debounce_ns
+fail=0
+
+cleanup() {
+	rmmod alman 2>/dev/null || true
+	if [ -d $CFG ]; then
+		echo 0 > $CFG/live || true
+		rmdir $CFG/bank0 $CFG || true
+	fi
+	rm -rf "$TMP"
+}
+
+check() {
+	if [ "$2" = "$3" ]; then
+		echo "ok   $1"
+	else
+		echo "FAIL $1: expected '$2', got '$3'"
+		fail=1
+	fi
+}
+
+# lines 0 and 1 are inputs, 3 is the LED
+sim_pull() {
+	echo "$2" > $SIM/sim_gpio$1/pull
+}
+
+sim_value() {
+	cat $SIM/sim_gpio$1/value
+}
+
+# let the irq thread drain the edge
+settle() {
+	sleep 0.1
+}
+
+# "line:level" of every queued edge, oldest first, without blocking
+edges() {
+	dd if=$DEV iflag=nonblock bs=4096 count=1 2>/dev/null |
+		od -An -v -t d4 -w16 |
+		awk '{ printf "%s%d:%d", sep, $3, $4; sep = " " }'
+}
+
+edge_lines() {
+	edges | tr ' ' '\n' | cut -d: -f1 | tr '\n' ' ' | sed 's/ $//'
+}
+
+# column of the stats table for one line
+line_stat() {
+	awk -v l="$1" -v c="$2" '
+		$1 == "line" { for (i = 1; i <= NF; i++) col[$i] = i; next }
+		col[c] && $1 == l { print $col[c] }' $STATS
+}
+
+trap cleanup EXIT
+
+${CC:-cc} -o "$APP" "$HERE/app.c"
+modprobe gpio-sim
+mountpoint -q /sys/kernel/debug || mount -t debugfs none /sys/kernel/debug
+
+mkdir $CFG $CFG/bank0
+echo 4 > $CFG/bank0/num_lines
+echo 1 > $CFG/live
+
+CHIP=$(cat $CFG/bank0/chip_name)
+SIM=/sys/devices/platform/$(cat $CFG/dev_name)/$CHIP
+BASE=$(sed -n "s/^$CHIP: GPIOs \([0-9]*\)-.*/\1/p" /sys/kernel/debug/gpio)
+[ -n "$BASE" ] || { echo "no base for $CHIP"; exit 1; }
+
+sim_pull 0 pull-down
+sim_pull 1 pull-down
+insmod $MOD gpios=$BASE,$((BASE + 1)) led_gpio=$((BASE + 3))
+check "no edge at load" "" "$(edges)"
+
+# every edge, in order, with the level after it
+sim_pull 0 pull-up; settle
+sim_pull 1 pull-up; settle
+sim_pull 0 pull-down; settle
+sim_pull 1 pull-down; settle
+check "edges in order" "0:1 1:1 0:0 1:0" "$(edges)"
+check "empty queue, non-blocking read" "" "$(edges)"
+check "accepted on line 0" "2" "$(line_stat 0 accepted)"
+check "accepted on line 1" "2" "$(line_stat 1 accepted)"
+
+# line 0 is mirrored on the LED
+sim_pull 0 pull-up; settle
+check "LED follows line 0 up" "1" "$(sim_value 3)"
+sim_pull 0 pull-down; settle
+check "LED follows line 0 down" "0" "$(sim_value 3)"
+edges >/dev/null
+
+# 1 s debounce: a burst keeps its first edge only
+echo 1000000000 > $DEBOUNCE
+sleep 1.1
+bounced=$(line_stat 0 bounced)
+sim_pull 0 pull-up
+sim_pull 0 pull-down
+sim_pull 0 pull-up
+settle
+check "debounce keeps one edge" "0" "$(edge_lines)"
+check "debounce drops two" "$((bounced + 2))" "$(line_stat 0 bounced)"
+echo 0 > $DEBOUNCE
+sim_pull 0 pull-down; settle
+edges >/dev/null
+
+# a reader blocked in poll() gets the edges as they come
+stdbuf -oL timeout 2 "$APP" > $TMP/poll &
+sleep 0.5
+sim_pull 1 pull-up; settle
+sim_pull 1 pull-down; settle
+wait || true
+check "poll wakes the reader" "1:1 1:0" \
+	"$(awk '{ printf "%s%s:%s", sep, $3, $5; sep = " " }' $TMP/poll)"
+
+exit $fail
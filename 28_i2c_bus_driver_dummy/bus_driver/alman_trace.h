@@ -0,0 +1,26 @@
+#ifndef __ALMAN_TRACE_H__
+#define __ALMAN_TRACE_H__
+
+#include <linux/types.h>
+
+/* Shared between the driver and the userspace apps */
+#define ALM_TRACE_DATA 40 /* payload bytes kept per message */
+
+/*
+ * One I2C message, as read from <debugfs>/alman-bus/trace/trace0 and as
+ * written back to <debugfs>/alman-bus/trace/replay. Messages of the same
+ * transfer share xfer and are numbered by index.
+ */
+struct alm_trace_rec {
+	__u64 ts_ns; /* CLOCK_MONOTONIC, when the message completed */
+	__u32 xfer;
+	__u16 addr;
+	__u16 flags; /* I2C_M_* */
+	__u16 len; /* message length, data keeps at most ALM_TRACE_DATA */
+	__u8 index;
+	__u8 reserved;
+	__s32 result; /* 0 or -errno */
+	__u8 data[ALM_TRACE_DATA]; /* written, or read back from the slave */
+};
+
+#endif /* __ALMAN_TRACE_H__ */
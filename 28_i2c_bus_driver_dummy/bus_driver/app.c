@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/i2c.h>
+#include "alman_trace.h"
+
+/*
+ * Usage: ./app <trace> [addr]
+ *
+ * Decodes a capture of the dummy adapter, e.g.
+ *
+ *   echo "trace flush" > /sys/kernel/debug/alman-bus/trace/control
+ *   cat /sys/kernel/debug/alman-bus/trace/trace0 > bus.trace
+ *   ./app bus.trace 0x3c
+ *
+ * The same file replays the recorded read responses to the clients:
+ *
+ *   cat bus.trace > /sys/kernel/debug/alman-bus/trace/replay
+ *   echo "replay on" > /sys/kernel/debug/alman-bus/trace/control
+ */
+
+/* Main function */
+int main(int argc, char *argv[])
+{
+	struct alm_trace_rec rec;
+	uint64_t t0 = 0;
+	long addr = -1;
+	int fd, i, n;
+
+	if (argc < 2) {
+		printf("Usage: %s <trace> [addr]\n", argv[0]);
+		return -1;
+	}
+	if (argc > 2)
+		addr = strtol(argv[2], NULL, 0);
+
+	fd = open(argv[1], O_RDONLY);
+	if (fd < 0) {
+		printf("Can't open %s\n", argv[1]);
+		return -1;
+	}
+
+	while (read(fd, &rec, sizeof(rec)) == sizeof(rec)) {
+		if (addr >= 0 && rec.addr != addr)
+			continue;
+		if (t0 == 0)
+			t0 = rec.ts_ns;
+
+		printf("%12.6f xfer %u.%u addr 0x%02x %c len %3u res %3d:",
+		       (rec.ts_ns - t0) / 1e9, rec.xfer, rec.index, rec.addr,
+		       (rec.flags & I2C_M_RD) ? 'R' : 'W', rec.len,
+		       rec.result);
+
+		n = rec.len < ALM_TRACE_DATA ? rec.len : ALM_TRACE_DATA;
+		for (i = 0; i < n; i++)
+			printf(" %02x", rec.data[i]);
+		printf("%s\n", rec.len > ALM_TRACE_DATA ? " ..." : "");
+	}
+
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,324 @@
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/uaccess.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+#include "bus_trace.h"
+
+/* Private macros */
+#define TRACE_SUBBUF_SIZE (256 * 1024) /* whole records, no padding */
+#define TRACE_N_SUBBUFS (8)
+#define REPLAY_MAX (1 << 20) /* records */
+#define CMD_SIZE 16
+
+/* Function implementations */
+static struct dentry *bus_trace_create_buf_file(const char *filename,
+						struct dentry *parent,
+						umode_t mode,
+						struct rchan_buf *buf,
+						int *is_global)
+{
+	/* one buffer, in transfer order: the adapter lock serializes us */
+	*is_global = 1;
+	return debugfs_create_file(filename, mode, parent, buf,
+				   &relay_file_operations);
+}
+
+static int bus_trace_remove_buf_file(struct dentry *dentry)
+{
+	debugfs_remove(dentry);
+	return 0;
+}
+
+static struct rchan_callbacks bus_trace_relay_cb = {
+	.create_buf_file = bus_trace_create_buf_file,
+	.remove_buf_file = bus_trace_remove_buf_file,
+};
+
+/**
+ * bus_trace_begin - start a new transfer
+ *
+ * Return: transfer sequence number for bus_trace_msg()
+ */
+u32 bus_trace_begin(struct bus_trace *t)
+{
+	return t->xfer++;
+}
+
+/**
+ * bus_trace_msg - record one message, after the slave handled it so read
+ * data is included
+ */
+void bus_trace_msg(struct bus_trace *t, u32 xfer, int index,
+		   const struct i2c_msg *msg, int result)
+{
+	struct alm_trace_rec rec;
+
+	if (!READ_ONCE(t->enabled))
+		return;
+
+	rec.ts_ns = ktime_get_ns();
+	rec.xfer = xfer;
+	rec.addr = msg->addr;
+	rec.flags = msg->flags;
+	rec.len = msg->len;
+	rec.index = index;
+	rec.reserved = 0;
+	rec.result = result;
+	memset(rec.data, 0, sizeof(rec.data));
+	memcpy(rec.data, msg->buf, min_t(u16, msg->len, ALM_TRACE_DATA));
+
+	relay_write(t->chan, &rec, sizeof(rec));
+	t->records++;
+}
+
+/**
+ * bus_trace_replay - answer a message from the replay table, if the
+ * address was recorded. Writes are ACKed, reads get the next recorded
+ * read of that address, bytes past ALM_TRACE_DATA read as 0xff. A block
+ * read (I2C_M_RECV_LEN) takes its recorded length.
+ *
+ * Return: true if replayed, with the message result in *ret
+ */
+bool bus_trace_replay(struct bus_trace *t, struct i2c_msg *msg, int *ret)
+{
+	struct alm_trace_rec *rec;
+	size_t i;
+
+	if (!READ_ONCE(t->replaying) || msg->addr > SIM_ADDR_MAX)
+		return false;
+
+	mutex_lock(&t->lock);
+	if (!t->replaying || !test_bit(msg->addr, t->present)) {
+		mutex_unlock(&t->lock);
+		return false;
+	}
+
+	*ret = 0;
+	if (!(msg->flags & I2C_M_RD))
+		goto out;
+
+	for (i = t->next[msg->addr]; i < t->nr_replay; i++) {
+		rec = &t->replay[i];
+		if (rec->addr == msg->addr && (rec->flags & I2C_M_RD))
+			break;
+	}
+	t->next[msg->addr] = i + 1;
+
+	memset(msg->buf, 0xff, msg->len);
+	if (i >= t->nr_replay) {
+		t->missed++;
+		/* a block read count of 0xff is no count */
+		if (msg->flags & I2C_M_RECV_LEN)
+			*ret = -EPROTO;
+		goto out;
+	}
+
+	/*
+	 * block read: take the length the count gave at record time, the
+	 * recorded count must be a valid one that matches it
+	 */
+	if (msg->flags & I2C_M_RECV_LEN) {
+		if (rec->data[0] == 0 || rec->data[0] > I2C_SMBUS_BLOCK_MAX ||
+		    rec->len != msg->len + rec->data[0]) {
+			*ret = -EPROTO;
+			goto out;
+		}
+		memset(msg->buf + msg->len, 0xff, rec->len - msg->len);
+		msg->len = rec->len;
+	}
+
+	memcpy(msg->buf, rec->data,
+	       min3(msg->len, rec->len, (u16)ALM_TRACE_DATA));
+	*ret = rec->result;
+	t->replayed++;
+
+out:
+	mutex_unlock(&t->lock);
+	return true;
+}
+
+/**
+ * bus_trace_replay_rewind - restart every address at its first record,
+ * called with t->lock held
+ */
+static void bus_trace_replay_rewind(struct bus_trace *t)
+{
+	memset(t->next, 0, sizeof(t->next));
+	t->replayed = 0;
+	t->missed = 0;
+}
+
+/*
+ * replay file: appends whole struct alm_trace_rec, e.g. a captured trace0
+ */
+static ssize_t bus_trace_replay_write(struct file *filp,
+				      const char __user *buf, size_t len,
+				      loff_t *off)
+{
+	struct bus_trace *t = filp->private_data;
+	struct alm_trace_rec *tbl;
+	size_t n = len / sizeof(*tbl), cap, i;
+	ssize_t ret = len;
+
+	if (len % sizeof(*tbl))
+		return -EINVAL;
+
+	mutex_lock(&t->lock);
+	if (t->nr_replay + n > REPLAY_MAX) {
+		ret = -ENOSPC;
+		goto out;
+	}
+
+	/* grow the table */
+	if (t->nr_replay + n > t->max_replay) {
+		cap = max_t(size_t, t->max_replay * 2, t->nr_replay + n);
+		tbl = kvmalloc_array(cap, sizeof(*tbl), GFP_KERNEL);
+		if (tbl == NULL) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		if (t->replay)
+			memcpy(tbl, t->replay, t->nr_replay * sizeof(*tbl));
+		kvfree(t->replay);
+		t->replay = tbl;
+		t->max_replay = cap;
+	}
+
+	tbl = &t->replay[t->nr_replay];
+	if (copy_from_user(tbl, buf, len)) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (tbl[i].addr > SIM_ADDR_MAX) {
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+	for (i = 0; i < n; i++)
+		set_bit(tbl[i].addr, t->present);
+	t->nr_replay += n;
+
+out:
+	mutex_unlock(&t->lock);
+	return ret;
+}
+
+static const struct file_operations bus_trace_replay_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.write = bus_trace_replay_write,
+};
+
+/*
+ * control file: "trace on", "trace off", "trace flush" (makes a partial
+ * sub-buffer readable), "replay on" (rewinds), "replay off", "replay clear"
+ */
+static ssize_t bus_trace_ctl_write(struct file *filp, const char __user *buf,
+				   size_t len, loff_t *off)
+{
+	struct bus_trace *t = filp->private_data;
+	char cmd[CMD_SIZE], *c;
+	ssize_t ret = len;
+
+	if (len >= sizeof(cmd))
+		return -EINVAL;
+	if (copy_from_user(cmd, buf, len))
+		return -EFAULT;
+	cmd[len] = '\0';
+	c = strim(cmd);
+
+	if (strcmp(c, "trace on") == 0) {
+		WRITE_ONCE(t->enabled, true);
+	} else if (strcmp(c, "trace off") == 0) {
+		WRITE_ONCE(t->enabled, false);
+	} else if (strcmp(c, "trace flush") == 0) {
+		relay_flush(t->chan);
+	} else if (strncmp(c, "replay ", 7) == 0) {
+		mutex_lock(&t->lock);
+		if (strcmp(c + 7, "on") == 0) {
+			bus_trace_replay_rewind(t);
+			t->replaying = true;
+		} else if (strcmp(c + 7, "off") == 0) {
+			t->replaying = false;
+		} else if (strcmp(c + 7, "clear") == 0) {
+			t->replaying = false;
+			kvfree(t->replay);
+			t->replay = NULL;
+			t->nr_replay = t->max_replay = 0;
+			bitmap_zero(t->present, SIM_ADDR_MAX + 1);
+			bus_trace_replay_rewind(t);
+		} else {
+			ret = -EINVAL;
+		}
+		mutex_unlock(&t->lock);
+	} else {
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+static const struct file_operations bus_trace_ctl_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.write = bus_trace_ctl_write,
+};
+
+static int bus_trace_stats_show(struct seq_file *m, void *unused)
+{
+	struct bus_trace *t = m->private;
+
+	seq_printf(m, "trace:    %s\n", READ_ONCE(t->enabled) ? "on" : "off");
+	seq_printf(m, "records:  %llu\n", READ_ONCE(t->records));
+	seq_printf(m, "xfers:    %u\n", READ_ONCE(t->xfer));
+
+	mutex_lock(&t->lock);
+	seq_printf(m, "replay:   %s\n", t->replaying ? "on" : "off");
+	seq_printf(m, "loaded:   %zu\n", t->nr_replay);
+	seq_printf(m, "replayed: %llu\n", t->replayed);
+	seq_printf(m, "missed:   %llu\n", t->missed);
+	mutex_unlock(&t->lock);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(bus_trace_stats);
+
+/**
+ * bus_trace_init - create <parent>/trace/{trace0,control,replay,stats},
+ * recording starts enabled
+ *
+ * Return: 0 on success, or a negative errno
+ */
+int bus_trace_init(struct bus_trace *t, struct dentry *parent)
+{
+	memset(t, 0, sizeof(*t));
+	mutex_init(&t->lock);
+	t->enabled = true;
+
+	t->dir = debugfs_create_dir("trace", parent);
+	t->chan = relay_open("trace", t->dir, TRACE_SUBBUF_SIZE,
+			     TRACE_N_SUBBUFS, &bus_trace_relay_cb, t);
+	if (t->chan == NULL) {
+		debugfs_remove_recursive(t->dir);
+		return -ENOMEM;
+	}
+
+	debugfs_create_file("control", 0200, t->dir, t, &bus_trace_ctl_fops);
+	debugfs_create_file("replay", 0200, t->dir, t, &bus_trace_replay_fops);
+	debugfs_create_file("stats", 0444, t->dir, t, &bus_trace_stats_fops);
+	return 0;
+}
+
+/**
+ * bus_trace_destroy - close the relay channel and free the replay table
+ */
+void bus_trace_destroy(struct bus_trace *t)
+{
+	relay_close(t->chan);
+	debugfs_remove_recursive(t->dir);
+	kvfree(t->replay);
+}
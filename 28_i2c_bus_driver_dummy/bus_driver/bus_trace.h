@@ -0,0 +1,44 @@
+#ifndef __BUS_TRACE_H__
+#define __BUS_TRACE_H__
+
+#include <linux/i2c.h>
+#include <linux/mutex.h>
+#include <linux/relay.h>
+#include "sim_slave.h"
+#include "alman_trace.h"
+
+/*
+ * Transfer recorder and replayer. Every message is appended as one
+ * struct alm_trace_rec to a global relay buffer, producers are serialized
+ * by the adapter lock so no lock is taken on that path. Records loaded
+ * into the replay table answer reads in their recorded order, per address,
+ * instead of the slave models.
+ */
+struct bus_trace {
+	struct rchan *chan;
+	struct dentry *dir;
+	bool enabled;
+	u32 xfer;
+	u64 records;
+
+	/* replay */
+	struct mutex lock;
+	struct alm_trace_rec *replay;
+	size_t nr_replay;
+	size_t max_replay;
+	size_t next[SIM_ADDR_MAX + 1]; /* cursor per address */
+	DECLARE_BITMAP(present, SIM_ADDR_MAX + 1);
+	bool replaying;
+	u64 replayed;
+	u64 missed; /* reads with no record left */
+};
+
+/* exported functions */
+int bus_trace_init(struct bus_trace *t, struct dentry *parent);
+void bus_trace_destroy(struct bus_trace *t);
+u32 bus_trace_begin(struct bus_trace *t);
+void bus_trace_msg(struct bus_trace *t, u32 xfer, int index,
+		   const struct i2c_msg *msg, int result);
+bool bus_trace_replay(struct bus_trace *t, struct i2c_msg *msg, int *ret);
+
+#endif /* __BUS_TRACE_H__ */
@@ -0,0 +1,359 @@
+#include <linux/i2c.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/debugfs.h>
+#include "sim_slave.h"
+#include "smbus_pec.h"
+#include "bus_trace.h"
+
+/* Private macros */
+#define MOD_NAME "alman-bus"
+#define MOD_INFO MOD_NAME ": "
+
+#define ADAPTER_NAME "ALM_I2C_ADAPTER"
+#define I2C_BUS_NUMBER (11)
+
+/* Private variables */
+static struct sim_slave *alm_slaves[SIM_ADDR_MAX + 1]; /* by address */
+static struct dentry *alm_debugfs;
+static struct bus_trace alm_trace;
+
+/* Module parameters */
+/*
+ * The display clients (27, 28 and 31) only need the adapter number they
+ * hardcode, e.g. "insmod alman_bus.ko bus_nr=1", then their output is in
+ * /sys/kernel/debug/alman-bus/0x3c-ssd1306/{gddram.pbm,state}. Every
+ * transfer is recorded in /sys/kernel/debug/alman-bus/trace/trace0.
+ * SMBus clients can use a register file, e.g. "slaves=regfile@0x50", and
+ * toggle its PEC through 0x50-regfile/pec. Bus speed, clock stretching,
+ * NACKs and arbitration loss are set per slave in <addr>-<model>/fault/.
+ */
+static int bus_nr = I2C_BUS_NUMBER;
+module_param(bus_nr, int, 0444);
+MODULE_PARM_DESC(bus_nr, "Adapter number, -1 picks a free one");
+
+static char *slaves[SIM_MAX_SLAVES] = { "ssd1306@0x3c" };
+static int nr_slaves = 1;
+module_param_array(slaves, charp, &nr_slaves, 0444);
+MODULE_PARM_DESC(slaves, "Simulated slaves, as <model>@<addr>");
+
+/**
+ * alm_func - list supported functionalities for this bus driver
+ *
+ * Return: merged functionalities
+ */
+static u32 alm_func(struct i2c_adapter *adapter)
+{
+	/*
+	 * Quick to block data are native in alm_smbus_xfer(), the rest is
+	 * emulated by the core on top of alm_i2c_xfer()
+	 */
+	return I2C_FUNC_I2C | I2C_FUNC_SMBUS_EMUL |
+	       I2C_FUNC_SMBUS_READ_BLOCK_DATA | I2C_FUNC_SMBUS_PEC;
+}
+
+/**
+ * alm_i2c_msg - deliver one message to the slave model at its address
+ * @ack: write bytes the bus lets through before a data NACK
+ *
+ * Return: 0, -EIO on a data NACK, -EPROTO on a bad block read count
+ */
+static int alm_i2c_msg(struct sim_slave *slave, struct i2c_msg *msg, u16 ack)
+{
+	bool recv_len = msg->flags & I2C_M_RECV_LEN;
+	u16 len = msg->len;
+	int ret;
+
+	if (!(msg->flags & I2C_M_RD)) {
+		if (ack == 0 && msg->len)
+			return -EIO;
+		ret = slave->ops->write(slave, msg->buf, ack);
+		if (ret < 0)
+			return ret;
+		return ret < msg->len ? -EIO : 0;
+	}
+
+	/* block read: the first byte received extends the message */
+	if (recv_len)
+		len += I2C_SMBUS_BLOCK_MAX;
+	ret = slave->ops->read(slave, msg->buf, len, recv_len);
+	if (ret < 0)
+		return ret;
+
+	if (recv_len) {
+		if (ret < 1 || msg->buf[0] == 0 ||
+		    msg->buf[0] > I2C_SMBUS_BLOCK_MAX)
+			return -EPROTO;
+		msg->len += msg->buf[0];
+	}
+
+	/* the master clocks every byte, an idle SDA reads as 0xff */
+	if (ret < msg->len)
+		memset(msg->buf + ret, 0xff, msg->len - ret);
+	return 0;
+}
+
+/**
+ * alm_i2c_xfer - low level i2c routine, every message is replayed or
+ * handed to the simulated slave at its address, then recorded
+ *
+ * Return: number of messages transferred, or errno
+ */
+static int alm_i2c_xfer(struct i2c_adapter *adapter, struct i2c_msg *msgs,
+			int num)
+{
+	struct sim_slave *slave, *last = NULL;
+	u32 xfer = bus_trace_begin(&alm_trace);
+	struct i2c_msg *msg;
+	int ret = 0, i;
+
+	for (i = 0; i < num; i++) {
+		msg = &msgs[i];
+
+		if (bus_trace_replay(&alm_trace, msg, &ret)) {
+			/* recorded answer */
+		} else if ((msg->flags & I2C_M_TEN) ||
+			   msg->addr > SIM_ADDR_MAX ||
+			   (slave = alm_slaves[msg->addr]) == NULL) {
+			ret = -ENXIO;
+		} else {
+			/* a repeated START to another address ends the last */
+			if (last && last != slave && last->ops->stop)
+				last->ops->stop(last);
+			last = slave;
+
+			ret = sim_fault_msg(&slave->fault, msg);
+			if (ret >= 0)
+				ret = alm_i2c_msg(slave, msg, ret);
+		}
+
+		bus_trace_msg(&alm_trace, xfer, i, msg, ret);
+		if (ret < 0)
+			break;
+	}
+
+	/* STOP */
+	if (last && last->ops->stop)
+		last->ops->stop(last);
+
+	return ret < 0 ? ret : num;
+}
+
+/**
+ * alm_pec_msg - continue a PEC over the address byte and the first len
+ * bytes of a message
+ */
+static u8 alm_pec_msg(u8 crc, const struct i2c_msg *msg, u16 len)
+{
+	crc = smbus_pec_addr(crc, msg->addr, msg->flags & I2C_M_RD);
+	return smbus_crc8(crc, msg->buf, len);
+}
+
+/**
+ * alm_smbus_xfer - native SMBus routine. Each protocol is built as the
+ * messages it puts on the wire and run through alm_i2c_xfer() directly,
+ * so it is traced and replayed like any other transfer. The PEC byte is
+ * appended to writes and checked on reads here.
+ *
+ * Return: 0 on success, -EOPNOTSUPP lets the core emulate the protocol
+ */
+static int alm_smbus_xfer(struct i2c_adapter *adapter, u16 addr,
+			  unsigned short flags, char read_write, u8 command,
+			  int size, union i2c_smbus_data *data)
+{
+	u8 wbuf[I2C_SMBUS_BLOCK_MAX + 3]; /* command, count, data, PEC */
+	u8 rbuf[I2C_SMBUS_BLOCK_MAX + 2]; /* count, data, PEC */
+	struct i2c_msg msgs[2] = {
+		{ .addr = addr, .flags = flags & I2C_M_TEN, .buf = wbuf },
+		{ .addr = addr, .flags = (flags & I2C_M_TEN) | I2C_M_RD,
+		  .buf = rbuf },
+	};
+	bool rd = read_write == I2C_SMBUS_READ;
+	bool pec = (flags & I2C_CLIENT_PEC) && size != I2C_SMBUS_QUICK;
+	struct i2c_msg *m = msgs, *last;
+	int num = rd ? 2 : 1;
+	int ret;
+	u8 crc;
+
+	wbuf[0] = command;
+	msgs[0].len = 1;
+	msgs[1].len = 1;
+
+	switch (size) {
+	case I2C_SMBUS_QUICK:
+		/* the R/W bit is the data */
+		msgs[0].len = 0;
+		msgs[0].flags |= rd ? I2C_M_RD : 0;
+		num = 1;
+		break;
+	case I2C_SMBUS_BYTE:
+		/* no command, the byte is either sent or received */
+		if (rd)
+			m = &msgs[1];
+		num = 1;
+		break;
+	case I2C_SMBUS_BYTE_DATA:
+		if (!rd) {
+			wbuf[1] = data->byte;
+			msgs[0].len = 2;
+		}
+		break;
+	case I2C_SMBUS_WORD_DATA:
+		if (!rd) {
+			wbuf[1] = data->word & 0xff;
+			wbuf[2] = data->word >> 8;
+			msgs[0].len = 3;
+		} else {
+			msgs[1].len = 2;
+		}
+		break;
+	case I2C_SMBUS_BLOCK_DATA:
+		if (!rd) {
+			if (data->block[0] == 0 ||
+			    data->block[0] > I2C_SMBUS_BLOCK_MAX)
+				return -EINVAL;
+			memcpy(&wbuf[1], data->block, data->block[0] + 1);
+			msgs[0].len = data->block[0] + 2;
+		} else {
+			msgs[1].flags |= I2C_M_RECV_LEN;
+		}
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	last = &m[num - 1];
+	if (pec) {
+		if (!(last->flags & I2C_M_RD))
+			last->buf[last->len] = alm_pec_msg(0, last, last->len);
+		last->len++;
+	}
+
+	ret = alm_i2c_xfer(adapter, m, num);
+	if (ret < 0)
+		return ret;
+
+	if (!(last->flags & I2C_M_RD))
+		return 0;
+
+	if (pec) {
+		crc = num > 1 ? alm_pec_msg(0, m, m->len) : 0;
+		crc = alm_pec_msg(crc, last, last->len - 1);
+		if (crc != last->buf[last->len - 1])
+			return -EBADMSG;
+	}
+
+	switch (size) {
+	case I2C_SMBUS_BYTE:
+	case I2C_SMBUS_BYTE_DATA:
+		data->byte = rbuf[0];
+		break;
+	case I2C_SMBUS_WORD_DATA:
+		data->word = rbuf[0] | (rbuf[1] << 8);
+		break;
+	case I2C_SMBUS_BLOCK_DATA:
+		/* the count must fit data->block and match what was read */
+		if (rbuf[0] == 0 || rbuf[0] > I2C_SMBUS_BLOCK_MAX ||
+		    last->len != rbuf[0] + 1 + pec)
+			return -EPROTO;
+		memcpy(data->block, rbuf, rbuf[0] + 1);
+		break;
+	}
+	return 0;
+}
+
+/* I2C algorithm structure */
+static struct i2c_algorithm alm_i2c_algorithm = {
+	.master_xfer = alm_i2c_xfer,
+	.smbus_xfer = alm_smbus_xfer,
+	.functionality = alm_func,
+};
+
+/* I2C adapter structure */
+static struct i2c_adapter alm_i2c_adapter = {
+	.owner = THIS_MODULE,
+	.class = I2C_CLASS_HWMON, // | I2C_CLASS_SPD,
+	.algo = &alm_i2c_algorithm,
+	.name = ADAPTER_NAME,
+	.retries = 3, /* the core retries -EAGAIN, i.e. arbitration loss */
+};
+
+/**
+ * alm_slaves_del - remove every simulated slave
+ */
+static void alm_slaves_del(void)
+{
+	int i;
+
+	for (i = 0; i <= SIM_ADDR_MAX; i++) {
+		if (alm_slaves[i]) {
+			sim_slave_del(alm_slaves[i]);
+			alm_slaves[i] = NULL;
+		}
+	}
+}
+
+/* Module init callback */
+static int __init alm_init(void)
+{
+	struct sim_slave *slave;
+	int i, err;
+
+	/* Slaves first, they answer as soon as the adapter is visible */
+	alm_debugfs = debugfs_create_dir(MOD_NAME, NULL);
+	for (i = 0; i < nr_slaves; i++) {
+		slave = sim_slave_new(slaves[i], alm_debugfs);
+		if (IS_ERR(slave)) {
+			pr_err(MOD_INFO "Can't create slave %s\n", slaves[i]);
+			goto r_slaves;
+		}
+		if (alm_slaves[slave->addr]) {
+			pr_err(MOD_INFO "Address 0x%02x is busy\n",
+			       slave->addr);
+			sim_slave_del(slave);
+			goto r_slaves;
+		}
+		alm_slaves[slave->addr] = slave;
+	}
+
+	if (bus_trace_init(&alm_trace, alm_debugfs) < 0) {
+		pr_err(MOD_INFO "Can't create trace buffer\n");
+		goto r_slaves;
+	}
+
+	/* -1 falls back to a dynamic number */
+	alm_i2c_adapter.nr = bus_nr;
+	if ((err = i2c_add_numbered_adapter(&alm_i2c_adapter)) < 0) {
+		pr_err(MOD_INFO "Can't add I2C adapter\n");
+		goto r_trace;
+	}
+
+	pr_info(MOD_INFO "Driver added, bus %d\n", alm_i2c_adapter.nr);
+	return 0;
+
+r_trace:
+	bus_trace_destroy(&alm_trace);
+r_slaves:
+	alm_slaves_del();
+	debugfs_remove_recursive(alm_debugfs);
+	return -1;
+}
+
+/* Module exit callback */
+static void __exit alm_exit(void)
+{
+	i2c_del_adapter(&alm_i2c_adapter);
+	bus_trace_destroy(&alm_trace);
+	alm_slaves_del();
+	debugfs_remove_recursive(alm_debugfs);
+	pr_info(MOD_INFO "Driver removed\n");
+}
+
+module_init(alm_init);
+module_exit(alm_exit);
+
+/* Module description */
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Pudja Mansyurin");
+MODULE_DESCRIPTION(MOD_NAME);
+MODULE_VERSION("3:5.4");
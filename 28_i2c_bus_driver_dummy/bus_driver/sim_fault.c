@@ -0,0 +1,155 @@
+#include <linux/delay.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include "sim_fault.h"
+
+/* Private macros */
+#define WIRE_BITS (9) /* per byte: 8 data bits and the ACK */
+#define SPIN_MAX_NS (20 * NSEC_PER_USEC) /* sleeping is coarser than this */
+
+/* Function implementations */
+/**
+ * sim_fault_draw - true with a probability of ppm parts per million,
+ * called with f->lock held
+ */
+static bool sim_fault_draw(struct sim_fault *f, u32 ppm)
+{
+	if (ppm == 0)
+		return false;
+	return prandom_u32_state(&f->rnd) % SIM_FAULT_PPM < ppm;
+}
+
+/**
+ * sim_fault_delay - hold the bus for ns, like the real transfer would
+ */
+static void sim_fault_delay(u64 ns)
+{
+	unsigned long us;
+
+	if (ns == 0)
+		return;
+	if (ns < SPIN_MAX_NS) {
+		ndelay(ns);
+		return;
+	}
+
+	us = div_u64(ns, NSEC_PER_USEC);
+	usleep_range(us, us + 1);
+}
+
+/**
+ * sim_fault_msg - apply the bus conditions to one message. Draw an
+ * arbitration loss, then a NACK for the address and for every byte the
+ * slave has to ACK, then spend the wire time of the bytes that were sent.
+ *
+ * Return: data bytes the slave ACKs, the whole message unless a data NACK
+ * was drawn, -EAGAIN on arbitration loss, -ENXIO on an address NACK
+ */
+int sim_fault_msg(struct sim_fault *f, const struct i2c_msg *msg)
+{
+	u32 speed = READ_ONCE(f->speed_hz);
+	u32 stretch = READ_ONCE(f->stretch_us);
+	u32 nack = READ_ONCE(f->nack_ppm);
+	u32 bytes = 1 + msg->len; /* the address first */
+	u64 wire = 0, held;
+	int ret = msg->len;
+	u16 i;
+
+	spin_lock(&f->lock);
+	if (sim_fault_draw(f, READ_ONCE(f->arb_ppm))) {
+		/* another master won during the address byte */
+		bytes = 1;
+		ret = -EAGAIN;
+		f->arb_lost++;
+	} else if (sim_fault_draw(f, nack)) {
+		bytes = 1;
+		ret = -ENXIO;
+		f->addr_nacks++;
+	} else if (!(msg->flags & I2C_M_RD)) {
+		/* read data is ACKed by the master */
+		for (i = 0; i < msg->len; i++) {
+			if (sim_fault_draw(f, nack)) {
+				bytes = 2 + i;
+				ret = i;
+				f->data_nacks++;
+				break;
+			}
+		}
+	}
+	spin_unlock(&f->lock);
+
+	if (speed)
+		wire = div_u64((u64)bytes * WIRE_BITS * NSEC_PER_SEC, speed);
+	held = (u64)bytes * stretch * NSEC_PER_USEC;
+	sim_fault_delay(wire + held);
+
+	f->msgs++;
+	f->bytes += bytes;
+	f->wire_ns += wire;
+	f->stretch_ns += held;
+	return ret;
+}
+
+static int sim_fault_seed_get(void *data, u64 *val)
+{
+	struct sim_fault *f = data;
+
+	spin_lock(&f->lock);
+	*val = f->seed;
+	spin_unlock(&f->lock);
+	return 0;
+}
+
+/* writing the seed restarts the fault sequence */
+static int sim_fault_seed_set(void *data, u64 val)
+{
+	struct sim_fault *f = data;
+
+	spin_lock(&f->lock);
+	f->seed = val;
+	prandom_seed_state(&f->rnd, val);
+	spin_unlock(&f->lock);
+	return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(sim_fault_seed_fops, sim_fault_seed_get,
+			 sim_fault_seed_set, "%llu\n");
+
+static int sim_fault_stats_show(struct seq_file *m, void *unused)
+{
+	struct sim_fault *f = m->private;
+
+	seq_printf(m, "msgs:       %llu\n", READ_ONCE(f->msgs));
+	seq_printf(m, "bytes:      %llu\n", READ_ONCE(f->bytes));
+	seq_printf(m, "wire ns:    %llu\n", READ_ONCE(f->wire_ns));
+	seq_printf(m, "stretch ns: %llu\n", READ_ONCE(f->stretch_ns));
+	seq_printf(m, "addr nacks: %llu\n", READ_ONCE(f->addr_nacks));
+	seq_printf(m, "data nacks: %llu\n", READ_ONCE(f->data_nacks));
+	seq_printf(m, "arb lost:   %llu\n", READ_ONCE(f->arb_lost));
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(sim_fault_stats);
+
+/**
+ * sim_fault_init - ideal bus, and the knobs in <parent>/fault/: speed_hz
+ * (e.g. 100000, 400000 or 1000000), stretch_us, nack_ppm, arb_ppm, seed
+ * and stats
+ */
+void sim_fault_init(struct sim_fault *f, u64 seed, struct dentry *parent)
+{
+	struct dentry *dir;
+
+	memset(f, 0, sizeof(*f));
+	spin_lock_init(&f->lock);
+	f->seed = seed;
+	prandom_seed_state(&f->rnd, seed);
+
+	dir = debugfs_create_dir("fault", parent);
+	debugfs_create_u32("speed_hz", 0644, dir, &f->speed_hz);
+	debugfs_create_u32("stretch_us", 0644, dir, &f->stretch_us);
+	debugfs_create_u32("nack_ppm", 0644, dir, &f->nack_ppm);
+	debugfs_create_u32("arb_ppm", 0644, dir, &f->arb_ppm);
+	debugfs_create_file_unsafe("seed", 0644, dir, f, &sim_fault_seed_fops);
+	debugfs_create_file("stats", 0444, dir, f, &sim_fault_stats_fops);
+}
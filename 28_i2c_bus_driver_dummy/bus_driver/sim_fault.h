@@ -0,0 +1,47 @@
+#ifndef __SIM_FAULT_H__
+#define __SIM_FAULT_H__
+
+#include <linux/i2c.h>
+#include <linux/spinlock.h>
+#include <linux/debugfs.h>
+#include <linux/version.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 8, 0)
+#include <linux/prandom.h>
+#else
+#include <linux/random.h>
+#endif
+
+#define SIM_FAULT_PPM (1000000) /* probabilities are parts per million */
+
+/*
+ * Bus conditions seen by one address. Every message takes the time its
+ * bytes need on the wire at speed_hz, plus stretch_us per byte the slave
+ * holds SCL low. Arbitration loss and NACKs are drawn from a private
+ * generator, so the same seed gives the same faults in the same order.
+ */
+struct sim_fault {
+	/* knobs, written from debugfs at any time */
+	u32 speed_hz; /* 0: no wire time */
+	u32 stretch_us;
+	u32 nack_ppm; /* per byte the slave has to ACK */
+	u32 arb_ppm; /* per message */
+
+	spinlock_t lock; /* protects rnd and seed */
+	struct rnd_state rnd;
+	u64 seed;
+
+	/* statistic */
+	u64 msgs;
+	u64 bytes;
+	u64 wire_ns;
+	u64 stretch_ns;
+	u64 addr_nacks;
+	u64 data_nacks;
+	u64 arb_lost;
+};
+
+/* exported functions */
+void sim_fault_init(struct sim_fault *f, u64 seed, struct dentry *parent);
+int sim_fault_msg(struct sim_fault *f, const struct i2c_msg *msg);
+
+#endif /* __SIM_FAULT_H__ */
@@ -0,0 +1,244 @@
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include "sim_slave.h"
+#include "smbus_pec.h"
+
+/*
+ * Generic SMBus register file. Commands 0x00-0x7f are byte registers with
+ * an auto-incrementing pointer (byte, byte-data and word-data protocols),
+ * commands 0x80-0xff are block registers holding a count and up to 32
+ * bytes (block-data protocol). Writes take effect at STOP, or at the
+ * repeated START of a register read. With PEC enabled the last byte of a
+ * write transaction must be a valid PEC, else the write is dropped, and
+ * the last byte of every read is the PEC of the whole transaction.
+ */
+
+/* Private macros */
+#define REGFILE_BYTE_REGS (0x80)
+#define REGFILE_BLOCK_REGS (0x80)
+#define REGFILE_WBUF (2 + I2C_SMBUS_BLOCK_MAX + 1) /* cmd, count, data, PEC */
+
+/* Private types */
+struct regfile_model {
+	struct mutex lock;
+	u8 regs[REGFILE_BYTE_REGS];
+	u8 blk[REGFILE_BLOCK_REGS][I2C_SMBUS_BLOCK_MAX];
+	u8 blklen[REGFILE_BLOCK_REGS];
+	u8 ptr;
+	bool pec;
+
+	/* current transaction, from START to STOP */
+	u8 crc; /* every byte so far */
+	u8 wbuf[REGFILE_WBUF];
+	u16 wlen;
+	u8 wcrc; /* the pending write, without its last byte */
+
+	/* statistic */
+	u64 writes;
+	u64 reads;
+	u64 pec_errors;
+	u64 errors; /* NACKs, bad block counts */
+};
+
+/* Function implementations */
+/**
+ * regfile_commit - apply a complete write: [cmd] moves the pointer,
+ * [cmd, data...] fills byte registers, [cmd, count, data...] a block
+ */
+static void regfile_commit(struct regfile_model *m, const u8 *buf, u16 len)
+{
+	u8 cmd = buf[0], count, i;
+
+	m->ptr = cmd;
+	if (len == 1)
+		return;
+
+	m->writes++;
+	if (cmd < REGFILE_BYTE_REGS) {
+		for (i = 1; i < len; i++) {
+			m->regs[m->ptr] = buf[i];
+			m->ptr = (m->ptr + 1) % REGFILE_BYTE_REGS;
+		}
+		return;
+	}
+
+	count = buf[1];
+	if (count == 0 || count > I2C_SMBUS_BLOCK_MAX || count != len - 2) {
+		m->errors++;
+		return;
+	}
+	memcpy(m->blk[cmd - REGFILE_BYTE_REGS], &buf[2], count);
+	m->blklen[cmd - REGFILE_BYTE_REGS] = count;
+}
+
+/**
+ * regfile_flush - finish the pending write, check its PEC if asked to
+ */
+static void regfile_flush(struct regfile_model *m, bool check_pec)
+{
+	u16 len = m->wlen;
+
+	m->wlen = 0;
+	if (len == 0)
+		return;
+
+	if (check_pec && m->pec) {
+		if (len < 2 || m->wbuf[len - 1] != m->wcrc) {
+			m->pec_errors++;
+			return;
+		}
+		len--;
+	}
+	regfile_commit(m, m->wbuf, len);
+}
+
+static int regfile_write(struct sim_slave *slave, const u8 *buf, u16 len)
+{
+	struct regfile_model *m = slave->priv;
+	u16 ack = min_t(u16, len, REGFILE_WBUF);
+
+	mutex_lock(&m->lock);
+
+	/* write after write without STOP: no PEC between them */
+	regfile_flush(m, false);
+
+	m->crc = smbus_pec_addr(m->crc, slave->addr, false);
+	if (ack)
+		m->wcrc = smbus_crc8(m->crc, buf, ack - 1);
+	m->crc = smbus_crc8(m->crc, buf, ack);
+
+	memcpy(m->wbuf, buf, ack);
+	m->wlen = ack;
+	if (ack < len) {
+		/* too long for any protocol, NACK and forget it */
+		m->wlen = 0;
+		m->errors++;
+	}
+	mutex_unlock(&m->lock);
+
+	return ack;
+}
+
+/**
+ * regfile_read - fill buf from the pointer. A byte register streams with
+ * auto-increment, a block register streams its count then its data.
+ * recv_len stops after count bytes (SMBus block read), otherwise len
+ * bytes are returned.
+ *
+ * Return: bytes produced
+ */
+static int regfile_read(struct sim_slave *slave, u8 *buf, u16 len,
+			bool recv_len)
+{
+	struct regfile_model *m = slave->priv;
+	u16 n, i, data;
+	u8 *blk;
+
+	mutex_lock(&m->lock);
+
+	/* a register read: the write only carried the command */
+	regfile_flush(m, false);
+
+	m->crc = smbus_pec_addr(m->crc, slave->addr, true);
+	m->reads++;
+
+	data = (m->pec && len) ? len - 1 : len;
+	if (m->ptr < REGFILE_BYTE_REGS) {
+		for (n = 0; n < data; n++) {
+			buf[n] = m->regs[m->ptr];
+			m->ptr = (m->ptr + 1) % REGFILE_BYTE_REGS;
+		}
+	} else {
+		i = m->ptr - REGFILE_BYTE_REGS;
+		blk = m->blk[i];
+		if (recv_len)
+			data = min_t(u16, data, m->blklen[i] + 1);
+		for (n = 0; n < data; n++)
+			buf[n] = n == 0 ? m->blklen[i] :
+			   n <= m->blklen[i] ? blk[n - 1] : 0xff;
+	}
+
+	m->crc = smbus_crc8(m->crc, buf, n);
+	if (m->pec && n < len)
+		buf[n++] = m->crc;
+
+	mutex_unlock(&m->lock);
+	return n;
+}
+
+static void regfile_stop(struct sim_slave *slave)
+{
+	struct regfile_model *m = slave->priv;
+
+	mutex_lock(&m->lock);
+	regfile_flush(m, true);
+	m->crc = 0;
+	mutex_unlock(&m->lock);
+}
+
+static int regfile_init(struct sim_slave *slave)
+{
+	struct regfile_model *m;
+
+	if ((m = kzalloc(sizeof(*m), GFP_KERNEL)) == NULL)
+		return -ENOMEM;
+
+	mutex_init(&m->lock);
+	slave->priv = m;
+	return 0;
+}
+
+static void regfile_exit(struct sim_slave *slave)
+{
+	kfree(slave->priv);
+}
+
+static int regfile_regs_show(struct seq_file *s, void *unused)
+{
+	struct regfile_model *m = s->private;
+	int i;
+
+	mutex_lock(&m->lock);
+	seq_printf(s, "pointer:    0x%02x\n", m->ptr);
+	seq_printf(s, "pec:        %s\n", m->pec ? "on" : "off");
+	seq_printf(s, "writes:     %llu\n", m->writes);
+	seq_printf(s, "reads:      %llu\n", m->reads);
+	seq_printf(s, "pec errors: %llu\n", m->pec_errors);
+	seq_printf(s, "errors:     %llu\n", m->errors);
+
+	seq_putc(s, '\n');
+	for (i = 0; i < REGFILE_BYTE_REGS; i += 16)
+		seq_printf(s, "0x%02x      %16ph\n", i, &m->regs[i]);
+
+	for (i = 0; i < REGFILE_BLOCK_REGS; i++) {
+		if (m->blklen[i] == 0)
+			continue;
+		seq_printf(s, "0x%02x [%2u] %*ph\n", REGFILE_BYTE_REGS + i,
+			   m->blklen[i], m->blklen[i], m->blk[i]);
+	}
+	mutex_unlock(&m->lock);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(regfile_regs);
+
+static void regfile_debugfs(struct sim_slave *slave, struct dentry *dir)
+{
+	struct regfile_model *m = slave->priv;
+
+	debugfs_create_bool("pec", 0644, dir, &m->pec);
+	debugfs_create_file("regs", 0444, dir, m, &regfile_regs_fops);
+}
+
+/* SMBus register file */
+const struct sim_slave_ops sim_regfile_ops = {
+	.name = "regfile",
+	.init = regfile_init,
+	.exit = regfile_exit,
+	.write = regfile_write,
+	.read = regfile_read,
+	.stop = regfile_stop,
+	.debugfs = regfile_debugfs,
+};
@@ -0,0 +1,83 @@
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/i2c.h>
+#include "sim_slave.h"
+
+/* Private variables */
+static const struct sim_slave_ops *sim_models[] = {
+	&sim_ssd1306_ops,
+	&sim_regfile_ops,
+};
+
+/**
+ * sim_model_find - look up a model by name
+ *
+ * Return: model operations, or NULL
+ */
+static const struct sim_slave_ops *sim_model_find(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sim_models); i++)
+		if (strcmp(sim_models[i]->name, name) == 0)
+			return sim_models[i];
+	return NULL;
+}
+
+/**
+ * sim_slave_new - instantiate a model from "<model>@<addr>", e.g.
+ * "ssd1306@0x3c", with its debugfs files under root
+ *
+ * Return: the slave, or an ERR_PTR()
+ */
+struct sim_slave *sim_slave_new(const char *spec, struct dentry *root)
+{
+	struct sim_slave *slave;
+	char name[32], *at;
+	u16 addr;
+	int err;
+
+	strscpy(name, spec, sizeof(name));
+	if ((at = strchr(name, '@')) == NULL)
+		return ERR_PTR(-EINVAL);
+	*at++ = '\0';
+
+	if (kstrtou16(at, 0, &addr) < 0 || addr > SIM_ADDR_MAX)
+		return ERR_PTR(-EINVAL);
+
+	if ((slave = kzalloc(sizeof(*slave), GFP_KERNEL)) == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	slave->addr = addr;
+	if ((slave->ops = sim_model_find(name)) == NULL) {
+		err = -ENOENT;
+		goto r_slave;
+	}
+
+	if ((err = slave->ops->init(slave)) < 0)
+		goto r_slave;
+
+	snprintf(name, sizeof(name), "0x%02x-%s", addr, slave->ops->name);
+	slave->dir = debugfs_create_dir(name, root);
+	/* seeded by address, every load replays the same faults */
+	sim_fault_init(&slave->fault, addr, slave->dir);
+	if (slave->ops->debugfs)
+		slave->ops->debugfs(slave, slave->dir);
+
+	return slave;
+
+r_slave:
+	kfree(slave);
+	return ERR_PTR(err);
+}
+
+/**
+ * sim_slave_del - remove the debugfs files and free the model
+ */
+void sim_slave_del(struct sim_slave *slave)
+{
+	debugfs_remove_recursive(slave->dir);
+	if (slave->ops->exit)
+		slave->ops->exit(slave);
+	kfree(slave);
+}
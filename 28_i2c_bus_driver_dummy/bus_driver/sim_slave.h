@@ -0,0 +1,48 @@
+#ifndef __SIM_SLAVE_H__
+#define __SIM_SLAVE_H__
+
+#include <linux/module.h>
+#include <linux/debugfs.h>
+#include "sim_fault.h"
+
+#define SIM_MAX_SLAVES (8)
+#define SIM_ADDR_MAX (0x7f) /* 7-bit addressing only */
+
+struct sim_slave;
+
+/*
+ * In-kernel model of an I2C slave. The adapter calls write() or read()
+ * once per message, i.e. between a (repeated) START and the next START or
+ * STOP, and stop() after the last message of a transfer. write() returns
+ * the number of bytes the slave ACKed, read() the number of bytes it
+ * produced into buf (at most len), or a negative errno. recv_len marks
+ * an SMBus block read, which ends after the count sent in the first byte.
+ */
+struct sim_slave_ops {
+	const char *name;
+	int (*init)(struct sim_slave *slave);
+	void (*exit)(struct sim_slave *slave);
+	int (*write)(struct sim_slave *slave, const u8 *buf, u16 len);
+	int (*read)(struct sim_slave *slave, u8 *buf, u16 len, bool recv_len);
+	void (*stop)(struct sim_slave *slave);
+	void (*debugfs)(struct sim_slave *slave, struct dentry *dir);
+};
+
+/* sim_slave structure */
+struct sim_slave {
+	u16 addr;
+	const struct sim_slave_ops *ops;
+	struct dentry *dir; /* <debugfs root>/<addr>-<model>/ */
+	struct sim_fault fault; /* bus conditions at this address */
+	void *priv; /* model state */
+};
+
+/* available models */
+extern const struct sim_slave_ops sim_ssd1306_ops;
+extern const struct sim_slave_ops sim_regfile_ops;
+
+/* exported functions */
+struct sim_slave *sim_slave_new(const char *spec, struct dentry *root);
+void sim_slave_del(struct sim_slave *slave);
+
+#endif /* __SIM_SLAVE_H__ */
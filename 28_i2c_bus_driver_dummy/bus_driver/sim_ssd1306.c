@@ -0,0 +1,443 @@
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include "sim_slave.h"
+
+/* Private macros */
+#define SSD1306_PAGES (8)
+#define SSD1306_COLS (128)
+#define SSD1306_ROWS (SSD1306_PAGES * 8)
+#define SSD1306_MAX_ARGS (6)
+
+/* control byte */
+#define CTRL_CO BIT(7) /* one byte follows, then another control byte */
+#define CTRL_DC BIT(6) /* data, otherwise command */
+#define CTRL_RESERVED (0x3f)
+
+/* status byte, the only thing a read returns */
+#define STATUS_DISPLAY_OFF BIT(6)
+
+enum ssd1306_mode {
+	MODE_HORIZONTAL = 0,
+	MODE_VERTICAL = 1,
+	MODE_PAGE = 2,
+};
+
+/* Private types */
+struct ssd1306_scroll {
+	u8 cmd; /* 0x26, 0x27, 0x29 or 0x2a, 0 if never set up */
+	u8 start_page;
+	u8 end_page;
+	u8 interval;
+	u8 voffset;
+	u8 area_top; /* 0xa3 */
+	u8 area_rows;
+	bool active;
+};
+
+struct ssd1306_model {
+	struct mutex lock; /* against debugfs readers */
+	u8 gddram[SSD1306_PAGES][SSD1306_COLS];
+
+	/* command decoder, survives across messages */
+	u8 cmd;
+	u8 args[SSD1306_MAX_ARGS];
+	u8 nargs;
+	u8 need;
+
+	/* addressing */
+	enum ssd1306_mode mode;
+	u8 col, page; /* pointers */
+	u8 col_start, col_end; /* 0x21 window */
+	u8 page_start, page_end; /* 0x22 window */
+	u8 page_col; /* column start in page mode, 0x00-0x1f */
+
+	/* display */
+	bool on;
+	bool inverse;
+	bool entire_on;
+	bool seg_remap;
+	bool com_remap;
+	u8 contrast;
+	u8 start_line;
+	u8 offset;
+	u8 mux;
+	bool charge_pump;
+	struct ssd1306_scroll scroll;
+
+	/* statistic */
+	u64 cmds;
+	u64 data;
+	u64 errors; /* bad control bytes, invalid arguments */
+};
+
+/* Function implementations */
+/**
+ * ssd1306_cmd_args - number of argument bytes following a command
+ */
+static u8 ssd1306_cmd_args(u8 cmd)
+{
+	switch (cmd) {
+	case 0x20: /* memory addressing mode */
+	case 0x81: /* contrast */
+	case 0x8d: /* charge pump */
+	case 0xa8: /* multiplex ratio */
+	case 0xd3: /* display offset */
+	case 0xd5: /* clock divide */
+	case 0xd9: /* pre-charge */
+	case 0xda: /* COM pins */
+	case 0xdb: /* Vcomh */
+		return 1;
+	case 0x21: /* column address */
+	case 0x22: /* page address */
+	case 0xa3: /* vertical scroll area */
+		return 2;
+	case 0x29: /* vertical and right scroll */
+	case 0x2a: /* vertical and left scroll */
+		return 5;
+	case 0x26: /* right scroll */
+	case 0x27: /* left scroll */
+		return 6;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * ssd1306_exec - run one complete command with its arguments
+ */
+static void ssd1306_exec(struct ssd1306_model *m, u8 cmd, const u8 *a)
+{
+	struct ssd1306_scroll *s = &m->scroll;
+
+	m->cmds++;
+
+	if (cmd <= 0x0f) {
+		m->page_col = (m->page_col & 0xf0) | cmd;
+		m->col = m->page_col;
+		return;
+	}
+	if (cmd <= 0x1f) {
+		m->page_col = ((cmd & 0x07) << 4) | (m->page_col & 0x0f);
+		m->col = m->page_col;
+		return;
+	}
+	if (cmd >= 0x40 && cmd <= 0x7f) {
+		m->start_line = cmd & 0x3f;
+		return;
+	}
+	if (cmd >= 0xb0 && cmd <= 0xb7) {
+		m->page = cmd & 0x07;
+		return;
+	}
+
+	switch (cmd) {
+	case 0x20:
+		if ((a[0] & 0x03) == 0x03) {
+			m->errors++;
+			break;
+		}
+		m->mode = a[0] & 0x03;
+		break;
+	case 0x21:
+		m->col_start = a[0] & 0x7f;
+		m->col_end = a[1] & 0x7f;
+		m->col = m->col_start;
+		break;
+	case 0x22:
+		m->page_start = a[0] & 0x07;
+		m->page_end = a[1] & 0x07;
+		m->page = m->page_start;
+		break;
+	case 0x26:
+	case 0x27:
+	case 0x29:
+	case 0x2a:
+		/* the datasheet requires scrolling off before a new setup */
+		if (s->active)
+			m->errors++;
+		s->cmd = cmd;
+		s->start_page = a[1] & 0x07;
+		s->interval = a[2] & 0x07;
+		s->end_page = a[3] & 0x07;
+		s->voffset = (cmd >= 0x29) ? a[4] & 0x3f : 0;
+		if (s->end_page < s->start_page)
+			m->errors++;
+		break;
+	case 0x2e:
+		s->active = false;
+		break;
+	case 0x2f:
+		if (s->cmd == 0) {
+			m->errors++;
+			break;
+		}
+		s->active = true;
+		break;
+	case 0x81:
+		m->contrast = a[0];
+		break;
+	case 0x8d:
+		m->charge_pump = a[0] & BIT(2);
+		break;
+	case 0xa0:
+	case 0xa1:
+		m->seg_remap = cmd & 1;
+		break;
+	case 0xa3:
+		s->area_top = a[0] & 0x3f;
+		s->area_rows = a[1] & 0x7f;
+		break;
+	case 0xa4:
+	case 0xa5:
+		m->entire_on = cmd & 1;
+		break;
+	case 0xa6:
+	case 0xa7:
+		m->inverse = cmd & 1;
+		break;
+	case 0xa8:
+		if ((a[0] & 0x3f) < 15)
+			m->errors++;
+		else
+			m->mux = a[0] & 0x3f;
+		break;
+	case 0xae:
+	case 0xaf:
+		m->on = cmd & 1;
+		break;
+	case 0xc0:
+	case 0xc8:
+		m->com_remap = cmd & 0x08;
+		break;
+	case 0xd3:
+		m->offset = a[0] & 0x3f;
+		break;
+	case 0xd5: /* timing only, nothing to model */
+	case 0xd9:
+	case 0xda:
+	case 0xdb:
+	case 0xe3: /* NOP */
+		break;
+	default:
+		m->errors++;
+		break;
+	}
+}
+
+/**
+ * ssd1306_cmd_byte - feed one byte to the command decoder
+ */
+static void ssd1306_cmd_byte(struct ssd1306_model *m, u8 byte)
+{
+	if (m->need == 0) {
+		m->cmd = byte;
+		m->nargs = 0;
+		m->need = ssd1306_cmd_args(byte);
+		if (m->need == 0)
+			ssd1306_exec(m, byte, m->args);
+		return;
+	}
+
+	m->args[m->nargs++] = byte;
+	if (m->nargs == m->need) {
+		m->need = 0;
+		ssd1306_exec(m, m->cmd, m->args);
+	}
+}
+
+/**
+ * ssd1306_data_byte - store one byte in GDDRAM and advance the pointers
+ * like the addressing mode does
+ */
+static void ssd1306_data_byte(struct ssd1306_model *m, u8 byte)
+{
+	m->gddram[m->page][m->col] = byte;
+	m->data++;
+
+	switch (m->mode) {
+	case MODE_HORIZONTAL:
+		if (m->col++ < m->col_end)
+			break;
+		m->col = m->col_start;
+		if (m->page++ >= m->page_end)
+			m->page = m->page_start;
+		break;
+	case MODE_VERTICAL:
+		if (m->page++ < m->page_end)
+			break;
+		m->page = m->page_start;
+		if (m->col++ >= m->col_end)
+			m->col = m->col_start;
+		break;
+	case MODE_PAGE:
+		/* the page pointer never moves */
+		if (m->col++ >= SSD1306_COLS - 1)
+			m->col = m->page_col;
+		break;
+	}
+}
+
+/**
+ * ssd1306_write - decode one write message: a control byte, then either
+ * one byte (Co = 1) followed by the next control byte, or the rest of the
+ * message (Co = 0) as commands or GDDRAM data depending on D/C#
+ *
+ * Return: bytes ACKed, always the whole message
+ */
+static int ssd1306_write(struct sim_slave *slave, const u8 *buf, u16 len)
+{
+	struct ssd1306_model *m = slave->priv;
+	u16 i = 0;
+	u8 ctrl;
+
+	mutex_lock(&m->lock);
+	while (i < len) {
+		ctrl = buf[i++];
+		if (ctrl & CTRL_RESERVED)
+			m->errors++;
+
+		for (; i < len; i++) {
+			if (ctrl & CTRL_DC)
+				ssd1306_data_byte(m, buf[i]);
+			else
+				ssd1306_cmd_byte(m, buf[i]);
+
+			if (ctrl & CTRL_CO) {
+				i++;
+				break;
+			}
+		}
+	}
+	mutex_unlock(&m->lock);
+
+	return len;
+}
+
+/**
+ * ssd1306_read - the I2C interface can only read the status byte
+ *
+ * Return: bytes read
+ */
+static int ssd1306_read(struct sim_slave *slave, u8 *buf, u16 len,
+			bool recv_len)
+{
+	struct ssd1306_model *m = slave->priv;
+
+	memset(buf, READ_ONCE(m->on) ? 0 : STATUS_DISPLAY_OFF, len);
+	return len;
+}
+
+/**
+ * ssd1306_reset - power-on state from the datasheet
+ */
+static void ssd1306_reset(struct ssd1306_model *m)
+{
+	m->mode = MODE_PAGE;
+	m->col_end = SSD1306_COLS - 1;
+	m->page_end = SSD1306_PAGES - 1;
+	m->contrast = 0x7f;
+	m->mux = SSD1306_ROWS - 1;
+	m->scroll.area_rows = SSD1306_ROWS;
+}
+
+static int ssd1306_init(struct sim_slave *slave)
+{
+	struct ssd1306_model *m;
+
+	if ((m = kzalloc(sizeof(*m), GFP_KERNEL)) == NULL)
+		return -ENOMEM;
+
+	mutex_init(&m->lock);
+	ssd1306_reset(m);
+	slave->priv = m;
+	return 0;
+}
+
+static void ssd1306_exit(struct sim_slave *slave)
+{
+	kfree(slave->priv);
+}
+
+/**
+ * ssd1306_pbm_show - GDDRAM as a binary PBM (P4), column x of page p bit b
+ * is pixel (x, 8 * p + b), a lit pixel is 1 (black)
+ */
+static int ssd1306_pbm_show(struct seq_file *s, void *unused)
+{
+	struct ssd1306_model *m = s->private;
+	u8 row[SSD1306_COLS / 8];
+	int x, y;
+
+	seq_printf(s, "P4\n%d %d\n", SSD1306_COLS, SSD1306_ROWS);
+
+	mutex_lock(&m->lock);
+	for (y = 0; y < SSD1306_ROWS; y++) {
+		memset(row, 0, sizeof(row));
+		for (x = 0; x < SSD1306_COLS; x++)
+			if (m->gddram[y / 8][x] & BIT(y % 8))
+				row[x / 8] |= 0x80 >> (x % 8);
+		seq_write(s, row, sizeof(row));
+	}
+	mutex_unlock(&m->lock);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(ssd1306_pbm);
+
+static int ssd1306_state_show(struct seq_file *s, void *unused)
+{
+	static const char *const modes[] = { "horizontal", "vertical", "page" };
+	struct ssd1306_model *m = s->private;
+	struct ssd1306_scroll *sc = &m->scroll;
+
+	mutex_lock(&m->lock);
+	seq_printf(s, "display:     %s%s%s\n", m->on ? "on" : "off",
+		   m->inverse ? " inverse" : "",
+		   m->entire_on ? " entire-on" : "");
+	seq_printf(s, "contrast:    0x%02x\n", m->contrast);
+	seq_printf(s, "charge pump: %s\n", m->charge_pump ? "on" : "off");
+	seq_printf(s, "mux:         %u\n", m->mux + 1);
+	seq_printf(s, "start line:  %u\n", m->start_line);
+	seq_printf(s, "offset:      %u\n", m->offset);
+	seq_printf(s, "remap:       seg %d com %d\n", m->seg_remap,
+		   m->com_remap);
+	seq_printf(s, "mode:        %s\n", modes[m->mode]);
+	seq_printf(s, "columns:     %u-%u\n", m->col_start, m->col_end);
+	seq_printf(s, "pages:       %u-%u\n", m->page_start, m->page_end);
+	seq_printf(s, "cursor:      page %u col %u\n", m->page, m->col);
+	seq_printf(s, "scroll:      %s cmd 0x%02x pages %u-%u interval %u "
+		      "voffset %u area %u+%u\n",
+		   sc->active ? "on" : "off", sc->cmd, sc->start_page,
+		   sc->end_page, sc->interval, sc->voffset, sc->area_top,
+		   sc->area_rows);
+	seq_printf(s, "pending:     %u/%u args of 0x%02x\n", m->nargs, m->need,
+		   m->need ? m->cmd : 0);
+	seq_printf(s, "commands:    %llu\n", m->cmds);
+	seq_printf(s, "data:        %llu\n", m->data);
+	seq_printf(s, "errors:      %llu\n", m->errors);
+	mutex_unlock(&m->lock);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(ssd1306_state);
+
+static void ssd1306_debugfs(struct sim_slave *slave, struct dentry *dir)
+{
+	debugfs_create_file("gddram.pbm", 0444, dir, slave->priv,
+			    &ssd1306_pbm_fops);
+	debugfs_create_file("state", 0444, dir, slave->priv,
+			    &ssd1306_state_fops);
+}
+
+/* SSD1306 128x64 OLED controller */
+const struct sim_slave_ops sim_ssd1306_ops = {
+	.name = "ssd1306",
+	.init = ssd1306_init,
+	.exit = ssd1306_exit,
+	.write = ssd1306_write,
+	.read = ssd1306_read,
+	.debugfs = ssd1306_debugfs,
+};
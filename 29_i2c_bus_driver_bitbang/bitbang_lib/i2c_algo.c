@@ -0,0 +1,430 @@
+#include <linux/i2c.h>
+#include <linux/jiffies.h>
+#include "i2c_bbang_bus.h"
+#include "i2c_bitbang.h"
+#include "smbus_pec.h"
+
+/**
+ * i2c_custom_func - list supported functionalities of the custom engine
+ *
+ * Return: merged functionalities
+ */
+static u32 i2c_custom_func(struct i2c_adapter *adapter)
+{
+	return (I2C_FUNC_I2C | I2C_FUNC_SMBUS_QUICK | I2C_FUNC_SMBUS_BYTE |
+		I2C_FUNC_SMBUS_BYTE_DATA | I2C_FUNC_SMBUS_WORD_DATA |
+		I2C_FUNC_SMBUS_BLOCK_DATA | I2C_FUNC_SMBUS_PEC |
+		I2C_FUNC_10BIT_ADDR);
+}
+
+/**
+ * i2c_custom_addr - address the slave of a message, 7 or 10 bits
+ *
+ * Return: 0, or -ENXIO when nobody ACKs the address
+ */
+static int i2c_custom_addr(struct i2c_gpio *p, const struct i2c_msg *msg)
+{
+	bool is_read = msg->flags & I2C_M_RD;
+	int ret;
+
+	if (msg->flags & I2C_M_TEN)
+		ret = i2c_bbang_send_addr10(p, msg->addr, is_read);
+	else
+		ret = i2c_bbang_send_addr(p, msg->addr, is_read);
+
+	return ret < 0 ? -ENXIO : 0;
+}
+
+/**
+ * i2c_custom_recv - read the data of a message, a block read (I2C_M_RECV_LEN)
+ * learns its length from the first byte
+ *
+ * Return: 0, or -EPROTO on a bad block count
+ */
+static int i2c_custom_recv(struct i2c_gpio *p, struct i2c_msg *msg)
+{
+	u8 count;
+
+	if (!(msg->flags & I2C_M_RECV_LEN)) {
+		i2c_bbang_recv(p, msg->buf, msg->len);
+		return 0;
+	}
+
+	count = i2c_bbang_read_byte(p, true);
+	if (count == 0 || count > I2C_SMBUS_BLOCK_MAX) {
+		i2c_bbang_read_byte(p, false); /* NACK to end the read */
+		return -EPROTO;
+	}
+
+	/* msg->len already counts the count byte, and the PEC if any */
+	msg->buf[0] = count;
+	i2c_bbang_recv(p, &msg->buf[1], msg->len - 1 + count);
+	msg->len += count;
+	return 0;
+}
+
+/**
+ * i2c_custom_xfer - low level i2c routine, every message starts with a
+ * (repeated) START and the transfer ends with a single STOP
+ *
+ * Return: number of messages transferred, or errno
+ */
+static int i2c_custom_xfer(struct i2c_adapter *adapter, struct i2c_msg *msgs,
+			   int num)
+{
+	struct i2c_bbang_bus *bus = to_i2c_bbang_bus(adapter);
+	struct i2c_gpio *p = &bus->gpio;
+	u64 t0 = ktime_get_ns();
+	struct i2c_msg *msg;
+	int ret = 0, i;
+
+	if ((ret = i2c_bbang_bus_begin(bus)) < 0) {
+		i2c_bbang_bus_end(bus, t0, ret);
+		return ret;
+	}
+
+	for (i = 0; i < num; i++) {
+		msg = &msgs[i];
+
+		i2c_bbang_start(p);
+		ret = i2c_custom_addr(p, msg);
+		if (ret == 0 && (msg->flags & I2C_M_RD))
+			ret = i2c_custom_recv(p, msg);
+		else if (ret == 0 &&
+			 i2c_bbang_send(p, msg->buf, msg->len) < msg->len)
+			ret = -EIO;
+
+		/* a slave held SCL too long, nothing it sent is valid */
+		if (p->timing.stretch_expired)
+			ret = -ETIMEDOUT;
+		if (ret < 0)
+			break;
+
+		bus->stats.msgs++;
+		bus->stats.bytes += msg->len;
+		dev_dbg(&adapter->dev,
+			"addr 0x%02x flags 0x%04x len %u: %*ph\n", msg->addr,
+			msg->flags, msg->len, min_t(int, msg->len, 64),
+			msg->buf);
+	}
+
+	i2c_bbang_stop(p);
+	i2c_bbang_bus_end(bus, t0, ret);
+
+	return ret < 0 ? ret : num;
+}
+
+/**
+ * i2c_custom_smbus_addr - (repeated) START and slave address, counted in
+ * the PEC
+ *
+ * Return: 0, or -ENXIO when nobody ACKs the address
+ */
+static int i2c_custom_smbus_addr(struct i2c_gpio *p, u16 addr, bool is_read,
+				 u8 *crc)
+{
+	i2c_bbang_start(p);
+	*crc = smbus_pec_addr(*crc, addr, is_read);
+
+	return i2c_bbang_send_addr(p, addr, is_read) < 0 ? -ENXIO : 0;
+}
+
+/**
+ * i2c_custom_smbus_write - send len bytes, counted in the PEC
+ *
+ * Return: 0, or -EIO on a data NACK
+ */
+static int i2c_custom_smbus_write(struct i2c_bbang_bus *bus, const u8 *buf,
+				  u16 len, u8 *crc)
+{
+	struct i2c_gpio *p = &bus->gpio;
+
+	*crc = smbus_crc8(*crc, buf, len);
+	bus->stats.bytes += len;
+	while (len--) {
+		if (i2c_bbang_send_byte(p, *buf++) < 0)
+			return -EIO;
+	}
+
+	return 0;
+}
+
+/**
+ * i2c_custom_smbus_read - receive len bytes, counted in the PEC
+ * @nack: NACK the last byte, it ends the transaction
+ */
+static void i2c_custom_smbus_read(struct i2c_bbang_bus *bus, u8 *buf, u16 len,
+				  bool nack, u8 *crc)
+{
+	struct i2c_gpio *p = &bus->gpio;
+	u16 i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = i2c_bbang_read_byte(p, !(nack && i == len - 1));
+	*crc = smbus_crc8(*crc, buf, len);
+	bus->stats.bytes += len;
+}
+
+/**
+ * i2c_custom_smbus_xfer - low level smbus routine, quick to block data go
+ * straight to the wire with the PEC computed on the fly. The rest
+ * returns -EOPNOTSUPP and the core emulates it on top of i2c_custom_xfer().
+ *
+ * Return: errno
+ */
+static int i2c_custom_smbus_xfer(struct i2c_adapter *adapter, u16 addr,
+				 unsigned short flags, char read_write,
+				 u8 command, int size,
+				 union i2c_smbus_data *data)
+{
+	struct i2c_bbang_bus *bus = to_i2c_bbang_bus(adapter);
+	struct i2c_gpio *p = &bus->gpio;
+	u8 buf[I2C_SMBUS_BLOCK_MAX + 2]; /* command or count, data */
+	bool rd = read_write == I2C_SMBUS_READ;
+	bool pec = (flags & I2C_CLIENT_PEC) && size != I2C_SMBUS_QUICK;
+	u16 wlen = 1, rlen = 0; /* command only */
+	u8 crc = 0, rx;
+	u64 t0;
+	int ret;
+
+	/* 10-bit slaves go through the emulation on i2c_custom_xfer() */
+	if (flags & I2C_CLIENT_TEN)
+		return -EOPNOTSUPP;
+
+	buf[0] = command;
+	switch (size) {
+	case I2C_SMBUS_QUICK:
+		/* the R/W bit is the data */
+		wlen = 0;
+		break;
+	case I2C_SMBUS_BYTE:
+		/* no command, the byte is either sent or received */
+		if (rd) {
+			wlen = 0;
+			rlen = 1;
+		}
+		break;
+	case I2C_SMBUS_BYTE_DATA:
+		if (rd) {
+			rlen = 1;
+		} else {
+			buf[1] = data->byte;
+			wlen = 2;
+		}
+		break;
+	case I2C_SMBUS_WORD_DATA:
+		if (rd) {
+			rlen = 2;
+		} else {
+			buf[1] = data->word & 0xff;
+			buf[2] = data->word >> 8;
+			wlen = 3;
+		}
+		break;
+	case I2C_SMBUS_BLOCK_DATA:
+		if (rd) {
+			rlen = 1; /* the count, the data length follows it */
+		} else {
+			if (data->block[0] == 0 ||
+			    data->block[0] > I2C_SMBUS_BLOCK_MAX)
+				return -EINVAL;
+			memcpy(&buf[1], data->block, data->block[0] + 1);
+			wlen = data->block[0] + 2;
+		}
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	t0 = ktime_get_ns();
+	if ((ret = i2c_bbang_bus_begin(bus)) < 0) {
+		i2c_bbang_bus_end(bus, t0, ret);
+		return ret;
+	}
+	bus->stats.msgs += rd && wlen ? 2 : 1;
+
+	/* write phase, or the whole read when there is no command */
+	if ((ret = i2c_custom_smbus_addr(p, addr, rd && wlen == 0, &crc)) < 0)
+		goto out;
+	if ((ret = i2c_custom_smbus_write(bus, buf, wlen, &crc)) < 0)
+		goto out;
+
+	if (!rd) {
+		if (pec) {
+			rx = crc;
+			ret = i2c_custom_smbus_write(bus, &rx, 1, &crc);
+		}
+		goto out;
+	}
+
+	/* read phase, after a repeated START if a command was sent */
+	if (wlen && (ret = i2c_custom_smbus_addr(p, addr, true, &crc)) < 0)
+		goto out;
+	if (rlen == 0)
+		goto out;
+
+	if (size == I2C_SMBUS_BLOCK_DATA) {
+		i2c_custom_smbus_read(bus, buf, 1, false, &crc);
+		if (buf[0] == 0 || buf[0] > I2C_SMBUS_BLOCK_MAX) {
+			i2c_bbang_read_byte(p, false);
+			ret = -EPROTO;
+			goto out;
+		}
+		i2c_custom_smbus_read(bus, &buf[1], buf[0], !pec, &crc);
+	} else {
+		i2c_custom_smbus_read(bus, buf, rlen, !pec, &crc);
+	}
+
+	if (pec && i2c_bbang_read_byte(p, false) != crc)
+		ret = -EBADMSG;
+
+out:
+	if (p->timing.stretch_expired)
+		ret = -ETIMEDOUT;
+	i2c_bbang_stop(p);
+	i2c_bbang_bus_end(bus, t0, ret);
+	if (ret < 0 || !rd)
+		return ret;
+
+	switch (size) {
+	case I2C_SMBUS_BYTE:
+	case I2C_SMBUS_BYTE_DATA:
+		data->byte = buf[0];
+		break;
+	case I2C_SMBUS_WORD_DATA:
+		data->word = buf[0] | (buf[1] << 8);
+		break;
+	case I2C_SMBUS_BLOCK_DATA:
+		memcpy(data->block, buf, buf[0] + 1);
+		break;
+	}
+	return 0;
+}
+
+/* I2C algorithm structure */
+static const struct i2c_algorithm i2c_custom_algorithm = {
+	.smbus_xfer = i2c_custom_smbus_xfer,
+	.master_xfer = i2c_custom_xfer,
+	.functionality = i2c_custom_func,
+};
+
+const struct i2c_bbang_algo i2c_bbang_custom = {
+	.name = "custom",
+	.algo = &i2c_custom_algorithm,
+};
+
+/*
+ * i2c-algo-bit callbacks, data is the bus
+ */
+static void i2c_bit_setsda(void *data, int state)
+{
+	struct i2c_bbang_bus *bus = data;
+
+	i2c_gpio_write_sda(&bus->gpio, state);
+}
+
+static void i2c_bit_setscl(void *data, int state)
+{
+	struct i2c_bbang_bus *bus = data;
+
+	i2c_gpio_write_scl(&bus->gpio, state);
+}
+
+static int i2c_bit_getsda(void *data)
+{
+	struct i2c_bbang_bus *bus = data;
+
+	return i2c_gpio_read_sda(&bus->gpio);
+}
+
+static int i2c_bit_getscl(void *data)
+{
+	struct i2c_bbang_bus *bus = data;
+
+	return i2c_gpio_read_scl(&bus->gpio);
+}
+
+/**
+ * i2c_bit_xfer - i2c-algo-bit transfer, with the idle check and the
+ * statistic of the custom engine
+ *
+ * Return: number of messages transferred, or errno
+ */
+static int i2c_bit_xfer(struct i2c_adapter *adapter, struct i2c_msg *msgs,
+			int num)
+{
+	struct i2c_bbang_bus *bus = to_i2c_bbang_bus(adapter);
+	u64 t0 = ktime_get_ns();
+	int ret, i;
+
+	if ((ret = i2c_bbang_bus_begin(bus)) < 0) {
+		i2c_bbang_bus_end(bus, t0, ret);
+		return ret;
+	}
+
+	ret = i2c_bit_algo.master_xfer(adapter, msgs, num);
+	/* messages before a failed one went out, but aren't reported */
+	for (i = 0; i < ret; i++) {
+		bus->stats.msgs++;
+		bus->stats.bytes += msgs[i].len;
+	}
+	i2c_bbang_bus_end(bus, t0, ret);
+
+	return ret;
+}
+
+/**
+ * i2c_bit_xfer_atomic - i2c-algo-bit transfer with interrupts disabled,
+ * e.g. to a PMIC at shutdown. Nothing that may sleep runs, so there is
+ * no idle check, recovery or statistic.
+ *
+ * Return: number of messages transferred, or errno
+ */
+static int i2c_bit_xfer_atomic(struct i2c_adapter *adapter,
+			       struct i2c_msg *msgs, int num)
+{
+	if (i2c_bit_algo.master_xfer_atomic == NULL)
+		return -EOPNOTSUPP;
+
+	return i2c_bit_algo.master_xfer_atomic(adapter, msgs, num);
+}
+
+static u32 i2c_bit_func(struct i2c_adapter *adapter)
+{
+	return i2c_bit_algo.functionality(adapter);
+}
+
+/* I2C algorithm structure */
+static const struct i2c_algorithm i2c_bit_algorithm = {
+	.master_xfer = i2c_bit_xfer,
+	.master_xfer_atomic = i2c_bit_xfer_atomic,
+	.functionality = i2c_bit_func,
+};
+
+/**
+ * i2c_bit_setup - algo-bit delays are whole microseconds per half
+ * period: 5 for standard, 2 for fast and 1 for fast-plus mode. Its
+ * stretch timeout is in jiffies. A failed transfer is retried 3 times,
+ * as on an adapter added by i2c_bit_add_bus().
+ */
+static void i2c_bit_setup(struct i2c_bbang_bus *bus)
+{
+	struct i2c_algo_bit_data *bit = &bus->bit;
+	struct i2c_timing *t = &bus->gpio.timing;
+
+	bit->data = bus;
+	bit->setsda = i2c_bit_setsda;
+	bit->setscl = i2c_bit_setscl;
+	bit->getsda = i2c_bit_getsda;
+	bit->getscl = i2c_bit_getscl;
+	bit->udelay = DIV_ROUND_UP(t->half_ns, NSEC_PER_USEC);
+	bit->timeout = usecs_to_jiffies(i2c_timing_stretch_us(t)) ?: 1;
+	bus->adapter.algo_data = bit;
+	bus->adapter.retries = 3;
+}
+
+const struct i2c_bbang_algo i2c_bbang_bit = {
+	.name = "bit",
+	.algo = &i2c_bit_algorithm,
+	.setup = i2c_bit_setup,
+};
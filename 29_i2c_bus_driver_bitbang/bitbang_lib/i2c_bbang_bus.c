@@ -0,0 +1,436 @@
+#include <linux/i2c.h>
+#include <linux/module.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include "i2c_bbang_bus.h"
+#include "i2c_bitbang.h"
+
+/* Private macros */
+#define MOD_NAME "alman-bbang"
+#define MOD_INFO MOD_NAME ": "
+
+#define BENCH_EDGES (100000)
+
+/* Private variables */
+static const struct i2c_bbang_algo *const i2c_bbang_algos[] = {
+	&i2c_bbang_custom,
+	&i2c_bbang_bit,
+};
+
+/* Module parameters */
+static bool selftest;
+module_param(selftest, bool, 0444);
+MODULE_PARM_DESC(selftest, "Run every algorithm against the simulated "
+			   "slave at load time");
+
+static int bit_test;
+module_param(bit_test, int, 0444);
+MODULE_PARM_DESC(bit_test, "Test the lines of a new adapter, as the "
+			   "i2c-algo-bit parameter: 1 warns, 2 refuses a bus "
+			   "that fails");
+
+/**
+ * i2c_bbang_bus_end - account one transfer started at t0, called with
+ * the adapter lock held
+ */
+void i2c_bbang_bus_end(struct i2c_bbang_bus *bus, u64 t0, int ret)
+{
+	bus->stats.xfers++;
+	if (ret < 0)
+		bus->stats.errors++;
+	bus->stats.busy_ns += ktime_get_ns() - t0;
+}
+
+/**
+ * i2c_bbang_recover_bus - bus_recovery_info hook, run the 9-clock
+ * sequence, whatever the algorithm
+ *
+ * Return: errno
+ */
+static int i2c_bbang_recover_bus(struct i2c_adapter *adapter)
+{
+	struct i2c_bbang_bus *bus = to_i2c_bbang_bus(adapter);
+	int ret = i2c_bbang_recover(&bus->gpio);
+
+	bus->stats.recoveries++;
+	if (ret < 0) {
+		bus->stats.recovery_failures++;
+		dev_err(&adapter->dev, "bus recovery failed\n");
+	}
+	bus->gpio.timing.stretch_expired = false;
+	return ret;
+}
+
+/**
+ * i2c_bbang_bus_begin - check the bus is idle before a transfer, a slave
+ * left holding a line by an aborted transfer gets recovered first
+ *
+ * Return: 0, or -EBUSY
+ */
+int i2c_bbang_bus_begin(struct i2c_bbang_bus *bus)
+{
+	struct i2c_gpio *p = &bus->gpio;
+
+	p->timing.stretch_expired = false;
+	if (i2c_gpio_read_scl(p) && i2c_gpio_read_sda(p))
+		return 0;
+
+	return i2c_recover_bus(&bus->adapter);
+}
+
+/*
+ * sysfs, next to the adapter: bus_mode selects the speed, scl_hz is the
+ * SCL frequency achieved since then, measured by the custom engine only
+ */
+static ssize_t bus_mode_show(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	struct i2c_bbang_bus *bus = to_i2c_bbang_bus(to_i2c_adapter(dev));
+
+	return sprintf(buf, "%s\n", i2c_timing_mode(&bus->gpio.timing));
+}
+
+static ssize_t bus_mode_store(struct device *dev,
+			      struct device_attribute *attr, const char *buf,
+			      size_t count)
+{
+	struct i2c_adapter *adapter = to_i2c_adapter(dev);
+	struct i2c_bbang_bus *bus = to_i2c_bbang_bus(adapter);
+	int ret;
+
+	i2c_lock_bus(adapter, I2C_LOCK_ROOT_ADAPTER);
+	ret = i2c_timing_set_mode(&bus->gpio.timing, buf);
+	if (ret == 0 && bus->algo->setup)
+		bus->algo->setup(bus);
+	i2c_unlock_bus(adapter, I2C_LOCK_ROOT_ADAPTER);
+
+	return ret < 0 ? ret : count;
+}
+
+static ssize_t scl_hz_show(struct device *dev, struct device_attribute *attr,
+			   char *buf)
+{
+	struct i2c_adapter *adapter = to_i2c_adapter(dev);
+	struct i2c_bbang_bus *bus = to_i2c_bbang_bus(adapter);
+	u32 hz;
+
+	i2c_lock_bus(adapter, I2C_LOCK_ROOT_ADAPTER);
+	hz = i2c_timing_achieved_hz(&bus->gpio.timing);
+	i2c_unlock_bus(adapter, I2C_LOCK_ROOT_ADAPTER);
+
+	return sprintf(buf, "%u\n", hz);
+}
+
+static DEVICE_ATTR_RW(bus_mode);
+static DEVICE_ATTR_RO(scl_hz);
+
+static struct attribute *i2c_bbang_attrs[] = {
+	&dev_attr_bus_mode.attr,
+	&dev_attr_scl_hz.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(i2c_bbang);
+
+/**
+ * i2c_bbang_bus_add - set up the pins and the algorithm chosen by cfg,
+ * and register the adapter. The lines are held as long as it exists.
+ *
+ * Return: errno
+ */
+int i2c_bbang_bus_add(struct i2c_bbang_bus *bus,
+		      const struct i2c_bbang_cfg *cfg)
+{
+	struct i2c_adapter *adapter = &bus->adapter;
+	struct i2c_gpio *p = &bus->gpio;
+	const char *step;
+	int ret, i;
+
+	bus->algo = NULL;
+	for (i = 0; i < ARRAY_SIZE(i2c_bbang_algos); i++)
+		if (sysfs_streq(cfg->algo, i2c_bbang_algos[i]->name))
+			bus->algo = i2c_bbang_algos[i];
+	if (bus->algo == NULL) {
+		pr_err(MOD_INFO "Unknown algo %s\n", cfg->algo);
+		return -EINVAL;
+	}
+
+	p->timing.paced = cfg->paced;
+	if (i2c_timing_set_mode(&p->timing, cfg->mode) < 0) {
+		pr_err(MOD_INFO "Unknown mode %s\n", cfg->mode);
+		return -EINVAL;
+	}
+
+	ret = i2c_gpio_init(p, cfg->pins, cfg->scl_gpio, cfg->sda_gpio,
+			    cfg->mmio_base);
+	if (ret < 0)
+		return ret;
+
+	/* the pin cost depends on the backend */
+	i2c_bbang_calibrate(p);
+
+	if (bit_test && (ret = i2c_bbang_test_lines(p, &step)) < 0) {
+		pr_warn(MOD_INFO "Line test failed at %s\n", step);
+		if (bit_test >= 2) {
+			i2c_gpio_deinit(p);
+			return ret;
+		}
+	}
+
+	if (bus->algo->setup)
+		bus->algo->setup(bus);
+
+	bus->recovery.recover_bus = i2c_bbang_recover_bus;
+	adapter->algo = bus->algo->algo;
+	adapter->bus_recovery_info = &bus->recovery;
+	adapter->dev.groups = i2c_bbang_groups;
+
+	if ((ret = i2c_add_numbered_adapter(adapter)) < 0) {
+		i2c_gpio_deinit(p);
+		return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * i2c_bbang_bus_del - unregister the adapter and free its lines
+ */
+void i2c_bbang_bus_del(struct i2c_bbang_bus *bus)
+{
+	i2c_del_adapter(&bus->adapter);
+	i2c_gpio_deinit(&bus->gpio);
+}
+
+static int i2c_bbang_stats_show(struct seq_file *m, void *unused)
+{
+	struct i2c_bbang_bus *bus = m->private;
+	struct i2c_timing *t = &bus->gpio.timing;
+	u64 stretches, stretch_ns, stretch_timeouts;
+	struct i2c_bbang_stats st;
+
+	/* a consistent copy, transfers update it under the adapter lock */
+	i2c_lock_bus(&bus->adapter, I2C_LOCK_ROOT_ADAPTER);
+	st = bus->stats;
+	stretches = t->stretches;
+	stretch_ns = t->stretch_ns;
+	stretch_timeouts = t->stretch_timeouts;
+	i2c_unlock_bus(&bus->adapter, I2C_LOCK_ROOT_ADAPTER);
+
+	seq_printf(m, "pins:              %s\n", bus->gpio.ops->name);
+	seq_printf(m, "algo:              %s\n", bus->algo->name);
+	seq_printf(m, "xfers:             %llu\n", st.xfers);
+	seq_printf(m, "msgs:              %llu\n", st.msgs);
+	seq_printf(m, "bytes:             %llu\n", st.bytes);
+	seq_printf(m, "errors:            %llu\n", st.errors);
+	seq_printf(m, "busy ns:           %llu\n", st.busy_ns);
+	seq_printf(m, "bytes/s:           %llu\n", st.busy_ns ?
+		   div64_u64(st.bytes * NSEC_PER_SEC, st.busy_ns) : 0);
+	seq_printf(m, "stretches:         %llu\n", stretches);
+	seq_printf(m, "stretch ns:        %llu\n", stretch_ns);
+	seq_printf(m, "stretch timeouts:  %llu\n", stretch_timeouts);
+	seq_printf(m, "recoveries:        %llu\n", st.recoveries);
+	seq_printf(m, "recovery failures: %llu\n", st.recovery_failures);
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(i2c_bbang_stats);
+
+/*
+ * recover file: any write runs the bus recovery, e.g. to test a slave
+ * wedged on purpose
+ */
+static ssize_t i2c_bbang_recover_write(struct file *filp,
+				       const char __user *buf, size_t len,
+				       loff_t *off)
+{
+	struct i2c_bbang_bus *bus = filp->private_data;
+	int ret;
+
+	i2c_lock_bus(&bus->adapter, I2C_LOCK_ROOT_ADAPTER);
+	ret = i2c_recover_bus(&bus->adapter);
+	i2c_unlock_bus(&bus->adapter, I2C_LOCK_ROOT_ADAPTER);
+
+	return ret < 0 ? ret : len;
+}
+
+static const struct file_operations i2c_bbang_recover_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.write = i2c_bbang_recover_write,
+};
+
+/*
+ * lines file: reading gives the SCL and SDA levels seen through the
+ * backend, "scl 0" or "sda 1" drives or releases a line. A line left
+ * low gets the bus recovered by the next transfer.
+ */
+static int i2c_bbang_lines_show(struct seq_file *m, void *unused)
+{
+	struct i2c_bbang_bus *bus = m->private;
+	bool scl, sda;
+
+	i2c_lock_bus(&bus->adapter, I2C_LOCK_ROOT_ADAPTER);
+	scl = i2c_gpio_read_scl(&bus->gpio);
+	sda = i2c_gpio_read_sda(&bus->gpio);
+	i2c_unlock_bus(&bus->adapter, I2C_LOCK_ROOT_ADAPTER);
+
+	seq_printf(m, "scl %d sda %d\n", scl, sda);
+	return 0;
+}
+
+static int i2c_bbang_lines_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, i2c_bbang_lines_show, inode->i_private);
+}
+
+static ssize_t i2c_bbang_lines_write(struct file *filp,
+				     const char __user *buf, size_t len,
+				     loff_t *off)
+{
+	struct seq_file *m = filp->private_data;
+	struct i2c_bbang_bus *bus = m->private;
+	char kbuf[16], line[4];
+	int state;
+
+	if (len >= sizeof(kbuf))
+		return -EINVAL;
+	if (copy_from_user(kbuf, buf, len))
+		return -EFAULT;
+	kbuf[len] = '\0';
+
+	if (sscanf(kbuf, "%3s %d", line, &state) != 2 ||
+	    (state != 0 && state != 1))
+		return -EINVAL;
+
+	i2c_lock_bus(&bus->adapter, I2C_LOCK_ROOT_ADAPTER);
+	if (strcmp(line, "scl") == 0)
+		i2c_gpio_write_scl(&bus->gpio, state);
+	else if (strcmp(line, "sda") == 0)
+		i2c_gpio_write_sda(&bus->gpio, state);
+	else
+		len = -EINVAL;
+	i2c_unlock_bus(&bus->adapter, I2C_LOCK_ROOT_ADAPTER);
+
+	return len;
+}
+
+static const struct file_operations i2c_bbang_lines_fops = {
+	.owner = THIS_MODULE,
+	.open = i2c_bbang_lines_open,
+	.read = seq_read,
+	.write = i2c_bbang_lines_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/*
+ * bench file: edges/s on SCL through the backend in use, and through
+ * gpiolib as well when MMIO drives the lines. SDA stays released so no
+ * slave sees a START.
+ */
+static int i2c_bbang_bench_show(struct seq_file *m, void *unused)
+{
+	struct i2c_bbang_bus *bus = m->private;
+	struct i2c_gpio *p = &bus->gpio;
+	const struct i2c_pin_ops *ops[2] = { p->ops };
+	u64 ns;
+	int i;
+
+	if (p->ops == &i2c_pins_mmio)
+		ops[1] = &i2c_pins_gpiolib;
+
+	i2c_lock_bus(&bus->adapter, I2C_LOCK_ROOT_ADAPTER);
+	for (i = 0; i < ARRAY_SIZE(ops) && ops[i]; i++) {
+		ns = i2c_gpio_bench(p, ops[i], BENCH_EDGES);
+		seq_printf(m, "%-8s %llu edges/s\n", ops[i]->name,
+			   div64_u64((u64)BENCH_EDGES * NSEC_PER_SEC, ns ?: 1));
+	}
+	i2c_unlock_bus(&bus->adapter, I2C_LOCK_ROOT_ADAPTER);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(i2c_bbang_bench);
+
+/*
+ * selftest file: every algorithm against the simulated slave, in the
+ * mode of this bus. The test uses its own adapters, this one is left
+ * alone.
+ */
+static int i2c_bbang_selftest_show(struct seq_file *m, void *unused)
+{
+	struct i2c_bbang_bus *bus = m->private;
+	const char *mode = i2c_timing_mode(&bus->gpio.timing);
+	struct i2c_bbang_result res;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(i2c_bbang_algos); i++) {
+		i2c_bbang_selftest(i2c_bbang_algos[i]->name, mode, &res);
+		seq_printf(m, "%-6s %s: err %d, %llu bytes/s, scl %u Hz\n",
+			   i2c_bbang_algos[i]->name, mode, res.err,
+			   div64_u64(res.bytes * NSEC_PER_SEC, res.ns ?: 1),
+			   res.scl_hz);
+	}
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(i2c_bbang_selftest);
+
+/**
+ * i2c_bbang_bus_debugfs - stats, recover, lines, bench and selftest files
+ * of the bus in dir, removed by the owner
+ */
+void i2c_bbang_bus_debugfs(struct i2c_bbang_bus *bus, struct dentry *dir)
+{
+	debugfs_create_file("stats", 0444, dir, bus, &i2c_bbang_stats_fops);
+	debugfs_create_file("recover", 0200, dir, bus,
+			    &i2c_bbang_recover_fops);
+	debugfs_create_file("lines", 0600, dir, bus, &i2c_bbang_lines_fops);
+	debugfs_create_file("bench", 0444, dir, bus, &i2c_bbang_bench_fops);
+	debugfs_create_file("selftest", 0444, dir, bus,
+			    &i2c_bbang_selftest_fops);
+}
+
+/* Module init callback */
+static int __init i2c_bbang_init(void)
+{
+	struct i2c_bbang_result res;
+	int i;
+
+	for (i = 0; selftest && i < ARRAY_SIZE(i2c_bbang_algos); i++) {
+		i2c_bbang_selftest(i2c_bbang_algos[i]->name, "standard", &res);
+		pr_info(MOD_INFO "selftest %s: err %d, %llu bytes/s, "
+			"scl %u Hz\n", i2c_bbang_algos[i]->name, res.err,
+			div64_u64(res.bytes * NSEC_PER_SEC, res.ns ?: 1),
+			res.scl_hz);
+		if (res.err < 0)
+			return res.err;
+	}
+
+	pr_info(MOD_INFO "Library added\n");
+	return 0;
+}
+
+/* Module exit callback */
+static void __exit i2c_bbang_exit(void)
+{
+	pr_info(MOD_INFO "Library removed\n");
+}
+
+module_init(i2c_bbang_init);
+module_exit(i2c_bbang_exit);
+
+/* Exported symbols */
+EXPORT_SYMBOL_GPL(i2c_bbang_bus_add);
+EXPORT_SYMBOL_GPL(i2c_bbang_bus_del);
+EXPORT_SYMBOL_GPL(i2c_bbang_bus_debugfs);
+
+/* Module description */
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Pudja Mansyurin");
+MODULE_DESCRIPTION(MOD_NAME);
+MODULE_VERSION("1:5.4");
@@ -0,0 +1,88 @@
+#ifndef __I2C_BBANG_BUS_H__
+#define __I2C_BBANG_BUS_H__
+
+#include <linux/module.h>
+#include <linux/i2c.h>
+#include <linux/i2c-algo-bit.h>
+#include <linux/debugfs.h>
+#include "i2c_gpio.h"
+
+struct i2c_bbang_bus;
+
+/*
+ * Transfer algorithm of a bitbang adapter: "custom" is the engine in
+ * i2c_bitbang.c with native SMBus and PEC, "bit" is the kernel's
+ * i2c-algo-bit on the same pins. setup() runs when the adapter is added
+ * and whenever the bus mode changes.
+ */
+struct i2c_bbang_algo {
+	const char *name;
+	const struct i2c_algorithm *algo;
+	void (*setup)(struct i2c_bbang_bus *bus);
+};
+
+/* i2c_bbang_stats structure */
+struct i2c_bbang_stats {
+	u64 xfers;
+	u64 msgs;
+	u64 bytes; /* data bytes, without addresses */
+	u64 errors;
+	u64 busy_ns; /* time spent in transfers */
+	u64 recoveries;
+	u64 recovery_failures;
+};
+
+/*
+ * One bitbang adapter. The owner fills in adapter.owner, .class, .name
+ * and .nr (-1 for a dynamic number), the library does the rest.
+ */
+struct i2c_bbang_bus {
+	struct i2c_adapter adapter;
+	struct i2c_gpio gpio; /* pins and bit timing */
+	const struct i2c_bbang_algo *algo;
+	struct i2c_algo_bit_data bit; /* algo_data of the "bit" algorithm */
+	struct i2c_bus_recovery_info recovery;
+	struct i2c_bbang_stats stats; /* updated under the adapter lock */
+};
+
+/* i2c_bbang_cfg structure, the load time choices */
+struct i2c_bbang_cfg {
+	const char *pins; /* "gpiolib", "mmio" or "sim" */
+	const char *algo; /* "custom" or "bit" */
+	const char *mode; /* "standard", "fast" or "fast-plus" */
+	bool paced;
+	int scl_gpio;
+	int sda_gpio;
+	phys_addr_t mmio_base;
+};
+
+/* i2c_bbang_result structure, one run of the self-test */
+struct i2c_bbang_result {
+	int err;
+	u64 bytes;
+	u64 ns;
+	u32 scl_hz; /* 0 when the algorithm doesn't measure it */
+};
+
+/* available algorithms */
+extern const struct i2c_bbang_algo i2c_bbang_custom;
+extern const struct i2c_bbang_algo i2c_bbang_bit;
+
+/* library internal */
+static inline struct i2c_bbang_bus *to_i2c_bbang_bus(struct i2c_adapter *a)
+{
+	return container_of(a, struct i2c_bbang_bus, adapter);
+}
+
+int i2c_bbang_bus_begin(struct i2c_bbang_bus *bus);
+void i2c_bbang_bus_end(struct i2c_bbang_bus *bus, u64 t0, int ret);
+void i2c_bbang_selftest(const char *algo, const char *mode,
+			struct i2c_bbang_result *res);
+
+/* exported functions */
+int i2c_bbang_bus_add(struct i2c_bbang_bus *bus,
+		      const struct i2c_bbang_cfg *cfg);
+void i2c_bbang_bus_del(struct i2c_bbang_bus *bus);
+void i2c_bbang_bus_debugfs(struct i2c_bbang_bus *bus, struct dentry *dir);
+
+#endif /* __I2C_BBANG_BUS_H__ */
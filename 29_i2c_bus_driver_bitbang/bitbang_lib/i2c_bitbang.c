@@ -0,0 +1,363 @@
+#include <linux/delay.h>
+#include <linux/math64.h>
+#include "i2c_bitbang.h"
+
+#define I2C_DELAY() i2c_timing_half(&p->timing)
+#define CAL_LOOPS (1024)
+#define STRETCH_SPIN_NS (50 * NSEC_PER_USEC) /* then sleep */
+#define STRETCH_SLEEP_US (50)
+
+/*
+ * i2c_bbang_scl_high - release SCL and wait while a slave stretches it,
+ * at most stretch_timeout_us. Short stretches are spun out; a longer one
+ * sleeps, with preemption back on, as i2c-algo-bit's sclhi() does.
+ *
+ * Return: 0, or -1 when SCL stayed low
+ */
+static int i2c_bbang_scl_high(struct i2c_gpio *p)
+{
+	struct i2c_timing *t = &p->timing;
+	u64 t0, now, limit;
+	bool pinned;
+
+	i2c_gpio_write_scl(p, 1);
+	if (i2c_gpio_read_scl(p))
+		return 0;
+	/* one timeout per transfer, the rest of it is lost anyway */
+	if (t->stretch_expired)
+		return -1;
+
+	t0 = ktime_get_ns();
+	limit = (u64)i2c_timing_stretch_us(t) * NSEC_PER_USEC;
+	do {
+		cpu_relax();
+		now = ktime_get_ns();
+		if (i2c_gpio_read_scl(p))
+			goto released;
+	} while (now - t0 < min_t(u64, limit, STRETCH_SPIN_NS));
+
+	pinned = t->pinned;
+	if (pinned)
+		preempt_enable();
+	while (now - t0 < limit) {
+		usleep_range(STRETCH_SLEEP_US, 2 * STRETCH_SLEEP_US);
+		now = ktime_get_ns();
+		if (i2c_gpio_read_scl(p))
+			break;
+	}
+	if (pinned)
+		preempt_disable();
+	if (now - t0 < limit)
+		goto released;
+
+	t->stretch_timeouts++;
+	t->stretch_expired = true;
+	return -1;
+
+released:
+	t->stretches++;
+	t->stretch_ns += now - t0;
+	/* paced mode: the high half starts now */
+	i2c_timing_sync(t);
+	return 0;
+}
+
+/*
+** i2c_bbang_start - send START condition (bit banging)
+**      ______  
+**            \
+**  SDA        \_____
+**              :
+**              :
+**           ___:____
+**  SCL     /
+**      ___/ 
+*/
+void i2c_bbang_start(struct i2c_gpio *p)
+{
+	/* SDA goes high while SCL is low, so this is a repeated START too */
+	i2c_timing_sync(&p->timing);
+	i2c_gpio_write_sda(p, 1);
+	I2C_DELAY();
+	i2c_bbang_scl_high(p);
+	I2C_DELAY();
+	i2c_gpio_write_sda(p, 0);
+	I2C_DELAY();
+	i2c_gpio_write_scl(p, 0);
+	I2C_DELAY();
+}
+
+/*
+**i2c_bbang_stop - send STOP condition
+**                _____
+**               /
+**  SDA  _______/
+**              :
+**              :
+**            __:______
+**  SCL      /
+**       ___/ 
+*/
+void i2c_bbang_stop(struct i2c_gpio *p)
+{
+	i2c_timing_sync(&p->timing);
+	i2c_gpio_write_sda(p, 0);
+	I2C_DELAY();
+	i2c_bbang_scl_high(p);
+	I2C_DELAY();
+	i2c_gpio_write_sda(p, 1);
+	I2C_DELAY();
+	/* both lines stay high, the bus is idle */
+}
+
+/*
+ * i2c_bbang_read_bit - release SDA and sample it while SCL is high
+ *
+ * Return: bit driven by the slave
+ */
+static bool i2c_bbang_read_bit(struct i2c_gpio *p)
+{
+	bool bit;
+
+	i2c_gpio_write_sda(p, 1); /* release, the slave drives SDA */
+	I2C_DELAY();
+	i2c_bbang_scl_high(p);
+	I2C_DELAY();
+	bit = i2c_gpio_read_sda(p);
+	i2c_gpio_write_scl(p, 0);
+
+	return bit;
+}
+
+/*
+ * i2c_bbang_read_ack - read ACK/NACK status using SDA line
+ *
+ * Return: ACK=0; NACK=-1
+ */
+static int i2c_bbang_read_ack(struct i2c_gpio *p)
+{
+	return i2c_bbang_read_bit(p) ? -1 : 0;
+}
+
+/*
+ * i2c_bbang_send_bit - send 1 bit to slave
+ */
+static void i2c_bbang_send_bit(struct i2c_gpio *p, bool bit)
+{
+	i2c_gpio_write_sda(p, bit);
+	I2C_DELAY();
+	i2c_bbang_scl_high(p);
+	I2C_DELAY();
+	i2c_gpio_write_scl(p, 0);
+}
+
+/*
+ * i2c_bbang_send_addr - send 7-bit address to slave
+ * @addr: address of the slave
+ * @read: read or write operation
+ *
+ * Return: errno
+ */
+int i2c_bbang_send_addr(struct i2c_gpio *p, u8 addr, bool is_read)
+{
+	/* the address 7bit, then the r/w (8th bit) */
+	return i2c_bbang_send_byte(p, (addr << 1) | is_read);
+}
+
+/*
+ * i2c_bbang_send_byte - send a byte to slave
+ *
+ * Return: errno
+ */
+int i2c_bbang_send_byte(struct i2c_gpio *p, u8 payload)
+{
+	int i, ret;
+	u8 bit;
+
+	i2c_timing_byte_begin(&p->timing);
+
+	/* send payload */
+	for (i=7; i>=0; --i) {
+		bit = (payload >> i) & 0x01;
+		i2c_bbang_send_bit(p, bit);
+	}
+	ret = i2c_bbang_read_ack(p);
+
+	i2c_timing_byte_end(&p->timing);
+	return ret;
+}
+
+/*
+ * i2c_bbang_read_byte - receive a byte from slave
+ * @ack: ACK to ask for more, NACK on the last byte of a read
+ *
+ * Return: received byte
+ */
+u8 i2c_bbang_read_byte(struct i2c_gpio *p, bool ack)
+{
+	u8 byte = 0;
+	int i;
+
+	i2c_timing_byte_begin(&p->timing);
+
+	/* receive MSB first */
+	for (i=7; i>=0; --i)
+		byte |= i2c_bbang_read_bit(p) << i;
+
+	/* ACK is SDA low */
+	i2c_bbang_send_bit(p, !ack);
+
+	i2c_timing_byte_end(&p->timing);
+	return byte;
+}
+
+/*
+ * i2c_bbang_calibrate - measure one pin write, so the delays only add
+ * what the GPIO controller doesn't already take. SCL is pulsed with SDA
+ * released, which no slave takes as a START or STOP.
+ */
+void i2c_bbang_calibrate(struct i2c_gpio *p)
+{
+	u64 t0;
+	int i;
+
+	i2c_gpio_write_sda(p, 1);
+
+	if (p->timing.atomic)
+		preempt_disable();
+	t0 = ktime_get_ns();
+	for (i = 0; i < CAL_LOOPS; i++) {
+		i2c_gpio_write_scl(p, 0);
+		i2c_gpio_write_scl(p, 1);
+	}
+	t0 = ktime_get_ns() - t0;
+	if (p->timing.atomic)
+		preempt_enable();
+
+	i2c_timing_set_pin_ns(&p->timing, div_u64(t0, 2 * CAL_LOOPS));
+}
+
+/*
+ * i2c_bbang_recover - free a slave that holds SDA low after an aborted
+ * transfer: clock SCL up to 9 times until it lets go, then send a STOP
+ *
+ * Return: errno
+ */
+int i2c_bbang_recover(struct i2c_gpio *p)
+{
+	int i;
+
+	i2c_timing_sync(&p->timing);
+	i2c_gpio_write_sda(p, 1);
+	if (i2c_bbang_scl_high(p) < 0)
+		return -EBUSY; /* SCL is held, clocks can't help */
+
+	for (i = 0; i < 9 && !i2c_gpio_read_sda(p); i++) {
+		I2C_DELAY();
+		i2c_gpio_write_scl(p, 0);
+		I2C_DELAY();
+		if (i2c_bbang_scl_high(p) < 0)
+			return -EBUSY;
+	}
+	if (!i2c_gpio_read_sda(p))
+		return -EBUSY;
+
+	/* STOP resets the slave state machines */
+	I2C_DELAY();
+	i2c_gpio_write_scl(p, 0);
+	I2C_DELAY();
+	i2c_bbang_stop(p);
+
+	return i2c_gpio_read_sda(p) && i2c_gpio_read_scl(p) ? 0 : -EBUSY;
+}
+
+/*
+ * i2c_bbang_test_lines - the line test of i2c-algo-bit's bit_test: both
+ * lines idle high, and each one goes low alone when driven
+ * @step: set to the step that failed
+ *
+ * Return: 0, or -ENODEV
+ */
+int i2c_bbang_test_lines(struct i2c_gpio *p, const char **step)
+{
+	static const struct {
+		const char *name;
+		bool scl; /* written, then expected on the wire */
+		bool sda;
+	} steps[] = {
+		{ "idle", 1, 1 },
+		{ "SDA low", 1, 0 },
+		{ "SDA high", 1, 1 },
+		{ "SCL low", 0, 1 },
+		{ "SCL high", 1, 1 },
+	};
+	int i;
+
+	i2c_timing_sync(&p->timing);
+	for (i = 0; i < ARRAY_SIZE(steps); i++) {
+		i2c_gpio_write_sda(p, steps[i].sda);
+		i2c_gpio_write_scl(p, steps[i].scl);
+		I2C_DELAY();
+		if (i2c_gpio_read_scl(p) != steps[i].scl ||
+		    i2c_gpio_read_sda(p) != steps[i].sda) {
+			*step = steps[i].name;
+			i2c_gpio_write_scl(p, 1);
+			i2c_gpio_write_sda(p, 1);
+			return -ENODEV;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * i2c_bbang_send_addr10 - send 10-bit address to slave, a read goes on
+ * with a repeated START and the first address byte again
+ * @addr: address of the slave
+ * @read: read or write operation
+ *
+ * Return: errno
+ */
+int i2c_bbang_send_addr10(struct i2c_gpio *p, u16 addr, bool is_read)
+{
+	u8 hi = 0x78 | ((addr >> 8) & 0x03); /* 11110 A9 A8 */
+
+	if (i2c_bbang_send_addr(p, hi, false) < 0)
+		return -1;
+	if (i2c_bbang_send_byte(p, addr & 0xff) < 0)
+		return -1;
+	if (!is_read)
+		return 0;
+
+	i2c_bbang_start(p);
+	return i2c_bbang_send_addr(p, hi, true);
+}
+
+/*
+ * i2c_bbang_send - send nr bytes to slave
+ *
+ * Return: number of bytes ACKed
+ */
+int i2c_bbang_send(struct i2c_gpio *p, const u8 *buf, u16 len)
+{
+	int i;
+
+	for (i = 0; i < len; i++) {
+		if (i2c_bbang_send_byte(p, buf[i]) < 0)
+			break;
+	}
+
+	return i;
+}
+
+/*
+ * i2c_bbang_recv - receive nr bytes from slave, every byte is ACKed but
+ * the last one, which ends the read
+ */
+void i2c_bbang_recv(struct i2c_gpio *p, u8 *buf, u16 len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = i2c_bbang_read_byte(p, i < len - 1);
+}
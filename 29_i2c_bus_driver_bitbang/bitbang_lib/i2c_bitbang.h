@@ -0,0 +1,21 @@
+#ifndef __I2C_BITBANG_H__
+#define __I2C_BITBANG_H__
+
+#include <linux/module.h>
+#include "i2c_gpio.h"
+
+/* exported functions */
+void i2c_bbang_start(struct i2c_gpio *p);
+void i2c_bbang_stop(struct i2c_gpio *p);
+int i2c_bbang_send_addr(struct i2c_gpio *p, u8 addr, bool is_read);
+int i2c_bbang_send_addr10(struct i2c_gpio *p, u16 addr, bool is_read);
+int i2c_bbang_send_byte(struct i2c_gpio *p, u8 payload);
+u8 i2c_bbang_read_byte(struct i2c_gpio *p, bool ack);
+int i2c_bbang_send(struct i2c_gpio *p, const u8 *buf, u16 len);
+void i2c_bbang_recv(struct i2c_gpio *p, u8 *buf, u16 len);
+void i2c_bbang_calibrate(struct i2c_gpio *p);
+int i2c_bbang_recover(struct i2c_gpio *p);
+int i2c_bbang_test_lines(struct i2c_gpio *p, const char **step);
+
+#endif /* __I2C_BITBANG_H__ */
+
@@ -0,0 +1,327 @@
+#include <linux/module.h>
+#include <linux/gpio.h>
+#include <linux/gpio/consumer.h>
+#include <linux/slab.h>
+#include <linux/io.h>
+#include <linux/ktime.h>
+#include <linux/string.h>
+#include "i2c_gpio.h"
+
+/* BCM2835 GPIO block, the layout of every Raspberry Pi */
+#define BCM_GPFSEL(pin) (((pin) / 10) * 4)
+#define BCM_FSEL_SHIFT(pin) (((pin) % 10) * 3)
+#define BCM_FSEL_MASK (0x7)
+#define BCM_FSEL_OUT (0x1)
+#define BCM_GPCLR0 (0x28)
+#define BCM_GPLEV0 (0x34)
+#define BCM_SIZE (0xb4)
+#define BCM_PINS (32) /* bank 0 only */
+
+/**
+ * i2c_pin_init - initialize i2c pin, driven high
+ *
+ * Return: errno
+ */
+static int i2c_pin_init(const char *name, int pin)
+{
+	char gpio_name[10];
+
+	if (gpio_is_valid(pin) == false) {
+		pr_err("%s GPIO %d is not valid\n", name, pin);
+		return -1;
+	}
+	
+	snprintf(gpio_name, sizeof(gpio_name), "%s_GPIO", name);
+	if (gpio_request(pin, gpio_name) < 0) {
+		pr_err("%s GPIO %d request failed\n", name, pin);
+		return -1;
+	}
+
+	gpio_direction_output(pin, 1);
+
+	return 0;
+}
+
+
+/**
+ * i2c_gpio_od - drive an open-drain line low or release it through
+ * gpiolib, the direction only changes when the level does
+ * @low: current state of the line, updated
+ */
+static void i2c_gpio_od(struct gpio_desc *desc, bool *low, int state)
+{
+	if (!state == *low)
+		return;
+
+	if (state)
+		gpiod_direction_input(desc);
+	else
+		gpiod_direction_output(desc, 0);
+	*low = !state;
+}
+
+/**
+ * i2c_gpiolib_init - request both lines, released. They are only ever
+ * driven low, a high level is left to the pull-up, so a slave can
+ * stretch SCL and we can read it back.
+ *
+ * Return: errno
+ */
+static int i2c_gpiolib_init(struct i2c_gpio *p, int scl_pin, int sda_pin,
+			    phys_addr_t base)
+{
+	int ret = 0;
+
+	do {
+		if ((ret = i2c_pin_init("SCL", scl_pin)) < 0)
+			break;
+
+		if ((ret = i2c_pin_init("SDA", sda_pin)) < 0) {
+			gpio_free(scl_pin);
+			break;
+		}
+		
+		p->scl = scl_pin;
+		p->sda = sda_pin;
+		p->scl_desc = gpio_to_desc(scl_pin);
+		p->sda_desc = gpio_to_desc(sda_pin);
+
+		/* release both, the bus idles high */
+		gpiod_direction_input(p->scl_desc);
+		gpiod_direction_input(p->sda_desc);
+		p->scl_low = false;
+		p->sda_low = false;
+
+	} while(false);
+
+	return ret;
+}
+
+/**
+ * i2c_gpiolib_exit - release and free both lines
+ */
+static void i2c_gpiolib_exit(struct i2c_gpio *p)
+{
+	gpiod_direction_input(p->scl_desc);
+	gpiod_direction_input(p->sda_desc);
+	gpio_free(p->scl);
+	gpio_free(p->sda);
+}
+
+static bool i2c_gpiolib_get_scl(struct i2c_gpio *p)
+{
+	return gpiod_get_value_cansleep(p->scl_desc);
+}
+
+static bool i2c_gpiolib_get_sda(struct i2c_gpio *p)
+{
+	return gpiod_get_value_cansleep(p->sda_desc);
+}
+
+static void i2c_gpiolib_set_scl(struct i2c_gpio *p, int state)
+{
+	i2c_gpio_od(p->scl_desc, &p->scl_low, state);
+}
+
+static void i2c_gpiolib_set_sda(struct i2c_gpio *p, int state)
+{
+	i2c_gpio_od(p->sda_desc, &p->sda_low, state);
+}
+
+const struct i2c_pin_ops i2c_pins_gpiolib = {
+	.name = "gpiolib",
+	.init = i2c_gpiolib_init,
+	.exit = i2c_gpiolib_exit,
+	.get_scl = i2c_gpiolib_get_scl,
+	.get_sda = i2c_gpiolib_get_sda,
+	.set_scl = i2c_gpiolib_set_scl,
+	.set_sda = i2c_gpiolib_set_sda,
+};
+
+/**
+ * i2c_mmio_map - map the GPIO block at base for two lines held through
+ * gpiolib: they are then driven through its function select registers
+ * and read from its level register. Other users of the pins sharing
+ * those function select registers must not reconfigure them while the
+ * adapter is loaded.
+ *
+ * Return: errno
+ */
+static int i2c_mmio_map(struct i2c_gpio *p, phys_addr_t base)
+{
+	void __iomem *mmio;
+	u32 lev;
+
+	if (p->scl >= BCM_PINS || p->sda >= BCM_PINS)
+		return -EINVAL;
+
+	if ((mmio = ioremap(base, BCM_SIZE)) == NULL)
+		return -ENOMEM;
+
+	/* both lines are released, the block must read what gpiolib reads */
+	lev = readl(mmio + BCM_GPLEV0);
+	if (!!(lev & BIT(p->scl)) != gpiod_get_value_cansleep(p->scl_desc) ||
+	    !!(lev & BIT(p->sda)) != gpiod_get_value_cansleep(p->sda_desc)) {
+		iounmap(mmio);
+		return -ENODEV;
+	}
+
+	/* a line is driven low by making it an output, its latch stays 0 */
+	writel(BIT(p->scl) | BIT(p->sda), mmio + BCM_GPCLR0);
+
+	p->scl_fsel = mmio + BCM_GPFSEL(p->scl);
+	p->sda_fsel = mmio + BCM_GPFSEL(p->sda);
+	p->scl_shift = BCM_FSEL_SHIFT(p->scl);
+	p->sda_shift = BCM_FSEL_SHIFT(p->sda);
+	p->mmio = mmio;
+
+	return 0;
+}
+
+/**
+ * i2c_mmio_init - gpiolib holds the lines, the fast path drives them.
+ * Without a usable GPIO block at base, gpiolib drives them too.
+ *
+ * Return: errno
+ */
+static int i2c_mmio_init(struct i2c_gpio *p, int scl_pin, int sda_pin,
+			 phys_addr_t base)
+{
+	int ret;
+
+	if ((ret = i2c_gpiolib_init(p, scl_pin, sda_pin, base)) < 0)
+		return ret;
+
+	if (base == 0)
+		ret = -EINVAL;
+	else
+		ret = i2c_mmio_map(p, base);
+	if (ret < 0) {
+		pr_warn("No MMIO at %pa (%d), using gpiolib\n", &base, ret);
+		p->ops = &i2c_pins_gpiolib;
+	}
+
+	return 0;
+}
+
+static void i2c_mmio_exit(struct i2c_gpio *p)
+{
+	iounmap(p->mmio);
+	p->mmio = NULL;
+	i2c_gpiolib_exit(p);
+}
+
+static bool i2c_mmio_get_scl(struct i2c_gpio *p)
+{
+	return readl(p->mmio + BCM_GPLEV0) & BIT(p->scl);
+}
+
+static bool i2c_mmio_get_sda(struct i2c_gpio *p)
+{
+	return readl(p->mmio + BCM_GPLEV0) & BIT(p->sda);
+}
+
+/**
+ * i2c_mmio_od - one read-modify-write of a function select register,
+ * input releases the line, output drives its latched low
+ * @low: current state of the line, updated
+ */
+static void i2c_mmio_od(void __iomem *fsel, u8 shift, bool *low, int state)
+{
+	u32 val;
+
+	if (!state == *low)
+		return;
+
+	val = readl(fsel) & ~(BCM_FSEL_MASK << shift);
+	if (!state)
+		val |= BCM_FSEL_OUT << shift;
+	writel(val, fsel);
+	*low = !state;
+}
+
+static void i2c_mmio_set_scl(struct i2c_gpio *p, int state)
+{
+	i2c_mmio_od(p->scl_fsel, p->scl_shift, &p->scl_low, state);
+}
+
+static void i2c_mmio_set_sda(struct i2c_gpio *p, int state)
+{
+	i2c_mmio_od(p->sda_fsel, p->sda_shift, &p->sda_low, state);
+}
+
+const struct i2c_pin_ops i2c_pins_mmio = {
+	.name = "mmio",
+	.atomic = true,
+	.init = i2c_mmio_init,
+	.exit = i2c_mmio_exit,
+	.get_scl = i2c_mmio_get_scl,
+	.get_sda = i2c_mmio_get_sda,
+	.set_scl = i2c_mmio_set_scl,
+	.set_sda = i2c_mmio_set_sda,
+};
+
+/**
+ * i2c_gpio_init - set up the lines of one bus with the backend named
+ * pins: "gpiolib", "mmio" (a BCM2835 compatible GPIO block at base) or
+ * "sim" (a simulated wire with a slave on it), called once when the
+ * adapter is registered
+ *
+ * Return: errno
+ */
+int i2c_gpio_init(struct i2c_gpio *p, const char *pins, int scl_pin,
+		  int sda_pin, phys_addr_t base)
+{
+	static const struct i2c_pin_ops *const backends[] = {
+		&i2c_pins_gpiolib, &i2c_pins_mmio, &i2c_pins_sim,
+	};
+	int ret, i;
+
+	for (i = 0; i < ARRAY_SIZE(backends); i++) {
+		if (sysfs_streq(pins, backends[i]->name)) {
+			p->ops = backends[i];
+			ret = p->ops->init(p, scl_pin, sda_pin, base);
+			/* init may have fallen back to another backend */
+			p->timing.atomic = p->ops->atomic;
+			return ret;
+		}
+	}
+
+	pr_err("Unknown pins %s\n", pins);
+	return -EINVAL;
+}
+
+/**
+ * i2c_gpio_deinit - deinitilize gpio for i2c
+ */
+void i2c_gpio_deinit(struct i2c_gpio *p)
+{
+	p->ops->exit(p);
+}
+
+/**
+ * i2c_gpio_bench - time edges on SCL with SDA released, through ops
+ * instead of the backend in use, called with the adapter lock held.
+ * Both MMIO and gpiolib reach the lines held by the mmio backend.
+ *
+ * Return: elapsed ns
+ */
+u64 i2c_gpio_bench(struct i2c_gpio *p, const struct i2c_pin_ops *ops,
+		   int edges)
+{
+	const struct i2c_pin_ops *saved = p->ops;
+	u64 t0;
+	int i;
+
+	p->ops = ops;
+	i2c_gpio_write_sda(p, 1);
+
+	t0 = ktime_get_ns();
+	for (i = 0; i < edges; i++)
+		i2c_gpio_write_scl(p, i & 1);
+	i2c_gpio_write_scl(p, 1);
+	t0 = ktime_get_ns() - t0;
+
+	p->ops = saved;
+	return t0;
+}
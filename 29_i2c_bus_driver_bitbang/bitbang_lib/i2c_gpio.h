@@ -0,0 +1,86 @@
+#ifndef ___I2C_GPIO_H__
+#define ___I2C_GPIO_H__
+
+#include <linux/module.h>
+#include "i2c_timing.h"
+
+struct gpio_desc;
+struct i2c_gpio;
+struct i2c_sim;
+
+/*
+ * Pin backend. Both lines are open-drain: set_*() with 0 drives the line
+ * low, with 1 releases it to the pull-up, and get_*() reads the level of
+ * the wire, i.e. the wired-AND of every device on the bus. init() may
+ * install another backend, e.g. mmio falls back to gpiolib. An atomic
+ * backend never sleeps, so it can be driven with preemption disabled.
+ */
+struct i2c_pin_ops {
+	const char *name;
+	bool atomic;
+	int (*init)(struct i2c_gpio *p, int scl_pin, int sda_pin,
+		    phys_addr_t base);
+	void (*exit)(struct i2c_gpio *p);
+	bool (*get_scl)(struct i2c_gpio *p);
+	bool (*get_sda)(struct i2c_gpio *p);
+	void (*set_scl)(struct i2c_gpio *p, int state);
+	void (*set_sda)(struct i2c_gpio *p, int state);
+};
+
+/* i2c_gpio structure */
+struct i2c_gpio {
+	const struct i2c_pin_ops *ops;
+	unsigned int scl;
+   	unsigned int sda;
+	struct gpio_desc *scl_desc;
+	struct gpio_desc *sda_desc;
+	bool scl_low; /* driven low, otherwise released (input) */
+	bool sda_low;
+	/* MMIO fast path */
+	void __iomem *mmio;
+	void __iomem *scl_fsel; /* function select register of the pin */
+	void __iomem *sda_fsel;
+	u8 scl_shift;
+	u8 sda_shift;
+	struct i2c_sim *sim; /* simulated wire and slave */
+	struct i2c_timing timing; /* bit timing used by the bitbang engine */
+};
+
+/* available backends */
+extern const struct i2c_pin_ops i2c_pins_gpiolib;
+extern const struct i2c_pin_ops i2c_pins_mmio;
+extern const struct i2c_pin_ops i2c_pins_sim;
+
+/*
+ * Pin access of the bitbang engine and algo-bit, one indirect call per
+ * edge or sample. That is noise next to a gpiolib call, and a few ns
+ * next to the half period of fast-plus mode with MMIO.
+ */
+static inline bool i2c_gpio_read_scl(struct i2c_gpio *p)
+{
+	return p->ops->get_scl(p);
+}
+
+static inline bool i2c_gpio_read_sda(struct i2c_gpio *p)
+{
+	return p->ops->get_sda(p);
+}
+
+static inline void i2c_gpio_write_scl(struct i2c_gpio *p, int state)
+{
+	p->ops->set_scl(p, state);
+}
+
+static inline void i2c_gpio_write_sda(struct i2c_gpio *p, int state)
+{
+	p->ops->set_sda(p, state);
+}
+
+/* exported functions */
+int i2c_gpio_init(struct i2c_gpio *p, const char *pins, int scl_pin,
+		  int sda_pin, phys_addr_t base);
+void i2c_gpio_deinit(struct i2c_gpio *p);
+u64 i2c_gpio_bench(struct i2c_gpio *p, const struct i2c_pin_ops *ops,
+		   int edges);
+
+#endif /* __I2C_GPIO_H__ */
@@ -0,0 +1,121 @@
+#include <linux/i2c.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include "i2c_bbang_bus.h"
+#include "i2c_sim.h"
+
+/* Private macros */
+#define SELFTEST_LEN (128)
+#define SELFTEST_ROUNDS (4)
+
+/* Private types */
+struct i2c_selftest {
+	struct i2c_bbang_bus bus;
+	u8 wbuf[1 + SELFTEST_LEN]; /* word address, data */
+	u8 rbuf[SELFTEST_LEN];
+};
+
+/**
+ * i2c_selftest_round - write a pattern to the simulated EEPROM, read it
+ * back with a repeated START and compare, timed
+ *
+ * Return: errno
+ */
+static int i2c_selftest_round(struct i2c_selftest *st, int round,
+			      struct i2c_bbang_result *res)
+{
+	struct i2c_adapter *adapter = &st->bus.adapter;
+	struct i2c_msg msgs[2] = {
+		{ .addr = I2C_SIM_ADDR, .len = 1, .buf = st->wbuf },
+		{ .addr = I2C_SIM_ADDR, .flags = I2C_M_RD,
+		  .len = SELFTEST_LEN, .buf = st->rbuf },
+	};
+	u64 t0;
+	int i;
+
+	st->wbuf[0] = 0;
+	for (i = 0; i < SELFTEST_LEN; i++)
+		st->wbuf[1 + i] = i * 7 + round * 31 + 1;
+	memset(st->rbuf, 0, sizeof(st->rbuf));
+
+	t0 = ktime_get_ns();
+	msgs[0].len = sizeof(st->wbuf);
+	if (i2c_transfer(adapter, msgs, 1) != 1)
+		return -EIO;
+	msgs[0].len = 1;
+	if (i2c_transfer(adapter, msgs, 2) != 2)
+		return -EIO;
+	res->ns += ktime_get_ns() - t0;
+	res->bytes += 2 * SELFTEST_LEN;
+
+	return memcmp(st->rbuf, &st->wbuf[1], SELFTEST_LEN) ? -EIO : 0;
+}
+
+/**
+ * i2c_selftest_run - the rounds, then an address nobody ACKs and an
+ * SMBus word read, native or emulated by the core
+ *
+ * Return: errno
+ */
+static int i2c_selftest_run(struct i2c_selftest *st,
+			    struct i2c_bbang_result *res)
+{
+	struct i2c_adapter *adapter = &st->bus.adapter;
+	struct i2c_msg probe = { .addr = I2C_SIM_ADDR + 1 };
+	union i2c_smbus_data data;
+	int ret, i;
+
+	for (i = 0; i < SELFTEST_ROUNDS; i++)
+		if ((ret = i2c_selftest_round(st, i, res)) < 0)
+			return ret;
+
+	if (i2c_transfer(adapter, &probe, 1) != -ENXIO)
+		return -EIO;
+
+	ret = i2c_smbus_xfer(adapter, I2C_SIM_ADDR, 0, I2C_SMBUS_READ, 0,
+			     I2C_SMBUS_WORD_DATA, &data);
+	if (ret < 0)
+		return ret;
+	if (data.word != (st->wbuf[1] | (st->wbuf[2] << 8)))
+		return -EIO;
+
+	return 0;
+}
+
+/**
+ * i2c_bbang_selftest - run algo on the simulated pins in mode, on an
+ * adapter of its own, and report the data throughput of the rounds.
+ * Both algorithms see the same slave, wire and bit timing, so their
+ * results compare the algorithms alone.
+ */
+void i2c_bbang_selftest(const char *algo, const char *mode,
+			struct i2c_bbang_result *res)
+{
+	struct i2c_bbang_cfg cfg = {
+		.pins = "sim",
+		.algo = algo,
+		.mode = mode,
+	};
+	struct i2c_selftest *st;
+
+	memset(res, 0, sizeof(*res));
+	if ((st = kzalloc(sizeof(*st), GFP_KERNEL)) == NULL) {
+		res->err = -ENOMEM;
+		return;
+	}
+
+	st->bus.adapter.owner = THIS_MODULE;
+	st->bus.adapter.nr = -1;
+	snprintf(st->bus.adapter.name, sizeof(st->bus.adapter.name),
+		 "alman-bbang selftest %s", algo);
+
+	if ((res->err = i2c_bbang_bus_add(&st->bus, &cfg)) == 0) {
+		res->err = i2c_selftest_run(st, res);
+		if (st->bus.algo == &i2c_bbang_custom)
+			res->scl_hz =
+				i2c_timing_achieved_hz(&st->bus.gpio.timing);
+		i2c_bbang_bus_del(&st->bus);
+	}
+
+	kfree(st);
+}
@@ -0,0 +1,209 @@
+#include <linux/slab.h>
+#include <linux/string.h>
+#include "i2c_gpio.h"
+#include "i2c_sim.h"
+
+/* Private types */
+enum {
+	SIM_IDLE, /* not addressed, until the next START */
+	SIM_ADDR, /* receiving the address */
+	SIM_RX, /* receiving data */
+	SIM_TX, /* sending data */
+};
+
+/**
+ * i2c_sim_byte - a byte was received, ACK it unless it is somebody
+ * else's address
+ */
+static void i2c_sim_byte(struct i2c_sim *s)
+{
+	if (s->state == SIM_ADDR) {
+		if ((s->shift >> 1) != I2C_SIM_ADDR) {
+			s->state = SIM_IDLE;
+			return;
+		}
+		s->read = s->shift & 1;
+		s->ptr_set = false;
+	} else if (!s->ptr_set) {
+		s->ptr = s->shift;
+		s->ptr_set = true;
+		s->bytes++;
+	} else {
+		s->mem[s->ptr++] = s->shift;
+		s->bytes++;
+	}
+
+	s->ack = true;
+	s->sda_low = true;
+}
+
+/**
+ * i2c_sim_load - put the MSB of the next byte to send on SDA
+ */
+static void i2c_sim_load(struct i2c_sim *s)
+{
+	s->shift = s->mem[s->ptr++];
+	s->bits = 0;
+	s->sda_low = !(s->shift & 0x80);
+	s->bytes++;
+}
+
+/**
+ * i2c_sim_rise - SCL went high, sample SDA
+ */
+static void i2c_sim_rise(struct i2c_sim *s)
+{
+	switch (s->state) {
+	case SIM_ADDR:
+	case SIM_RX:
+		if (s->ack)
+			break; /* our own ACK */
+		s->shift = (s->shift << 1) | s->sda;
+		s->bits++;
+		break;
+	case SIM_TX:
+		if (s->ack)
+			s->nack = s->sda;
+		break;
+	}
+}
+
+/**
+ * i2c_sim_fall - SCL went low, SDA may change for the next bit
+ */
+static void i2c_sim_fall(struct i2c_sim *s)
+{
+	switch (s->state) {
+	case SIM_ADDR:
+	case SIM_RX:
+		if (s->ack) {
+			/* our ACK was clocked */
+			s->ack = false;
+			s->sda_low = false;
+			s->bits = 0;
+			s->shift = 0;
+			if (s->state == SIM_ADDR)
+				s->state = s->read ? SIM_TX : SIM_RX;
+			if (s->state == SIM_TX)
+				i2c_sim_load(s);
+		} else if (s->bits == 8) {
+			i2c_sim_byte(s);
+		}
+		break;
+	case SIM_TX:
+		if (s->ack) {
+			/* the master's ACK was clocked */
+			s->ack = false;
+			if (s->nack) {
+				s->state = SIM_IDLE;
+				s->sda_low = false;
+			} else {
+				i2c_sim_load(s);
+			}
+		} else if (++s->bits == 8) {
+			/* release SDA for the master's ACK */
+			s->sda_low = false;
+			s->ack = true;
+		} else {
+			s->sda_low = !(s->shift & (0x80 >> s->bits));
+		}
+		break;
+	}
+}
+
+/**
+ * i2c_sim_update - a line changed, let the slave see the new levels
+ */
+static void i2c_sim_update(struct i2c_gpio *p)
+{
+	struct i2c_sim *s = p->sim;
+	bool scl = !p->scl_low;
+	bool sda = !p->sda_low && !s->sda_low;
+
+	s->edges++;
+	if (scl && s->scl && sda != s->sda) {
+		/* SDA moved while SCL is high: START when it fell, or STOP */
+		s->state = sda ? SIM_IDLE : SIM_ADDR;
+		s->starts += !sda;
+		s->sda_low = false;
+		s->ack = false;
+		s->bits = 0;
+		s->shift = 0;
+	} else if (scl != s->scl) {
+		s->scl = scl;
+		s->sda = sda;
+		if (scl)
+			i2c_sim_rise(s);
+		else
+			i2c_sim_fall(s);
+	}
+
+	/* the slave may have driven or released SDA */
+	s->sda = !p->sda_low && !s->sda_low;
+}
+
+/**
+ * i2c_sim_init - both lines released, the EEPROM erased
+ *
+ * Return: errno
+ */
+static int i2c_sim_init(struct i2c_gpio *p, int scl_pin, int sda_pin,
+			phys_addr_t base)
+{
+	struct i2c_sim *s = kzalloc(sizeof(*s), GFP_KERNEL);
+
+	if (s == NULL)
+		return -ENOMEM;
+
+	s->scl = true;
+	s->sda = true;
+	memset(s->mem, 0xff, sizeof(s->mem));
+	p->scl_low = false;
+	p->sda_low = false;
+	p->sim = s;
+
+	return 0;
+}
+
+static void i2c_sim_exit(struct i2c_gpio *p)
+{
+	kfree(p->sim);
+	p->sim = NULL;
+}
+
+static bool i2c_sim_get_scl(struct i2c_gpio *p)
+{
+	return p->sim->scl;
+}
+
+static bool i2c_sim_get_sda(struct i2c_gpio *p)
+{
+	return p->sim->sda;
+}
+
+static void i2c_sim_set_scl(struct i2c_gpio *p, int state)
+{
+	if (!state == p->scl_low)
+		return;
+	p->scl_low = !state;
+	i2c_sim_update(p);
+}
+
+static void i2c_sim_set_sda(struct i2c_gpio *p, int state)
+{
+	if (!state == p->sda_low)
+		return;
+	p->sda_low = !state;
+	i2c_sim_update(p);
+}
+
+const struct i2c_pin_ops i2c_pins_sim = {
+	.name = "sim",
+	.atomic = true,
+	.init = i2c_sim_init,
+	.exit = i2c_sim_exit,
+	.get_scl = i2c_sim_get_scl,
+	.get_sda = i2c_sim_get_sda,
+	.set_scl = i2c_sim_set_scl,
+	.set_sda = i2c_sim_set_sda,
+};
@@ -0,0 +1,40 @@
+#ifndef __I2C_SIM_H__
+#define __I2C_SIM_H__
+
+#include <linux/module.h>
+
+#define I2C_SIM_ADDR (0x50)
+#define I2C_SIM_SIZE (256)
+
+/*
+ * Simulated wire for the "sim" pins, with one slave on it: a 256 byte
+ * EEPROM at I2C_SIM_ADDR. A write sets the word address with its first
+ * byte and stores the rest from there, a read goes on from the word
+ * address, both wrap around. The slave reacts to every edge the master
+ * makes, right inside the pin write, so it keeps up at any speed and
+ * what the master reads back is what the wire carried.
+ */
+struct i2c_sim {
+	/* levels on the wire */
+	bool scl;
+	bool sda;
+
+	/* slave */
+	u8 state;
+	bool sda_low; /* driven by the slave */
+	bool ack; /* in the ACK bit of the current byte */
+	bool read;
+	bool nack; /* the master NACKed the last byte read */
+	bool ptr_set;
+	u8 bits;
+	u8 shift;
+	u8 ptr;
+	u8 mem[I2C_SIM_SIZE];
+
+	/* statistic */
+	u64 edges;
+	u64 starts;
+	u64 bytes;
+};
+
+#endif /* __I2C_SIM_H__ */
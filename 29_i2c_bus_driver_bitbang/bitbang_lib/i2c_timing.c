@@ -0,0 +1,83 @@
+#include <linux/math64.h>
+#include <linux/string.h>
+#include "i2c_timing.h"
+
+/* Private variables */
+static const struct {
+	const char *name;
+	u32 scl_hz;
+} i2c_timing_modes[] = {
+	{ "standard", 100000 },
+	{ "fast", 400000 },
+	{ "fast-plus", 1000000 },
+};
+
+/**
+ * i2c_timing_update - derive the busy-wait from the half period and the
+ * pin cost. A bit is three pin writes over two half periods.
+ */
+static void i2c_timing_update(struct i2c_timing *t)
+{
+	u32 pins = t->pin_ns * 3 / 2;
+
+	t->half_ns = DIV_ROUND_UP(NSEC_PER_SEC / 2, t->scl_hz);
+	t->wait_ns = t->half_ns > pins ? t->half_ns - pins : 0;
+}
+
+/**
+ * i2c_timing_set_mode - select "standard", "fast" or "fast-plus", and
+ * restart the achieved frequency measurement
+ *
+ * Return: 0, or -EINVAL for an unknown mode
+ */
+int i2c_timing_set_mode(struct i2c_timing *t, const char *mode)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(i2c_timing_modes); i++) {
+		if (sysfs_streq(mode, i2c_timing_modes[i].name)) {
+			t->scl_hz = i2c_timing_modes[i].scl_hz;
+			i2c_timing_update(t);
+			t->bits = 0;
+			t->ns = 0;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+/**
+ * i2c_timing_mode - name of the selected mode
+ */
+const char *i2c_timing_mode(struct i2c_timing *t)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(i2c_timing_modes); i++)
+		if (t->scl_hz == i2c_timing_modes[i].scl_hz)
+			return i2c_timing_modes[i].name;
+	return "unknown";
+}
+
+/**
+ * i2c_timing_set_pin_ns - apply the calibrated cost of one pin write
+ */
+void i2c_timing_set_pin_ns(struct i2c_timing *t, u32 pin_ns)
+{
+	t->pin_ns = pin_ns;
+	i2c_timing_update(t);
+}
+
+/**
+ * i2c_timing_achieved_hz - SCL frequency measured over every byte since
+ * the mode was set
+ *
+ * Return: frequency, 0 before the first byte
+ */
+u32 i2c_timing_achieved_hz(struct i2c_timing *t)
+{
+	if (t->ns == 0)
+		return 0;
+	return div64_u64(t->bits * NSEC_PER_SEC, t->ns);
+}
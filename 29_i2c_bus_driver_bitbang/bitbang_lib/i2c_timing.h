@@ -0,0 +1,115 @@
+#ifndef __I2C_TIMING_H__
+#define __I2C_TIMING_H__
+
+#include <linux/module.h>
+#include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/preempt.h>
+
+#define I2C_TIMING_STRETCH_MAX_US (100000) /* 100 ms */
+
+/*
+ * Bit timing of the bitbang engine. Every half SCL period is one
+ * i2c_timing_half(). In delay mode it busy-waits the half period minus
+ * the pin writes around it, as calibrated at load time. In paced mode it
+ * spins to an absolute deadline on the hrtimer clock, so the pin cost and
+ * short interrupts are absorbed instead of adding up. Bytes are timed,
+ * giving the achieved SCL frequency, and clocked with preemption disabled
+ * when the pins never sleep (atomic). gpiolib may sleep on any edge, e.g.
+ * in pinctrl or on an I2C expander, so its bytes stay preemptible.
+ */
+struct i2c_timing {
+	u32 scl_hz; /* target */
+	u32 half_ns; /* half SCL period */
+	u32 pin_ns; /* one pin write, calibrated */
+	u32 wait_ns; /* delay mode: busy-wait per half period */
+	bool paced;
+	bool atomic; /* the pin backend never sleeps */
+	bool pinned; /* preemption is disabled for the current byte */
+	u64 deadline; /* paced mode: end of the current half period */
+	u64 byte_t0;
+
+	/* measured while clocking bytes */
+	u64 bits;
+	u64 ns;
+
+	/* clock stretching */
+	u32 stretch_timeout_us;
+	bool stretch_expired; /* sticky, cleared by the bus driver */
+	u64 stretches;
+	u64 stretch_ns;
+	u64 stretch_timeouts;
+};
+
+/**
+ * i2c_timing_half - wait for the end of a half SCL period
+ */
+static inline void i2c_timing_half(struct i2c_timing *t)
+{
+	u64 now;
+
+	if (!t->paced) {
+		ndelay(t->wait_ns);
+		return;
+	}
+
+	t->deadline += t->half_ns;
+	while ((now = ktime_get_ns()) < t->deadline)
+		cpu_relax();
+	/* late, e.g. an interrupt: go on from now, never rush to catch up */
+	if (now - t->deadline > t->half_ns)
+		t->deadline = now;
+}
+
+/**
+ * i2c_timing_sync - paced mode: the next half period starts now
+ */
+static inline void i2c_timing_sync(struct i2c_timing *t)
+{
+	if (t->paced)
+		t->deadline = ktime_get_ns();
+}
+
+/**
+ * i2c_timing_byte_begin - a byte is about to be clocked
+ */
+static inline void i2c_timing_byte_begin(struct i2c_timing *t)
+{
+	if (t->atomic) {
+		preempt_disable();
+		t->pinned = true;
+	}
+	t->byte_t0 = ktime_get_ns();
+	t->deadline = t->byte_t0;
+}
+
+/**
+ * i2c_timing_byte_end - the byte and its ACK were clocked
+ */
+static inline void i2c_timing_byte_end(struct i2c_timing *t)
+{
+	t->ns += ktime_get_ns() - t->byte_t0;
+	t->bits += 9;
+	if (t->pinned) {
+		t->pinned = false;
+		preempt_enable();
+	}
+}
+
+/**
+ * i2c_timing_stretch_us - the stretch timeout, clamped: it is a
+ * writable module parameter
+ */
+static inline u32 i2c_timing_stretch_us(struct i2c_timing *t)
+{
+	return min_t(u32, READ_ONCE(t->stretch_timeout_us),
+		     I2C_TIMING_STRETCH_MAX_US);
+}
+
+/* exported functions */
+int i2c_timing_set_mode(struct i2c_timing *t, const char *mode);
+const char *i2c_timing_mode(struct i2c_timing *t);
+void i2c_timing_set_pin_ns(struct i2c_timing *t, u32 pin_ns);
+u32 i2c_timing_achieved_hz(struct i2c_timing *t);
+
+#endif /* __I2C_TIMING_H__ */
@@ -0,0 +1,33 @@
+#ifndef __SMBUS_PEC_H__
+#define __SMBUS_PEC_H__
+
+#include <linux/i2c.h>
+
+/*
+ * smbus_crc8 - SMBus PEC, CRC-8 with polynomial x^8 + x^2 + x + 1,
+ * continued from crc over count bytes
+ */
+static inline u8 smbus_crc8(u8 crc, const u8 *p, size_t count)
+{
+	int i;
+
+	while (count--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+	}
+	return crc;
+}
+
+/*
+ * smbus_pec_addr - continue crc with the address byte of a (repeated)
+ * START, as it appears on the wire
+ */
+static inline u8 smbus_pec_addr(u8 crc, u16 addr, bool is_read)
+{
+	u8 byte = (addr << 1) | is_read;
+
+	return smbus_crc8(crc, &byte, 1);
+}
+
+#endif /* __SMBUS_PEC_H__ */
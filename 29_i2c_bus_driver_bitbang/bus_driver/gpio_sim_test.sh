@@ -0,0 +1,122 @@
+#!/bin/sh
+#
+# Run the adapter through gpiolib on two gpio-sim lines (5.17+,
+# CONFIG_GPIO_SIM) and check both directions of every line: the levels
+# the driver reads follow the simulated pulls, and what the driver drives
+# shows up on the simulated lines. Then a transfer and a recovery go
+# through the real gpiolib path, for both algorithms.
+#
+# Build first (make), then run as root from anywhere: ./gpio_sim_test.sh
+# Exits non-zero if any check fails.
+
+set -eu
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+LIB=$HERE/../bitbang_lib/alman_bbang.ko
+BUS=$HERE/alman_bus.ko
+CFG=/sys/kernel/config/gpio-sim/alman-test
+DBG=/sys/kernel/debug/alman-bus
+ADAPTER=7
+fail=0
+
+cleanup() {
+	rmmod alman_bus 2>/dev/null || true
+	rmmod alman_bbang 2>/dev/null || true
+	if [ -d $CFG ]; then
+		echo 0 > $CFG/live || true
+		rmdir $CFG/bank0 $CFG || true
+	fi
+}
+
+check() {
+	if [ "$2" = "$3" ]; then
+		echo "ok   $1"
+	else
+		echo "FAIL $1: expected '$2', got '$3'"
+		fail=1
+	fi
+}
+
+# line 0 is SCL, line 1 is SDA
+sim_pull() {
+	echo "$2" > $SIM/sim_gpio$1/pull
+}
+
+sim_value() {
+	cat $SIM/sim_gpio$1/value
+}
+
+bus_stat() {
+	awk -F: -v k="$1" '$1 == k { print $2 + 0 }' $DBG/stats
+}
+
+trap cleanup EXIT
+
+modprobe gpio-sim
+modprobe i2c-dev
+mountpoint -q /sys/kernel/debug || mount -t debugfs none /sys/kernel/debug
+
+mkdir $CFG $CFG/bank0
+echo 2 > $CFG/bank0/num_lines
+echo 1 > $CFG/live
+
+CHIP=$(cat $CFG/bank0/chip_name)
+SIM=/sys/devices/platform/$(cat $CFG/dev_name)/$CHIP
+BASE=$(sed -n "s/^$CHIP: GPIOs \([0-9]*\)-.*/\1/p" /sys/kernel/debug/gpio)
+[ -n "$BASE" ] || { echo "no base for $CHIP"; exit 1; }
+
+for algo in custom bit; do
+	# the pull-ups of the bus
+	sim_pull 0 pull-up
+	sim_pull 1 pull-up
+
+	insmod $LIB
+	insmod $BUS pins=gpiolib algo=$algo scl_gpio=$BASE \
+		sda_gpio=$((BASE + 1))
+
+	# reading: a device on the bus holds a line low
+	check "$algo: idle bus" "scl 1 sda 1" "$(cat $DBG/lines)"
+	sim_pull 0 pull-down
+	check "$algo: SCL held low" "scl 0 sda 1" "$(cat $DBG/lines)"
+	sim_pull 0 pull-up
+	sim_pull 1 pull-down
+	check "$algo: SDA held low" "scl 1 sda 0" "$(cat $DBG/lines)"
+	sim_pull 1 pull-up
+
+	# driving: the driver pulls a line low and releases it
+	echo "scl 0" > $DBG/lines
+	check "$algo: SCL driven low" "0" "$(sim_value 0)"
+	echo "scl 1" > $DBG/lines
+	check "$algo: SCL released" "1" "$(sim_value 0)"
+	echo "sda 0" > $DBG/lines
+	check "$algo: SDA driven low" "0" "$(sim_value 1)"
+	echo "sda 1" > $DBG/lines
+	check "$algo: SDA released" "1" "$(sim_value 1)"
+
+	# nobody ACKs the address, the transfer fails and leaves the bus idle
+	if i2cget -y $ADAPTER 0x50 >/dev/null 2>&1; then
+		check "$algo: NACKed read" "error" "data"
+	else
+		check "$algo: NACKed read" "error" "error"
+	fi
+	check "$algo: transfers" "1" "$(bus_stat xfers)"
+	check "$algo: errors" "1" "$(bus_stat errors)"
+	check "$algo: bus released" "scl 1 sda 1" "$(cat $DBG/lines)"
+	check "$algo: SCL line" "1" "$(sim_value 0)"
+	check "$algo: SDA line" "1" "$(sim_value 1)"
+
+	# a device keeps SDA low through the 9 clocks, the recovery fails
+	sim_pull 1 pull-down
+	if echo 1 > $DBG/recover 2>/dev/null; then
+		check "$algo: recovery of a stuck bus" "error" "ok"
+	else
+		check "$algo: recovery of a stuck bus" "error" "error"
+	fi
+	check "$algo: recovery failures" "1" "$(bus_stat "recovery failures")"
+	sim_pull 1 pull-up
+
+	rmmod alman_bus
+	rmmod alman_bbang
+done
+
+exit $fail
@@ -1,6 +1,7 @@
 #include <linux/i2c.h>
 #include <linux/module.h>
-#include "i2c_bitbang.h"
+#include <linux/debugfs.h>
+#include "i2c_bbang_bus.h"
 
 /* Private macros */
 #define MOD_NAME "alman-bus"
@@ -9,104 +10,105 @@
 #define ADAPTER_NAME "ALM_I2C_ADAPTER"
 #define GPIO_SCL (4)
 #define GPIO_SDA (17)
+#define STRETCH_TIMEOUT_US (25000) /* SMBus tTIMEOUT */
 
 /* Private variables */
-static struct i2c_gpio alm_i2c_gpio;
-
-/**
- * alm_func - list supported functionalities for this bus driver
- *
- * Return: merged functionalities
- */
-static u32 alm_func(struct i2c_adapter *adapter)
-{
-	return (I2C_FUNC_I2C | I2C_FUNC_SMBUS_QUICK | I2C_FUNC_SMBUS_BYTE |
-		I2C_FUNC_SMBUS_BYTE_DATA | I2C_FUNC_SMBUS_WORD_DATA |
-		I2C_FUNC_SMBUS_BLOCK_DATA);
-}
-
-/**
- * alm_i2c_xfer - low level i2c routine
- *
- * Return: errno
- */
-static int alm_i2c_xfer(struct i2c_adapter *adapter, struct i2c_msg *msgs,
-			int num)
-{
-	int ret = 0, i, j;
-	struct i2c_msg *msg;
-
-	if (i2c_gpio_init(&alm_i2c_gpio, GPIO_SCL, GPIO_SDA) < 0)
-		return -EINVAL;
-
-	i2c_bbang_start(&alm_i2c_gpio);
-
-	for (i = 0; i < num; i++) {
-		msg = &msgs[i];
-
-		if (i2c_bbang_send(&alm_i2c_gpio, msg->addr, msg->buf, msg->len))
-			ret++;
-
-		pr_info(MOD_INFO
-			"[%s]: [count: %d] [addr: 0x%X] [len: %d] [data: ",
-			__func__, i, msg->addr, msg->len);
-
-		for (j = 0; j < msg->len; j++)
-			pr_cont("0x%02X ", msg->buf[j]);
-		pr_cont("]\n");
-	}
-
-	i2c_bbang_stop(&alm_i2c_gpio);
-	i2c_gpio_deinit(&alm_i2c_gpio);
-
-	return 0;
-}
+static struct i2c_bbang_bus alm_bus = {
+	.adapter = {
+		.owner = THIS_MODULE,
+		.class = I2C_CLASS_HWMON, // | I2C_CLASS_SPD,
+		.name = ADAPTER_NAME,
+		.nr = 7,
+	},
+	.gpio.timing.stretch_timeout_us = STRETCH_TIMEOUT_US,
+};
+static struct dentry *alm_debugfs;
 
-/**
- * alm_smbus_xfer - low level smbus routine
+/* Module parameters */
+/*
+ * The bitbang engine and i2c-algo-bit live in the alman_bbang library,
+ * shared with 30_i2c_bus_driver_gpio; load it first. This adapter uses
+ * the engine by default, algo=bit switches to i2c-algo-bit.
  *
- * Return: errno
+ * On a Raspberry Pi, pins=mmio mmio_base=0xfe200000 (Pi 4) or
+ * 0x3f200000 (Pi 2/3) drives the lines straight through the GPIO block.
+ * pins=sim needs no hardware: the wire is simulated, with an EEPROM at
+ * 0x50, so i2cdetect -y 7 finds it and i2cdump -y 7 0x50 reads it.
+ * gpiolib is exercised on gpio-sim lines (5.17+) by gpio_sim_test.sh,
+ * which checks the levels read and driven through the lines file of
+ * /sys/kernel/debug/alman-bus, a transfer and a recovery, with both
+ * algorithms. In the same directory, bench reports edges/s of the
+ * backend and selftest runs both algorithms against the simulated
+ * EEPROM.
  */
-static int alm_smbus_xfer(struct i2c_adapter *adapter, u16 addr,
-			  unsigned short flags, char read_write, u8 command,
-			  int size, union i2c_smbus_data *data)
-{
-	pr_info(MOD_INFO "[%s]: Implement me\n", __func__);
-	return 0;
-}
-
-/* I2C algorithm structure */
-static struct i2c_algorithm alm_i2c_algorithm = {
-	.smbus_xfer = alm_smbus_xfer,
-	.master_xfer = alm_i2c_xfer,
-	.functionality = alm_func,
-};
-
-/* I2C adapter structure */
-static struct i2c_adapter alm_i2c_adapter = {
-	.owner = THIS_MODULE,
-	.class = I2C_CLASS_HWMON, // | I2C_CLASS_SPD,
-	.algo = &alm_i2c_algorithm,
-	.name = ADAPTER_NAME,
-	.nr = 7,
-};
+static char *pins = "gpiolib";
+module_param(pins, charp, 0444);
+MODULE_PARM_DESC(pins, "Pin backend: gpiolib, mmio or sim");
+
+static char *algo = "custom";
+module_param(algo, charp, 0444);
+MODULE_PARM_DESC(algo, "Transfer algorithm: custom or bit (i2c-algo-bit)");
+
+static int scl_gpio = GPIO_SCL;
+module_param(scl_gpio, int, 0444);
+MODULE_PARM_DESC(scl_gpio, "SCL line");
+
+static int sda_gpio = GPIO_SDA;
+module_param(sda_gpio, int, 0444);
+MODULE_PARM_DESC(sda_gpio, "SDA line");
+
+static ulong mmio_base;
+module_param(mmio_base, ulong, 0444);
+MODULE_PARM_DESC(mmio_base, "Physical address of a BCM2835 compatible GPIO "
+			    "block, for pins=mmio");
+
+static char *mode = "standard";
+module_param(mode, charp, 0444);
+MODULE_PARM_DESC(mode, "Bus speed: standard, fast or fast-plus");
+
+static bool paced;
+module_param(paced, bool, 0444);
+MODULE_PARM_DESC(paced, "Pace half clocks on hrtimer clock deadlines "
+			"instead of calibrated delays");
+
+module_param_named(stretch_timeout_us, alm_bus.gpio.timing.stretch_timeout_us,
+		   uint, 0644);
+MODULE_PARM_DESC(stretch_timeout_us, "Longest clock stretch of a slave "
+				     "before the transfer fails, at most "
+				     "100000");
 
 /* Module init callback */
 static int __init alm_init(void)
 {
-	if (i2c_add_numbered_adapter(&alm_i2c_adapter) < 0) {
+	struct i2c_bbang_cfg cfg = {
+		.pins = pins,
+		.algo = algo,
+		.mode = mode,
+		.paced = paced,
+		.scl_gpio = scl_gpio,
+		.sda_gpio = sda_gpio,
+		.mmio_base = mmio_base,
+	};
+
+	if (i2c_bbang_bus_add(&alm_bus, &cfg) < 0) {
 		pr_err(MOD_INFO "Can't add I2C adapter\n");
 		return -1;
 	}
 
-	pr_info(MOD_INFO "Driver added\n");
+	alm_debugfs = debugfs_create_dir(MOD_NAME, NULL);
+	i2c_bbang_bus_debugfs(&alm_bus, alm_debugfs);
+
+	pr_info(MOD_INFO "Driver added, %s mode, %s pins, %s algo, "
+		"pin write %u ns\n", mode, alm_bus.gpio.ops->name,
+		alm_bus.algo->name, alm_bus.gpio.timing.pin_ns);
 	return 0;
 }
 
 /* Module exit callback */
 static void __exit alm_exit(void)
 {
-	i2c_del_adapter(&alm_i2c_adapter);
+	debugfs_remove_recursive(alm_debugfs);
+	i2c_bbang_bus_del(&alm_bus);
 	pr_info(MOD_INFO "Driver removed\n");
 }
 
@@ -1,7 +1,7 @@
 #include <linux/i2c.h>
 #include <linux/module.h>
-#include <linux/i2c-algo-bit.h>
-#include "i2c_gpio.h"
+#include <linux/debugfs.h>
+#include "i2c_bbang_bus.h"
 
 /* Private macros */
 #define MOD_NAME "alman-bus"
@@ -10,83 +10,82 @@
 #define ADAPTER_NAME "ALM_I2C_ADAPTER"
 #define GPIO_SCL (4)
 #define GPIO_SDA (17)
+#define STRETCH_TIMEOUT_US (100000) /* 100 ms */
 
 /* Private variables */
-static struct i2c_gpio alm_i2c_gpio;
-
-/* 
- * alm_i2c_get_scl - read scl pin state 
- */
-static int alm_i2c_get_scl(void *data)
-{
-	return i2c_gpio_read_scl(&alm_i2c_gpio);
-}
+static struct i2c_bbang_bus alm_bus = {
+	.adapter = {
+		.owner = THIS_MODULE,
+		.class = I2C_CLASS_HWMON | I2C_CLASS_SPD,
+		.name = ADAPTER_NAME,
+		.nr = 7,
+	},
+	.gpio.timing.stretch_timeout_us = STRETCH_TIMEOUT_US,
+};
+static struct dentry *alm_debugfs;
 
+/* Module parameters */
 /*
- * alm_i2c_get_sda - read sda pin state
+ * Same adapter as 29_i2c_bus_driver_bitbang, on the same library
+ * (alman_bbang, load it first), but i2c-algo-bit moves the bits by
+ * default; algo=custom switches to the bitbang engine. pins=sim needs
+ * no hardware, see 29_i2c_bus_driver_bitbang for the other backends.
  */
-static int alm_i2c_get_sda(void *data)
-{
-	return i2c_gpio_read_sda(&alm_i2c_gpio);
-}
+static char *pins = "gpiolib";
+module_param(pins, charp, 0444);
+MODULE_PARM_DESC(pins, "Pin backend: gpiolib, mmio or sim");
 
-/*
- * alm_i2c_set_scl - write state to scl pin
- */
-static void alm_i2c_set_scl(void *data, int state)
-{
-	i2c_gpio_write_scl(&alm_i2c_gpio, state);
-}
+static char *algo = "bit";
+module_param(algo, charp, 0444);
+MODULE_PARM_DESC(algo, "Transfer algorithm: bit (i2c-algo-bit) or custom");
 
-/*
- * alm_i2c_set_sda - write state to sda pin
- */
-static void alm_i2c_set_sda(void *data, int state)
-{
-	i2c_gpio_write_sda(&alm_i2c_gpio, state);
-}
+static int scl_gpio = GPIO_SCL;
+module_param(scl_gpio, int, 0444);
+MODULE_PARM_DESC(scl_gpio, "SCL line");
 
-/* I2C algorithm structure */
-static struct i2c_algo_bit_data alm_i2c_algorithm = {
-	.setsda = alm_i2c_set_sda,
-	.setscl = alm_i2c_set_scl,
-	.getsda = alm_i2c_get_sda,
-	.getscl = alm_i2c_get_scl,
-	.udelay = 5,
-	.timeout = 100, /* ms */
-};
+static int sda_gpio = GPIO_SDA;
+module_param(sda_gpio, int, 0444);
+MODULE_PARM_DESC(sda_gpio, "SDA line");
 
-/* I2C adapter structure */
-static struct i2c_adapter alm_i2c_adapter = {
-	.owner = THIS_MODULE,
-	.class = I2C_CLASS_HWMON | I2C_CLASS_SPD,
-	.name = ADAPTER_NAME,
-	.algo_data = &alm_i2c_algorithm,
-	.nr = 7,
-};
+static ulong mmio_base;
+module_param(mmio_base, ulong, 0444);
+MODULE_PARM_DESC(mmio_base, "Physical address of a BCM2835 compatible GPIO "
+			    "block, for pins=mmio");
+
+static char *mode = "standard";
+module_param(mode, charp, 0444);
+MODULE_PARM_DESC(mode, "Bus speed: standard, fast or fast-plus");
 
 /* Module init callback */
 static int __init alm_init(void)
 {
-	if (i2c_gpio_init(&alm_i2c_gpio, GPIO_SCL, GPIO_SDA) < 0) {
-		pr_err(MOD_INFO "Can't initialize gpio\n");
-		return -1;
-	}
+	struct i2c_bbang_cfg cfg = {
+		.pins = pins,
+		.algo = algo,
+		.mode = mode,
+		.scl_gpio = scl_gpio,
+		.sda_gpio = sda_gpio,
+		.mmio_base = mmio_base,
+	};
 
-	if (i2c_bit_add_numbered_bus(&alm_i2c_adapter) < 0) {
+	if (i2c_bbang_bus_add(&alm_bus, &cfg) < 0) {
 		pr_err(MOD_INFO "Can't add I2C adapter\n");
 		return -1;
 	}
 
-	pr_info(MOD_INFO "Driver added\n");
+	alm_debugfs = debugfs_create_dir(MOD_NAME, NULL);
+	i2c_bbang_bus_debugfs(&alm_bus, alm_debugfs);
+
+	pr_info(MOD_INFO "Driver added, %s mode, %s pins, %s algo\n", mode,
+		alm_bus.gpio.ops->name, alm_bus.algo->name);
 	return 0;
 }
 
 /* Module exit callback */
 static void __exit alm_exit(void)
 {
-	i2c_gpio_deinit(&alm_i2c_gpio);
-	i2c_del_adapter(&alm_i2c_adapter);
+	debugfs_remove_recursive(alm_debugfs);
+	i2c_bbang_bus_del(&alm_bus);
 	pr_info(MOD_INFO "Driver removed\n");
 }
 
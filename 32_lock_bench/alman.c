@@ -0,0 +1,536 @@
+#include <linux/module.h>
+#include <linux/kthread.h>
+#include <linux/delay.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/seqlock.h>
+#include <linux/atomic.h>
+#include <linux/percpu.h>
+#include <linux/rcupdate.h>
+#include <linux/sched/clock.h>
+#include <linux/completion.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/log2.h>
+
+/* Private macros */
+#define MOD_NAME "alman"
+#define DEV_INFO KERN_INFO MOD_NAME ": "
+
+#define MAX_THREAD (256)
+#define LAT_BUCKETS (64)
+#define CMD_SIZE (16)
+
+/* Private types */
+struct bench_data {
+	u64 a;
+	u64 b;
+	u64 c;
+	u64 d;
+};
+
+struct bench_rcu {
+	struct bench_data data;
+	struct rcu_head rcu;
+};
+
+/* Lock variant operations */
+struct bench_ops {
+	const char *name;
+	void (*read)(struct bench_data *out);
+	void (*write)(void);
+};
+
+/* Per-thread statistic, one cacheline each to avoid false sharing */
+struct thread_stats {
+	struct task_struct *thread;
+	const struct bench_ops *ops;
+	u32 rnd;
+	u64 reads;
+	u64 writes;
+	u64 lat[LAT_BUCKETS];
+} ____cacheline_aligned_in_smp;
+
+struct bench_result {
+	u64 ops;
+	u64 reads;
+	u64 writes;
+	u64 ops_per_sec;
+	u64 p50;
+	u64 p90;
+	u64 p99;
+	u64 p999;
+	unsigned int threads;
+	unsigned int write_pct;
+	bool valid;
+};
+
+/* Module parameters */
+static unsigned int nr_threads = 4;
+module_param(nr_threads, uint, 0644);
+MODULE_PARM_DESC(nr_threads, "Number of benchmark threads");
+
+static unsigned int write_pct = 10;
+module_param(write_pct, uint, 0644);
+MODULE_PARM_DESC(write_pct, "Percentage of write operations (0..100)");
+
+static unsigned int duration_ms = 1000;
+module_param(duration_ms, uint, 0644);
+MODULE_PARM_DESC(duration_ms, "Run time of each variant (ms)");
+
+static unsigned int sample_shift = 3;
+module_param(sample_shift, uint, 0644);
+MODULE_PARM_DESC(sample_shift, "Time one of every 2^n operations");
+
+/* Private variables */
+static struct bench_data shared;
+static DEFINE_MUTEX(bench_mutex);
+static DEFINE_SPINLOCK(bench_spinlock);
+static DEFINE_RWLOCK(bench_rwlock);
+static DEFINE_SEQLOCK(bench_seqlock);
+static atomic64_t bench_atomic = ATOMIC64_INIT(0);
+static DEFINE_PER_CPU(u64, bench_percpu);
+static struct bench_rcu __rcu *bench_rcu_ptr;
+static DEFINE_SPINLOCK(bench_rcu_lock);
+
+static struct thread_stats *stats;
+static unsigned int run_threads;
+static unsigned int run_write_pct;
+static u64 run_sample_mask;
+static atomic_t run_ready;
+static atomic_t run_done;
+static bool run_go;
+static u64 run_deadline;
+static DECLARE_COMPLETION(run_complete);
+static DEFINE_MUTEX(run_lock);
+static struct dentry *alm_debugfs;
+
+/* Function implementations */
+/* Variant: mutex */
+static void mutex_read(struct bench_data *out)
+{
+	mutex_lock(&bench_mutex);
+	*out = shared;
+	mutex_unlock(&bench_mutex);
+}
+
+static void mutex_write(void)
+{
+	mutex_lock(&bench_mutex);
+	shared.a++;
+	shared.b += 2;
+	shared.c += 3;
+	shared.d += 4;
+	mutex_unlock(&bench_mutex);
+}
+
+/* Variant: spinlock */
+static void spin_read(struct bench_data *out)
+{
+	spin_lock(&bench_spinlock);
+	*out = shared;
+	spin_unlock(&bench_spinlock);
+}
+
+static void spin_write(void)
+{
+	spin_lock(&bench_spinlock);
+	shared.a++;
+	shared.b += 2;
+	shared.c += 3;
+	shared.d += 4;
+	spin_unlock(&bench_spinlock);
+}
+
+/* Variant: reader-writer spinlock */
+static void rwlock_read(struct bench_data *out)
+{
+	read_lock(&bench_rwlock);
+	*out = shared;
+	read_unlock(&bench_rwlock);
+}
+
+static void rwlock_write(void)
+{
+	write_lock(&bench_rwlock);
+	shared.a++;
+	shared.b += 2;
+	shared.c += 3;
+	shared.d += 4;
+	write_unlock(&bench_rwlock);
+}
+
+/* Variant: seqlock */
+static void seqlock_read(struct bench_data *out)
+{
+	unsigned int seq;
+
+	do {
+		seq = read_seqbegin(&bench_seqlock);
+		*out = shared;
+	} while (read_seqretry(&bench_seqlock, seq));
+}
+
+static void seqlock_write(void)
+{
+	write_seqlock(&bench_seqlock);
+	shared.a++;
+	shared.b += 2;
+	shared.c += 3;
+	shared.d += 4;
+	write_sequnlock(&bench_seqlock);
+}
+
+/* Variant: atomic counter, single word only */
+static void atomic_read_op(struct bench_data *out)
+{
+	out->a = atomic64_read(&bench_atomic);
+}
+
+static void atomic_write_op(void)
+{
+	atomic64_inc(&bench_atomic);
+}
+
+/* Variant: per-CPU counter, cheap write and expensive read */
+static void pcpu_read(struct bench_data *out)
+{
+	int cpu;
+	u64 sum = 0;
+
+	for_each_possible_cpu(cpu)
+		sum += READ_ONCE(*per_cpu_ptr(&bench_percpu, cpu));
+	out->a = sum;
+}
+
+static void pcpu_write(void)
+{
+	this_cpu_inc(bench_percpu);
+}
+
+/* Variant: RCU, readers never block, writers copy and publish */
+static void rcu_snap_read(struct bench_data *out)
+{
+	struct bench_rcu *p;
+
+	rcu_read_lock();
+	p = rcu_dereference(bench_rcu_ptr);
+	*out = p->data;
+	rcu_read_unlock();
+}
+
+static void rcu_snap_write(void)
+{
+	struct bench_rcu *old, *new;
+
+	if ((new = kmalloc(sizeof(*new), GFP_KERNEL)) == NULL)
+		return;
+
+	spin_lock(&bench_rcu_lock);
+	old = rcu_dereference_protected(bench_rcu_ptr,
+					lockdep_is_held(&bench_rcu_lock));
+	new->data = old->data;
+	new->data.a++;
+	new->data.b += 2;
+	new->data.c += 3;
+	new->data.d += 4;
+	rcu_assign_pointer(bench_rcu_ptr, new);
+	spin_unlock(&bench_rcu_lock);
+
+	kfree_rcu(old, rcu);
+}
+
+static const struct bench_ops bench_list[] = {
+	{ "mutex", mutex_read, mutex_write },
+	{ "spinlock", spin_read, spin_write },
+	{ "rwlock", rwlock_read, rwlock_write },
+	{ "seqlock", seqlock_read, seqlock_write },
+	{ "atomic", atomic_read_op, atomic_write_op },
+	{ "percpu", pcpu_read, pcpu_write },
+	{ "rcu", rcu_snap_read, rcu_snap_write },
+};
+
+static struct bench_result results[ARRAY_SIZE(bench_list)];
+
+/* Thread: cheap per-thread pseudo random generator (xorshift32) */
+static u32 bench_rand(struct thread_stats *ts)
+{
+	u32 x = ts->rnd;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return ts->rnd = x;
+}
+
+/* Thread: hammer the selected variant until the deadline */
+static int fn_thread(void *pv)
+{
+	struct thread_stats *ts = pv;
+	const struct bench_ops *ops = ts->ops;
+	struct bench_data snap;
+	u64 mask = run_sample_mask;
+	u64 n = 0, t0 = 0;
+	bool is_write, timed;
+
+	/* Start barrier: wait until every thread is spawned */
+	atomic_inc(&run_ready);
+	while (!READ_ONCE(run_go) && !kthread_should_stop())
+		cond_resched();
+
+	while (!kthread_should_stop()) {
+		timed = (n++ & mask) == 0;
+		if (timed) {
+			if (local_clock() >= run_deadline)
+				break;
+			t0 = local_clock();
+		}
+
+		is_write = (bench_rand(ts) % 100) < run_write_pct;
+		if (is_write) {
+			ops->write();
+			ts->writes++;
+		} else {
+			ops->read(&snap);
+			ts->reads++;
+		}
+
+		if (timed)
+			ts->lat[ilog2(local_clock() - t0 + 1)]++;
+
+		if ((n & 0xffff) == 0)
+			cond_resched();
+	}
+
+	if (atomic_inc_return(&run_done) == run_threads)
+		complete(&run_complete);
+
+	/* Park until the runner collects the statistic */
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return 0;
+}
+
+/* Runner: percentile from log2 histogram, reported as bucket upper bound */
+static u64 lat_percentile(const u64 *hist, u64 total, unsigned int permille)
+{
+	u64 want = div_u64(total * permille, 1000), acc = 0;
+	int i;
+
+	for (i = 0; i < LAT_BUCKETS; i++) {
+		acc += hist[i];
+		if (acc > want)
+			return 2ULL << i;
+	}
+	return 0;
+}
+
+/* Runner: spawn threads for one variant and collect the result */
+static int bench_run(unsigned int idx)
+{
+	const struct bench_ops *ops = &bench_list[idx];
+	struct bench_result *res = &results[idx];
+	u64 hist[LAT_BUCKETS] = { 0 };
+	u64 total = 0, start, elapsed = 0;
+	unsigned int i, j, started = 0;
+	int ret = 0;
+
+	run_threads = nr_threads;
+	run_write_pct = write_pct;
+	run_sample_mask = (1ULL << min(sample_shift, 20U)) - 1;
+
+	memset(stats, 0, sizeof(*stats) * run_threads);
+	atomic_set(&run_ready, 0);
+	atomic_set(&run_done, 0);
+	reinit_completion(&run_complete);
+	WRITE_ONCE(run_go, false);
+
+	for (i = 0; i < run_threads; i++) {
+		struct thread_stats *ts = &stats[i];
+
+		ts->ops = ops;
+		ts->rnd = 0x9e3779b9 ^ (i + 1);
+		ts->thread = kthread_create(fn_thread, ts, "bench_%s_%u",
+					    ops->name, i);
+		if (IS_ERR(ts->thread)) {
+			pr_err(DEV_INFO "Can't create thread %u\n", i);
+			ret = PTR_ERR(ts->thread);
+			ts->thread = NULL;
+			break;
+		}
+		kthread_bind(ts->thread, cpumask_local_spread(i, NUMA_NO_NODE));
+		wake_up_process(ts->thread);
+		started++;
+	}
+
+	if (started == run_threads) {
+		while (atomic_read(&run_ready) < run_threads)
+			msleep(1);
+
+		start = local_clock();
+		WRITE_ONCE(run_deadline, start + duration_ms * NSEC_PER_MSEC);
+		smp_wmb();
+		WRITE_ONCE(run_go, true);
+
+		wait_for_completion(&run_complete);
+		elapsed = local_clock() - start;
+	}
+
+	for (i = 0; i < started; i++)
+		kthread_stop(stats[i].thread);
+
+	if (ret < 0)
+		return ret;
+
+	memset(res, 0, sizeof(*res));
+	for (i = 0; i < run_threads; i++) {
+		res->reads += stats[i].reads;
+		res->writes += stats[i].writes;
+		for (j = 0; j < LAT_BUCKETS; j++) {
+			hist[j] += stats[i].lat[j];
+			total += stats[i].lat[j];
+		}
+	}
+
+	res->ops = res->reads + res->writes;
+	res->ops_per_sec = div64_u64(res->ops * NSEC_PER_SEC, elapsed ?: 1);
+	res->p50 = lat_percentile(hist, total, 500);
+	res->p90 = lat_percentile(hist, total, 900);
+	res->p99 = lat_percentile(hist, total, 990);
+	res->p999 = lat_percentile(hist, total, 999);
+	res->threads = run_threads;
+	res->write_pct = run_write_pct;
+	res->valid = true;
+
+	pr_info(DEV_INFO "%s: %llu ops/s\n", ops->name, res->ops_per_sec);
+	return 0;
+}
+
+/* Debugfs: "run" accepts a variant name or "all" */
+static ssize_t run_write(struct file *filp, const char __user *buf, size_t len,
+			 loff_t *off)
+{
+	char cmd[CMD_SIZE];
+	bool all;
+	unsigned int i;
+	int ret = 0;
+
+	if (len >= sizeof(cmd))
+		return -EINVAL;
+	if (copy_from_user(cmd, buf, len))
+		return -EFAULT;
+	cmd[len] = '\0';
+	strim(cmd);
+
+	if (nr_threads == 0 || nr_threads > MAX_THREAD || write_pct > 100)
+		return -EINVAL;
+
+	all = strcmp(cmd, "all") == 0;
+
+	mutex_lock(&run_lock);
+	for (i = 0; i < ARRAY_SIZE(bench_list); i++) {
+		if (!all && strcmp(cmd, bench_list[i].name))
+			continue;
+		if ((ret = bench_run(i)) < 0)
+			break;
+		if (!all)
+			break;
+	}
+	mutex_unlock(&run_lock);
+
+	if (ret < 0)
+		return ret;
+	if (!all && i == ARRAY_SIZE(bench_list))
+		return -EINVAL;
+
+	return len;
+}
+
+static const struct file_operations run_fops = {
+	.owner = THIS_MODULE,
+	.write = run_write,
+};
+
+/* Debugfs: "results" shows the last run of every variant */
+static int results_show(struct seq_file *s, void *unused)
+{
+	unsigned int i;
+
+	seq_printf(s, "%-10s %7s %5s %14s %14s %8s %8s %8s %8s\n", "variant",
+		   "threads", "wr%", "ops", "ops/s", "p50ns", "p90ns", "p99ns",
+		   "p999ns");
+
+	for (i = 0; i < ARRAY_SIZE(bench_list); i++) {
+		struct bench_result *r = &results[i];
+
+		if (!r->valid)
+			continue;
+
+		seq_printf(s,
+			   "%-10s %7u %5u %14llu %14llu %8llu %8llu %8llu %8llu\n",
+			   bench_list[i].name, r->threads, r->write_pct, r->ops,
+			   r->ops_per_sec, r->p50, r->p90, r->p99, r->p999);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(results);
+
+/*
+** This function is called at the first time module inserted
+*/
+static int __init alm_init(void)
+{
+	struct bench_rcu *p;
+
+	if ((stats = kcalloc(MAX_THREAD, sizeof(*stats), GFP_KERNEL)) == NULL)
+		return -ENOMEM;
+
+	if ((p = kzalloc(sizeof(*p), GFP_KERNEL)) == NULL)
+		goto r_stats;
+	RCU_INIT_POINTER(bench_rcu_ptr, p);
+
+	/* Debugfs: /sys/kernel/debug/alman_lock_bench/ */
+	alm_debugfs = debugfs_create_dir(MOD_NAME "_lock_bench", NULL);
+	debugfs_create_file("run", 0200, alm_debugfs, NULL, &run_fops);
+	debugfs_create_file("results", 0444, alm_debugfs, NULL,
+			    &results_fops);
+
+	printk(DEV_INFO "Driver inserted\n");
+	return 0;
+
+r_stats:
+	kfree(stats);
+
+	return -ENOMEM;
+}
+
+/*
+** This function is called at the last time module removed
+*/
+static void __exit alm_exit(void)
+{
+	debugfs_remove_recursive(alm_debugfs);
+
+	/* No more readers once debugfs is gone and no run is active */
+	kfree(rcu_dereference_protected(bench_rcu_ptr, 1));
+	rcu_barrier();
+	kfree(stats);
+
+	printk(DEV_INFO "Driver removed\n");
+}
+
+module_init(alm_init);
+module_exit(alm_exit);
+
+/* Module description */
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Pudja Mansyurin");
+MODULE_DESCRIPTION(MOD_NAME);
+MODULE_VERSION("3:5.4");
@@ -0,0 +1,285 @@
+#include <linux/module.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+#include <linux/gpio.h>
+#include <linux/mutex.h>
+#include "soft_pwm.h"
+
+/* Private macros */
+#define MOD_NAME "alman"
+#define DEV_INFO KERN_INFO MOD_NAME ": "
+#define GPIO_LED (23)
+
+/* Private types */
+enum alm_field { ALM_PERIOD, ALM_DUTY, ALM_ENABLE };
+
+/* Private variables */
+static struct spwm alm_pwm;
+static struct kobject *alm_kobj_ref;
+static struct kobject *alm_ch_kobj[SPWM_MAX_CHANNELS];
+static DEFINE_MUTEX(alm_ch_lock); /* one channel store at a time */
+
+/* Module parameters */
+static int gpios[SPWM_MAX_CHANNELS] = { GPIO_LED };
+static int nr_gpios = 1;
+module_param_array(gpios, int, &nr_gpios, 0444);
+MODULE_PARM_DESC(gpios, "Output GPIO of every channel");
+
+static unsigned int slack_ns = 1000;
+module_param(slack_ns, uint, 0444);
+MODULE_PARM_DESC(slack_ns, "Edges closer than this share one expiry");
+
+/* Module prototypes */
+static int __init alm_init(void);
+static void __exit alm_exit(void);
+/* Sysfs prototypes */
+static ssize_t period_show(struct kobject *kobj, struct kobj_attribute *attr,
+			   char *buf);
+static ssize_t period_store(struct kobject *kobj, struct kobj_attribute *attr,
+			    const char *buf, size_t count);
+static ssize_t duty_cycle_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf);
+static ssize_t duty_cycle_store(struct kobject *kobj,
+				struct kobj_attribute *attr, const char *buf,
+				size_t count);
+static ssize_t enable_show(struct kobject *kobj, struct kobj_attribute *attr,
+			   char *buf);
+static ssize_t enable_store(struct kobject *kobj, struct kobj_attribute *attr,
+			    const char *buf, size_t count);
+static ssize_t stats_show(struct kobject *kobj, struct kobj_attribute *attr,
+			  char *buf);
+
+/* Same names and units (ns) as the PWM class of the kernel */
+static struct kobj_attribute period_attr = __ATTR_RW(period);
+static struct kobj_attribute duty_cycle_attr = __ATTR_RW(duty_cycle);
+static struct kobj_attribute enable_attr = __ATTR_RW(enable);
+static struct kobj_attribute stats_attr = __ATTR_RO(stats);
+
+static struct attribute *alm_ch_attrs[] = {
+	&period_attr.attr,
+	&duty_cycle_attr.attr,
+	&enable_attr.attr,
+	NULL,
+};
+
+static const struct attribute_group alm_ch_group = {
+	.attrs = alm_ch_attrs,
+};
+
+/* Function implementations */
+/*
+** Map a channel directory back to its channel
+*/
+static int alm_ch_of(struct kobject *kobj)
+{
+	int ch;
+
+	for (ch = 0; ch < alm_pwm.nr_chan; ch++) {
+		if (alm_ch_kobj[ch] == kobj)
+			return ch;
+	}
+	return -ENODEV;
+}
+
+/*
+** Read-modify-write of one channel, @field selects what is replaced.
+** alm_ch_lock keeps a concurrent store from reading the old config.
+*/
+static ssize_t alm_ch_store(struct kobject *kobj, enum alm_field field,
+			    const char *buf, size_t count)
+{
+	struct spwm_chan c;
+	int ch, err;
+	u64 val;
+
+	if ((ch = alm_ch_of(kobj)) < 0)
+		return ch;
+	if ((err = kstrtou64(buf, 0, &val)) < 0)
+		return err;
+
+	mutex_lock(&alm_ch_lock);
+	spwm_get(&alm_pwm, ch, &c);
+	switch (field) {
+	case ALM_PERIOD:
+		c.period_ns = val;
+		break;
+	case ALM_DUTY:
+		c.duty_ns = val;
+		break;
+	case ALM_ENABLE:
+		c.enable = val != 0;
+		break;
+	}
+
+	err = spwm_config(&alm_pwm, ch, c.period_ns, c.duty_ns, c.enable);
+	mutex_unlock(&alm_ch_lock);
+
+	return err < 0 ? err : count;
+}
+
+static ssize_t period_show(struct kobject *kobj, struct kobj_attribute *attr,
+			   char *buf)
+{
+	struct spwm_chan c;
+	int ch;
+
+	if ((ch = alm_ch_of(kobj)) < 0)
+		return ch;
+
+	spwm_get(&alm_pwm, ch, &c);
+	return sprintf(buf, "%llu\n", c.period_ns);
+}
+
+static ssize_t period_store(struct kobject *kobj, struct kobj_attribute *attr,
+			    const char *buf, size_t count)
+{
+	return alm_ch_store(kobj, ALM_PERIOD, buf, count);
+}
+
+static ssize_t duty_cycle_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	struct spwm_chan c;
+	int ch;
+
+	if ((ch = alm_ch_of(kobj)) < 0)
+		return ch;
+
+	spwm_get(&alm_pwm, ch, &c);
+	return sprintf(buf, "%llu\n", c.duty_ns);
+}
+
+static ssize_t duty_cycle_store(struct kobject *kobj,
+				struct kobj_attribute *attr, const char *buf,
+				size_t count)
+{
+	return alm_ch_store(kobj, ALM_DUTY, buf, count);
+}
+
+static ssize_t enable_show(struct kobject *kobj, struct kobj_attribute *attr,
+			   char *buf)
+{
+	struct spwm_chan c;
+	int ch;
+
+	if ((ch = alm_ch_of(kobj)) < 0)
+		return ch;
+
+	spwm_get(&alm_pwm, ch, &c);
+	return sprintf(buf, "%d\n", c.enable);
+}
+
+static ssize_t enable_store(struct kobject *kobj, struct kobj_attribute *attr,
+			    const char *buf, size_t count)
+{
+	return alm_ch_store(kobj, ALM_ENABLE, buf, count);
+}
+
+/*
+** edges/expiries above 1 is the work saved by the shared timer
+*/
+static ssize_t stats_show(struct kobject *kobj, struct kobj_attribute *attr,
+			  char *buf)
+{
+	return sprintf(buf, "channels: %u\nexpiries: %llu\nedges:    %llu\n",
+		       alm_pwm.nr_chan, READ_ONCE(alm_pwm.expiries),
+		       READ_ONCE(alm_pwm.edges));
+}
+
+/*
+** Undo the first @nr channels. Their sysfs files go first, so no writer
+** can restart the timer, then the outputs are driven low and released.
+*/
+static void alm_ch_cleanup(int nr)
+{
+	int i;
+
+	for (i = 0; i < nr; i++)
+		kobject_put(alm_ch_kobj[i]);
+
+	spwm_stop(&alm_pwm);
+
+	for (i = 0; i < nr; i++)
+		gpio_free(gpios[i]);
+}
+
+/*
+** This function is called at the first time module inserted
+*/
+static int __init alm_init(void)
+{
+	char name[8];
+	int i;
+
+	spwm_init(&alm_pwm, slack_ns);
+
+	/* Sysfs: create dir in /sys/kernel/ */
+	if ((alm_kobj_ref = kobject_create_and_add(MOD_NAME "_pwm",
+						   kernel_kobj)) == NULL) {
+		pr_err(DEV_INFO "Can't create sysfs dir\n");
+		return -1;
+	}
+
+	if (sysfs_create_file(alm_kobj_ref, &stats_attr.attr)) {
+		pr_err(DEV_INFO "Can't create sysfs file\n");
+		goto r_sysfs;
+	}
+
+	/* One channel per GPIO: /sys/kernel/alman_pwm/chN/ */
+	for (i = 0; i < nr_gpios; i++) {
+		if (!gpio_is_valid(gpios[i]) ||
+		    gpio_request(gpios[i], MOD_NAME "_pwm") < 0) {
+			pr_err(DEV_INFO "Can't request GPIO %d\n", gpios[i]);
+			goto r_channels;
+		}
+
+		/* toggled from the timer, in hard irq context on !RT */
+		if (gpio_cansleep(gpios[i]) ||
+		    gpio_direction_output(gpios[i], 0) < 0) {
+			pr_err(DEV_INFO "GPIO %d can't be used\n", gpios[i]);
+			gpio_free(gpios[i]);
+			goto r_channels;
+		}
+		spwm_add(&alm_pwm, gpios[i]);
+
+		snprintf(name, sizeof(name), "ch%d", i);
+		alm_ch_kobj[i] = kobject_create_and_add(name, alm_kobj_ref);
+		if (alm_ch_kobj[i] == NULL ||
+		    sysfs_create_group(alm_ch_kobj[i], &alm_ch_group)) {
+			pr_err(DEV_INFO "Can't create sysfs %s\n", name);
+			/* spwm_add() counted it, undo it with the others */
+			i++;
+			goto r_channels;
+		}
+	}
+
+	printk(DEV_INFO "Driver inserted, %d channel(s)\n", nr_gpios);
+	return 0;
+
+r_channels:
+	alm_ch_cleanup(i);
+r_sysfs:
+	kobject_put(alm_kobj_ref);
+
+	return -1;
+}
+
+/*
+** This function is called at the last time module removed
+*/
+static void __exit alm_exit(void)
+{
+	alm_ch_cleanup(alm_pwm.nr_chan);
+	kobject_put(alm_kobj_ref);
+
+	printk(DEV_INFO "Driver removed\n");
+}
+
+module_init(alm_init);
+module_exit(alm_exit);
+
+/* Module description */
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Pudja Mansyurin");
+MODULE_DESCRIPTION(MOD_NAME);
+MODULE_VERSION("3:5.4");
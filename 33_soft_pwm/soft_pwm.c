@@ -0,0 +1,243 @@
+#include <linux/module.h>
+#include <linux/gpio.h>
+#include <linux/math64.h>
+#include <linux/version.h>
+#include "soft_pwm.h"
+
+/* Private macros */
+/*
+ * Hard irq expiry, so edges are not delayed by softirq load. On PREEMPT_RT
+ * gpio_set_value() takes locks that sleep, so there the timer expires in
+ * the softirq thread, under a sleeping lock, and edges jitter with it.
+ */
+#ifdef CONFIG_PREEMPT_RT
+#define SPWM_HRTIMER_MODE HRTIMER_MODE_ABS_SOFT
+#define spwm_lock_init(l) spin_lock_init(l)
+#define spwm_lock(l) spin_lock(l)
+#define spwm_unlock(l) spin_unlock(l)
+#define spwm_lock_irqsave(l, f) spin_lock_irqsave(l, f)
+#define spwm_unlock_irqrestore(l, f) spin_unlock_irqrestore(l, f)
+#else
+#define SPWM_HRTIMER_MODE HRTIMER_MODE_ABS_HARD
+#define spwm_lock_init(l) raw_spin_lock_init(l)
+#define spwm_lock(l) raw_spin_lock(l)
+#define spwm_unlock(l) raw_spin_unlock(l)
+#define spwm_lock_irqsave(l, f) raw_spin_lock_irqsave(l, f)
+#define spwm_unlock_irqrestore(l, f) raw_spin_unlock_irqrestore(l, f)
+#endif
+
+/* Function implementations */
+static bool spwm_toggles(struct spwm_chan *c)
+{
+	return c->enable && c->duty_ns > 0 && c->duty_ns < c->period_ns;
+}
+
+/*
+ * spwm_sched_build - collect toggling channels, earliest edge first
+ */
+static void spwm_sched_build(struct spwm *p)
+{
+	unsigned int ch, i;
+	u8 tmp;
+
+	p->nr_sched = 0;
+	for (ch = 0; ch < p->nr_chan; ch++) {
+		if (spwm_toggles(&p->chan[ch]))
+			p->sched[p->nr_sched++] = ch;
+	}
+
+	/* insertion sort, there are only a handful of channels */
+	for (ch = 1; ch < p->nr_sched; ch++) {
+		tmp = p->sched[ch];
+		for (i = ch; i > 0; i--) {
+			if (p->chan[p->sched[i - 1]].next <= p->chan[tmp].next)
+				break;
+			p->sched[i] = p->sched[i - 1];
+		}
+		p->sched[i] = tmp;
+	}
+}
+
+/*
+ * spwm_sched_sift - move the head of the schedule to its new place
+ */
+static void spwm_sched_sift(struct spwm *p)
+{
+	u8 ch = p->sched[0];
+	unsigned int i;
+
+	for (i = 1; i < p->nr_sched; i++) {
+		if (p->chan[p->sched[i]].next > p->chan[ch].next)
+			break;
+		p->sched[i - 1] = p->sched[i];
+	}
+	p->sched[i - 1] = ch;
+}
+
+/*
+ * spwm_edge - apply the due edge of a channel and compute the next one
+ */
+static void spwm_edge(struct spwm_chan *c, u64 now)
+{
+	if (!c->level) {
+		c->level = true;
+		c->next = c->rise + c->duty_ns;
+	} else {
+		c->level = false;
+		c->rise += c->period_ns;
+		/* skip whole periods missed, staying on the period grid */
+		if (now > c->rise + c->period_ns)
+			c->rise += div64_u64(now - c->rise, c->period_ns) *
+				   c->period_ns;
+		c->next = c->rise;
+	}
+
+	gpio_set_value(c->gpio, c->level);
+}
+
+static enum hrtimer_restart spwm_timer_fn(struct hrtimer *timer)
+{
+	struct spwm *p = container_of(timer, struct spwm, timer);
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+	struct spwm_chan *c;
+	u64 now;
+
+	spwm_lock(&p->lock);
+	/* reconfigured, and restarted, while we were waiting for the lock */
+	if (hrtimer_is_queued(timer))
+		goto out;
+
+	p->expiries++;
+	now = ktime_get_ns();
+	while (p->nr_sched) {
+		c = &p->chan[p->sched[0]];
+		if (c->next > now + p->slack_ns)
+			break;
+
+		spwm_edge(c, now);
+		spwm_sched_sift(p);
+		p->edges++;
+	}
+
+	if (p->nr_sched) {
+		hrtimer_set_expires(timer,
+				    ns_to_ktime(p->chan[p->sched[0]].next));
+		ret = HRTIMER_RESTART;
+	}
+out:
+	spwm_unlock(&p->lock);
+	return ret;
+}
+
+/**
+ * spwm_init - set up an engine without channels
+ * @slack_ns: edges this close to an expiry are applied with it
+ */
+void spwm_init(struct spwm *p, u64 slack_ns)
+{
+	memset(p, 0, sizeof(*p));
+	spwm_lock_init(&p->lock);
+	/* keep at least one expiry per high and per low phase */
+	p->slack_ns = min_t(u64, slack_ns, SPWM_MIN_PERIOD_NS / 4);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+	hrtimer_setup(&p->timer, spwm_timer_fn, CLOCK_MONOTONIC,
+		      SPWM_HRTIMER_MODE);
+#else
+	hrtimer_init(&p->timer, CLOCK_MONOTONIC, SPWM_HRTIMER_MODE);
+	p->timer.function = spwm_timer_fn;
+#endif
+}
+
+/**
+ * spwm_add - append a channel, disabled, on an output GPIO
+ *
+ * Return: channel index or -ENOSPC
+ */
+int spwm_add(struct spwm *p, int gpio)
+{
+	unsigned long flags;
+	int ch = -ENOSPC;
+
+	spwm_lock_irqsave(&p->lock, flags);
+	if (p->nr_chan < SPWM_MAX_CHANNELS) {
+		ch = p->nr_chan++;
+		p->chan[ch].gpio = gpio;
+		p->chan[ch].period_ns = SPWM_MIN_PERIOD_NS;
+	}
+	spwm_unlock_irqrestore(&p->lock, flags);
+
+	return ch;
+}
+
+/**
+ * spwm_config - change one channel, the others keep their phase
+ *
+ * 0% and 100% duty are driven as constant levels and leave the schedule.
+ *
+ * Return: 0 or -EINVAL
+ */
+int spwm_config(struct spwm *p, unsigned int ch, u64 period_ns, u64 duty_ns,
+		bool enable)
+{
+	struct spwm_chan *c;
+	unsigned long flags;
+	u64 now;
+
+	if (ch >= p->nr_chan || period_ns < SPWM_MIN_PERIOD_NS ||
+	    duty_ns > period_ns)
+		return -EINVAL;
+
+	spwm_lock_irqsave(&p->lock, flags);
+	c = &p->chan[ch];
+	c->period_ns = period_ns;
+	c->duty_ns = duty_ns;
+	c->enable = enable;
+
+	/* next period boundary of the grid, shared by equal periods */
+	now = ktime_get_ns();
+	c->rise = (div64_u64(now, period_ns) + 1) * period_ns;
+	c->next = c->rise;
+	c->level = enable && duty_ns == period_ns;
+	gpio_set_value(c->gpio, c->level);
+
+	spwm_sched_build(p);
+	if (p->nr_sched)
+		hrtimer_start(&p->timer, ns_to_ktime(p->chan[p->sched[0]].next),
+			      SPWM_HRTIMER_MODE);
+	else
+		/* a running callback finds the schedule empty and stops */
+		hrtimer_try_to_cancel(&p->timer);
+	spwm_unlock_irqrestore(&p->lock, flags);
+
+	return 0;
+}
+
+void spwm_get(struct spwm *p, unsigned int ch, struct spwm_chan *out)
+{
+	unsigned long flags;
+
+	spwm_lock_irqsave(&p->lock, flags);
+	*out = p->chan[ch];
+	spwm_unlock_irqrestore(&p->lock, flags);
+}
+
+/**
+ * spwm_stop - stop the timer and drive every channel low
+ */
+void spwm_stop(struct spwm *p)
+{
+	unsigned long flags;
+	unsigned int ch;
+
+	spwm_lock_irqsave(&p->lock, flags);
+	p->nr_sched = 0;
+	for (ch = 0; ch < p->nr_chan; ch++) {
+		p->chan[ch].enable = false;
+		p->chan[ch].level = false;
+		gpio_set_value(p->chan[ch].gpio, 0);
+	}
+	spwm_unlock_irqrestore(&p->lock, flags);
+
+	hrtimer_cancel(&p->timer);
+}
@@ -0,0 +1,57 @@
+#ifndef __SOFT_PWM_H__
+#define __SOFT_PWM_H__
+
+#include <linux/hrtimer.h>
+#include <linux/spinlock.h>
+
+#define SPWM_MAX_CHANNELS (16)
+#define SPWM_MIN_PERIOD_NS (20 * NSEC_PER_USEC)
+
+/* the timer expires in hard irq context, except on PREEMPT_RT */
+#ifdef CONFIG_PREEMPT_RT
+typedef spinlock_t spwm_lock_t;
+#else
+typedef raw_spinlock_t spwm_lock_t;
+#endif
+
+/*
+ * A channel has its own period and duty cycle. While it toggles, the
+ * next edge sits in the engine's schedule, sorted by time.
+ */
+struct spwm_chan {
+	int gpio;
+	u64 period_ns;
+	u64 duty_ns;
+	bool enable;
+	bool level;
+	u64 rise; /* start of the current period */
+	u64 next; /* absolute time of the next edge */
+};
+
+/*
+ * One hrtimer drives every channel. Each expiry applies every edge due
+ * within slack_ns in one pass, then sleeps until the earliest remaining
+ * edge. Channels sharing a period are phase aligned, so their rising
+ * edges always fall in the same expiry.
+ */
+struct spwm {
+	struct hrtimer timer;
+	spwm_lock_t lock; /* taken from the timer */
+	struct spwm_chan chan[SPWM_MAX_CHANNELS];
+	u8 sched[SPWM_MAX_CHANNELS]; /* toggling channels, earliest first */
+	unsigned int nr_chan;
+	unsigned int nr_sched;
+	u64 slack_ns;
+	u64 expiries;
+	u64 edges;
+};
+
+/* exported functions */
+void spwm_init(struct spwm *p, u64 slack_ns);
+int spwm_add(struct spwm *p, int gpio);
+int spwm_config(struct spwm *p, unsigned int ch, u64 period_ns, u64 duty_ns,
+		bool enable);
+void spwm_get(struct spwm *p, unsigned int ch, struct spwm_chan *out);
+void spwm_stop(struct spwm *p);
+
+#endif /* __SOFT_PWM_H__ */